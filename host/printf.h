@@ -0,0 +1,9 @@
+#ifndef __HOST_PRINTF_H__
+#define __HOST_PRINTF_H__
+
+/* 主机编译时替代 kendryte-standalone-sdk 的 printf.h */
+#include <stdio.h>
+
+#define printk printf
+
+#endif /* __HOST_PRINTF_H__ */
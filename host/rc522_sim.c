@@ -0,0 +1,1717 @@
+#include "rc522_sim.h"
+
+#include <string.h>
+
+#include "rfid.h"
+#include "rfid_isodep.h"
+#include "rfid_ultralight.h"
+
+/* clang-format off */
+#define SIM_FC_HZ               (13560000ULL)
+#define SIM_ETU_NS              (9440)      //106kbit/s 每位 128/fc
+#define SIM_SOFT_RESET_NS       (40000)
+#define SIM_WAKE_NS             (200000)    //退出软掉电后振荡器起振
+
+#define SIM_IRQ_TIMER           (0x01)
+#define SIM_IRQ_ERR             (0x02)
+#define SIM_IRQ_LOALERT         (0x04)
+#define SIM_IRQ_HIALERT         (0x08)
+#define SIM_IRQ_IDLE            (0x10)
+#define SIM_IRQ_RX              (0x20)
+#define SIM_IRQ_TX              (0x40)
+#define SIM_DIVIRQ_CRC          (0x04)
+/* clang-format on */
+
+static const uint8_t sim_reg_default[0x40] = {
+    [CommandReg] = 0x20,
+    [ComIEnReg] = 0x80,
+    [ComIrqReg] = 0x14,
+    [Status1Reg] = 0x21,
+    [WaterLevelReg] = 0x08,
+    [ControlReg] = 0x10,
+    [CollReg] = 0xA0,
+    [ModeReg] = 0x3F,
+    [TxControlReg] = 0x80,
+    [TxSelReg] = 0x10,
+    [RxSelReg] = 0x84,
+    [RxThresholdReg] = 0x84,
+    [DemodReg] = 0x4D,
+    [SerialSpeedReg] = 0xEB,
+    [CRCResultRegM] = 0xFF,
+    [CRCResultRegL] = 0xFF,
+    [ModWidthReg] = 0x26,
+    [RFCfgReg] = 0x48,
+    [GsNReg] = 0x88,
+    [CWGsCfgReg] = 0x20,
+    [ModGsCfgReg] = 0x20,
+    [VersionReg] = 0x92,
+};
+
+static const uint8_t sim_default_trailer[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x07, 0x80, 0x69,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+///////////////////////////////////////////////////////////////////////////////
+//位操作, 空中传输低位在前
+///////////////////////////////////////////////////////////////////////////////
+static int bit_get(const uint8_t *buf, uint32_t pos)
+{
+    return (buf[pos >> 3] >> (pos & 7)) & 1;
+}
+
+static void bit_put(uint8_t *buf, uint32_t pos, int val)
+{
+    if (val)
+        buf[pos >> 3] |= (1 << (pos & 7));
+    else
+        buf[pos >> 3] &= ~(1 << (pos & 7));
+}
+
+uint16_t rc522_sim_crc(const uint8_t *data, uint32_t len, uint16_t preset)
+{
+    uint16_t crc = preset;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+    }
+
+    return crc;
+}
+
+static uint16_t sim_crc_preset(struct rc522_sim_t *sim)
+{
+    static const uint16_t preset[4] = {0x0000, 0x6363, 0xA671, 0xFFFF};
+
+    return preset[sim->reg[ModeReg] & 0x03];
+}
+
+static int sim_crc_ok(const uint8_t *frame, uint32_t len)
+{
+    uint16_t crc;
+
+    if (len < 3)
+        return 0;
+
+    crc = rc522_sim_crc(frame, len - 2, 0x6363);
+
+    return (frame[len - 2] == (crc & 0xFF)) && (frame[len - 1] == (crc >> 8));
+}
+
+/**
+ * @param [in], br: RFID_BR_*, 每档速率位时间减半
+ */
+static uint32_t sim_air_ns(uint32_t bits, uint8_t br)
+{
+    /* 每字节附加奇偶校验位, 另加 SOF/EOF */
+    return (bits + bits / 8 + 2) * (SIM_ETU_NS >> br);
+}
+
+static uint8_t sim_tx_br(struct rc522_sim_t *sim)
+{
+    return (sim->reg[TxModeReg] >> 4) & 0x03;
+}
+
+static uint8_t sim_rx_br(struct rc522_sim_t *sim)
+{
+    return (sim->reg[RxModeReg] >> 4) & 0x03;
+}
+
+/**
+ * @brief 一个字节连同奇偶校验位的空中时间
+ */
+static uint32_t sim_byte_ns(uint8_t br)
+{
+    return 9 * (SIM_ETU_NS >> br);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//虚拟卡片
+///////////////////////////////////////////////////////////////////////////////
+static void sim_card_power_off(struct sim_card_t *card)
+{
+    card->state = SIM_CARD_IDLE;
+    card->level = 1;
+    card->authed = 0;
+    card->write_addr = -1;
+    card->value_addr = -1;
+    card->value_ok = 0;
+    card->br_pcd = RFID_BR_106;
+    card->br_picc = RFID_BR_106;
+    card->wtx = 0;
+    card->apdu_len = 0;
+    card->rsp_len = 0;
+    card->rsp_off = 0;
+    card->ul_authed = 0;
+}
+
+/**
+ * @brief 取某一级联层的 4 字节 UID CLn 及 BCC
+ */
+static int sim_card_cl(const struct sim_card_t *card, uint8_t level, uint8_t *cl)
+{
+    uint8_t ofs, cascade;
+
+    if (level == 1)
+    {
+        ofs = 0;
+        cascade = (card->uid_len > 4);
+    }
+    else if (level == 2)
+    {
+        ofs = 3;
+        cascade = (card->uid_len > 7);
+    }
+    else
+    {
+        ofs = 6;
+        cascade = 0;
+    }
+
+    if (cascade)
+    {
+        cl[0] = 0x88;
+        memcpy(&cl[1], &card->uid[ofs], 3);
+    }
+    else
+    {
+        memcpy(cl, &card->uid[ofs], 4);
+    }
+    cl[4] = cl[0] ^ cl[1] ^ cl[2] ^ cl[3];
+
+    return cascade;
+}
+
+/**
+ * @brief 值块格式: 值, 值取反, 值, 地址, 地址取反, 地址, 地址取反
+ */
+static int sim_value_ok(const uint8_t *blk)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (blk[i] != blk[i + 8] || (uint8_t)(blk[i] ^ blk[i + 4]) != 0xFF)
+            return 0;
+    }
+
+    return blk[12] == blk[14] && blk[13] == blk[15] && (uint8_t)(blk[12] ^ blk[13]) == 0xFF;
+}
+
+static void sim_value_put(uint8_t *blk, int32_t value, uint8_t addr)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        blk[i] = (uint32_t)value >> (8 * i);
+        blk[i + 4] = ~blk[i];
+        blk[i + 8] = blk[i];
+    }
+    blk[12] = blk[14] = addr;
+    blk[13] = blk[15] = ~addr;
+}
+
+static void sim_resp_ack(uint8_t *resp, uint16_t *resp_bits, uint8_t code)
+{
+    resp[0] = code;
+    *resp_bits = 4;
+}
+
+static void sim_resp_crc(uint8_t *resp, uint16_t *resp_bits, uint8_t len)
+{
+    uint16_t crc = rc522_sim_crc(resp, len, 0x6363);
+
+    resp[len] = crc & 0xFF;
+    resp[len + 1] = crc >> 8;
+    *resp_bits = (len + 2) * 8;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//ISO14443-4
+///////////////////////////////////////////////////////////////////////////////
+static uint64_t sim_card_fwt_ns(const struct sim_card_t *card)
+{
+    uint8_t t0 = card->ats[1], fwi = 4, ofs = 2;
+
+    if (card->ats[0] > 1)
+    {
+        ofs += (t0 & 0x10) ? 1 : 0;
+        if ((t0 & 0x20) && (card->ats[ofs] >> 4) < 15)
+            fwi = card->ats[ofs] >> 4;
+    }
+
+    return ((uint64_t)4096 << fwi) * 1000000000ULL / SIM_FC_HZ;
+}
+
+/**
+ * @brief 发出一个块并留底供重发
+ */
+static void sim_l4_send(struct sim_card_t *card, const uint8_t *blk, uint16_t len, uint8_t *resp, uint16_t *resp_bits)
+{
+    memcpy(card->last, blk, len);
+    card->last_len = len;
+    memcpy(resp, blk, len);
+    sim_resp_crc(resp, resp_bits, len);
+}
+
+/**
+ * @brief 发出应答APDU的下一块, 超过 FSD 时链接
+ */
+static void sim_l4_next(struct sim_card_t *card, uint8_t *resp, uint16_t *resp_bits)
+{
+    uint8_t blk[SIM_MAX_FRAME];
+    uint16_t n = card->fsd - 3;
+
+    if (card->rsp_len - card->rsp_off < n)
+        n = card->rsp_len - card->rsp_off;
+
+    blk[0] = ISODEP_PCB_I | card->bn | ((card->rsp_off + n < card->rsp_len) ? ISODEP_PCB_CHAIN : 0);
+    memcpy(&blk[1], &card->rsp[card->rsp_off], n);
+    card->rsp_off += n;
+    sim_l4_send(card, blk, n + 1, resp, resp_bits);
+}
+
+/**
+ * @brief 应用层: READ BINARY / UPDATE BINARY, 文件为 mem[]
+ */
+static void sim_l4_apdu(struct rc522_sim_t *sim, struct sim_card_t *card)
+{
+    const uint8_t *apdu = card->apdu;
+    uint16_t len = card->apdu_len, ofs = (apdu[2] << 8) | apdu[3], n;
+    uint16_t sw = 0x9000;
+
+    card->rsp_len = 0;
+    card->rsp_off = 0;
+    card->proc_ns = 0;
+
+    if (len < 4 || apdu[0] != 0x00)
+    {
+        sw = (len < 4) ? 0x6700 : 0x6E00;
+    }
+    else if (apdu[1] == 0xB0 && len == 5)
+    {
+        n = apdu[4] ? apdu[4] : 256;
+        if (ofs + n > sizeof(card->mem))
+        {
+            sw = 0x6B00;
+        }
+        else
+        {
+            memcpy(card->rsp, &card->mem[ofs], n);
+            card->rsp_len = n;
+        }
+    }
+    else if (apdu[1] == 0xD6 && len > 5 && len == 5 + apdu[4])
+    {
+        n = apdu[4];
+        if (ofs + n > sizeof(card->mem))
+        {
+            sw = 0x6B00;
+        }
+        else
+        {
+            memcpy(&card->mem[ofs], &apdu[5], n);
+            card->proc_ns = (n + 15) / 16 * sim->timing.write_ns;
+        }
+    }
+    else
+    {
+        sw = 0x6D00;
+    }
+
+    card->rsp[card->rsp_len++] = sw >> 8;
+    card->rsp[card->rsp_len++] = sw & 0xFF;
+}
+
+/**
+ * @brief 协议态下处理一帧; 传输错误的帧不应答, 由读卡器超时后发 R(NAK)
+ */
+static int sim_card_l4(struct rc522_sim_t *sim, struct sim_card_t *card,
+                       const uint8_t *tx, uint16_t tx_bits,
+                       uint8_t *resp, uint16_t *resp_bits, uint32_t *delay_ns)
+{
+    uint16_t len = tx_bits / 8;
+    uint8_t pcb = tx[0], blk[2], pps_ok = card->pps_ok;
+    uint64_t fwt_ns;
+
+    if ((tx_bits & 7) || len < 3 || !sim_crc_ok(tx, len))
+        return 0;
+    len -= 2;
+    card->pps_ok = 0;
+
+    if (pps_ok && pcb == PICC_PPS && len == 3 && tx[1] == 0x11)
+    {
+        /* 以原速率应答后切换 */
+        blk[0] = PICC_PPS;
+        sim_l4_send(card, blk, 1, resp, resp_bits);
+        card->br_pcd = tx[2] & 0x03;
+        card->br_picc = (tx[2] >> 2) & 0x03;
+        return 1;
+    }
+
+    if ((pcb & 0xF7) == ISODEP_PCB_S_DESELECT && len == 1)
+    {
+        blk[0] = ISODEP_PCB_S_DESELECT;
+        sim_l4_send(card, blk, 1, resp, resp_bits);
+        sim_card_power_off(card);
+        card->state = SIM_CARD_HALT;
+        return 1;
+    }
+
+    if ((pcb & 0xF7) == ISODEP_PCB_S_WTX && len == 2 && card->wtx)
+    {
+        card->wtx = 0;
+        *delay_ns += card->proc_ns;
+        sim_l4_next(card, resp, resp_bits);
+        return 1;
+    }
+
+    if ((pcb & 0xE2) == ISODEP_PCB_I && !(pcb & 0x0C))
+    {
+        card->bn = pcb & ISODEP_PCB_BN;
+        if ((size_t)(card->apdu_len + len - 1) > sizeof(card->apdu))
+            card->apdu_len = 0;
+        memcpy(&card->apdu[card->apdu_len], &tx[1], len - 1);
+        card->apdu_len += len - 1;
+
+        if (pcb & ISODEP_PCB_CHAIN)
+        {
+            blk[0] = ISODEP_PCB_R_ACK | card->bn;
+            sim_l4_send(card, blk, 1, resp, resp_bits);
+            return 1;
+        }
+
+        sim_l4_apdu(sim, card);
+        card->apdu_len = 0;
+
+        fwt_ns = sim_card_fwt_ns(card);
+        if (card->proc_ns > fwt_ns)
+        {
+            card->wtx = 1;
+            blk[0] = ISODEP_PCB_S_WTX;
+            blk[1] = card->proc_ns / fwt_ns + 1;
+            blk[1] = (blk[1] > 59) ? 59 : blk[1];
+            sim_l4_send(card, blk, 2, resp, resp_bits);
+            return 1;
+        }
+
+        *delay_ns += card->proc_ns;
+        sim_l4_next(card, resp, resp_bits);
+        return 1;
+    }
+
+    if ((pcb & 0xF6) == ISODEP_PCB_R_ACK && len == 1)
+    {
+        /* 块号不同: 读卡器确认了上一块, 发出链接的下一块 */
+        if ((pcb & ISODEP_PCB_BN) != card->bn && card->rsp_off < card->rsp_len)
+        {
+            card->bn ^= ISODEP_PCB_BN;
+            sim_l4_next(card, resp, resp_bits);
+            return 1;
+        }
+        sim_l4_send(card, card->last, card->last_len, resp, resp_bits);
+        return 1;
+    }
+
+    if ((pcb & 0xF6) == ISODEP_PCB_R_NAK && len == 1)
+    {
+        if ((pcb & ISODEP_PCB_BN) == card->bn)
+        {
+            sim_l4_send(card, card->last, card->last_len, resp, resp_bits);
+        }
+        else
+        {
+            blk[0] = ISODEP_PCB_R_ACK | card->bn;
+            sim_l4_send(card, blk, 1, resp, resp_bits);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//Ultralight/NTAG
+///////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief 页是否需要先 PWD_AUTH: AUTH0 起的页写入受保护, CFG1 的 PROT 位置位时读取也受保护
+ */
+static int sim_ul_locked(const struct sim_card_t *card, uint8_t page, int write)
+{
+    uint8_t cfg = card->ul_pages - 4;
+
+    if (card->ul_authed || page < card->mem[cfg * 4 + 3])
+        return 0;
+
+    return write || (card->mem[(cfg + 1) * 4] & 0x80);
+}
+
+/**
+ * @brief 读出一页, PWD 与 PACK 读出为0
+ */
+static void sim_ul_page(const struct sim_card_t *card, uint8_t page, uint8_t *out)
+{
+    if (page >= card->ul_pages - 2)
+        memset(out, 0, 4);
+    else
+        memcpy(out, &card->mem[page * 4], 4);
+}
+
+/**
+ * @brief 写一页, 锁定字节(页2的后两字节)与 OTP(页3) 只能由0置1
+ */
+static void sim_ul_write(struct sim_card_t *card, uint8_t page, const uint8_t *data)
+{
+    uint8_t *dst = &card->mem[page * 4];
+
+    if (page == 2)
+    {
+        dst[2] |= data[2];
+        dst[3] |= data[3];
+    }
+    else if (page == 3)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+            dst[i] |= data[i];
+    }
+    else
+    {
+        memcpy(dst, data, 4);
+    }
+}
+
+/**
+ * @brief Ultralight/NTAG 命令, len 不含CRC; 页地址无效, 未认证或密码错误时 NAK 并回到空闲态
+ */
+static int sim_card_ul(struct rc522_sim_t *sim, struct sim_card_t *card, const uint8_t *tx, uint16_t len,
+                       uint8_t *resp, uint16_t *resp_bits, uint32_t *delay_ns)
+{
+    uint8_t cfg = card->ul_pages - 4;
+    uint16_t i;
+
+    switch (tx[0])
+    {
+    case PICC_HALT:
+        card->state = SIM_CARD_HALT;
+        card->ul_authed = 0;
+        return 0;
+
+    case PICC_UL_GET_VERSION:
+        if (len != 1)
+            break;
+        memcpy(resp, card->ul_version, 8);
+        sim_resp_crc(resp, resp_bits, 8);
+        return 1;
+
+    case PICC_READ:
+        if (len != 2 || tx[1] >= card->ul_pages)
+            break;
+        /* 超出末页时从第0页继续 */
+        for (i = 0; i < 4; i++)
+        {
+            if (sim_ul_locked(card, (tx[1] + i) % card->ul_pages, 0))
+                break;
+            sim_ul_page(card, (tx[1] + i) % card->ul_pages, &resp[i * 4]);
+        }
+        if (i < 4)
+            break;
+        sim_resp_crc(resp, resp_bits, 16);
+        return 1;
+
+    case PICC_UL_FAST_READ:
+        if (len != 3 || tx[1] > tx[2] || tx[2] >= card->ul_pages || (tx[2] - tx[1] + 1) * 4 + 2 > SIM_MAX_FRAME)
+            break;
+        for (i = tx[1]; i <= tx[2]; i++)
+        {
+            if (sim_ul_locked(card, i, 0))
+                break;
+            sim_ul_page(card, i, &resp[(i - tx[1]) * 4]);
+        }
+        if (i <= tx[2])
+            break;
+        sim_resp_crc(resp, resp_bits, (tx[2] - tx[1] + 1) * 4);
+        return 1;
+
+    case PICC_UL_WRITE:
+        if (len != 6 || tx[1] < 2 || tx[1] >= card->ul_pages || sim_ul_locked(card, tx[1], 1))
+            break;
+        sim_ul_write(card, tx[1], &tx[2]);
+        *delay_ns += sim->timing.write_ns;
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+
+    case PICC_WRITE:
+        if (len != 2 || tx[1] < 2 || tx[1] >= card->ul_pages || sim_ul_locked(card, tx[1], 1))
+            break;
+        card->write_addr = tx[1];
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+
+    case PICC_UL_PWD_AUTH:
+        if (len != 5 || memcmp(&tx[1], &card->mem[(cfg + 2) * 4], 4))
+            break;
+        card->ul_authed = 1;
+        memcpy(resp, &card->mem[(cfg + 3) * 4], 2);
+        sim_resp_crc(resp, resp_bits, 2);
+        return 1;
+
+    default:
+        break;
+    }
+
+    sim_resp_ack(resp, resp_bits, 0x00);
+    sim_card_power_off(card);
+    return 1;
+}
+
+/**
+ * @brief 卡片处理一帧
+ *
+ * @return 1 有应答, 0 无应答
+ */
+static int sim_card_frame(struct rc522_sim_t *sim, struct sim_card_t *card,
+                          const uint8_t *tx, uint16_t tx_bits,
+                          uint8_t *resp, uint16_t *resp_bits, uint32_t *delay_ns)
+{
+    static const uint16_t fsd[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+    uint8_t cl[5];
+    uint16_t len = tx_bits / 8;
+
+    *delay_ns = card->fdt_ns ? card->fdt_ns : sim->timing.fdt_ns;
+
+    if (card->state == SIM_CARD_L4)
+        return sim_card_l4(sim, card, tx, tx_bits, resp, resp_bits, delay_ns);
+
+    if (tx_bits == 7)
+    {
+        uint8_t cmd = tx[0] & 0x7F;
+
+        if ((cmd == PICC_REQIDL && card->state == SIM_CARD_IDLE) ||
+            (cmd == PICC_REQALL && (card->state == SIM_CARD_IDLE || card->state == SIM_CARD_HALT)))
+        {
+            card->state = SIM_CARD_READY;
+            card->level = 1;
+            resp[0] = card->atqa[0];
+            resp[1] = card->atqa[1];
+            *resp_bits = 16;
+            return 1;
+        }
+        if (card->state != SIM_CARD_HALT)
+            sim_card_power_off(card);
+        return 0;
+    }
+
+    if (card->state == SIM_CARD_READY && tx_bits >= 16 &&
+        (tx[0] == 0x93 || tx[0] == 0x95 || tx[0] == 0x97))
+    {
+        uint8_t level = 1 + (tx[0] - 0x93) / 2;
+        uint8_t nvb = tx[1];
+        uint16_t known, i;
+        int cascade;
+
+        if (level != card->level)
+            return 0;
+
+        cascade = sim_card_cl(card, level, cl);
+
+        if (nvb == 0x70)
+        {
+            /* 未被选中的卡回到 IDLE */
+            if (tx_bits != 72 || !sim_crc_ok(tx, 9) || memcmp(&tx[2], cl, 5))
+            {
+                sim_card_power_off(card);
+                return 0;
+            }
+
+            if (cascade)
+            {
+                resp[0] = 0x04;
+                card->level++;
+            }
+            else
+            {
+                resp[0] = card->sak;
+                card->state = SIM_CARD_ACTIVE;
+            }
+            sim_resp_crc(resp, resp_bits, 1);
+            return 1;
+        }
+
+        known = (nvb >> 4) * 8 + (nvb & 0x0F);
+        if (known < 16 || known > 56 || tx_bits != known)
+            return 0;
+        known -= 16;
+
+        for (i = 0; i < known; i++)
+        {
+            if (bit_get(cl, i) != bit_get(tx, 16 + i))
+                return 0;
+        }
+
+        memset(resp, 0, 5);
+        for (i = known; i < 40; i++)
+            bit_put(resp, i - known, bit_get(cl, i));
+        *resp_bits = 40 - known;
+        return 1;
+    }
+
+    if (card->state != SIM_CARD_ACTIVE || (tx_bits & 7))
+        return 0;
+
+    if (card->write_addr >= 0)
+    {
+        uint8_t addr = card->write_addr;
+
+        card->write_addr = -1;
+        if (len != 18 || !sim_crc_ok(tx, 18))
+            return 0;
+
+        /* Ultralight/NTAG 的兼容写只取前4字节 */
+        if (card->ul_pages)
+            sim_ul_write(card, addr, tx);
+        else
+            memcpy(&card->mem[addr * 16], tx, 16);
+        *delay_ns += sim->timing.write_ns;
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+    }
+
+    if (card->value_addr >= 0)
+    {
+        const uint8_t *blk = &card->mem[card->value_addr * 16];
+        int32_t operand = tx[0] | (tx[1] << 8) | (tx[2] << 16) | ((uint32_t)tx[3] << 24);
+        int32_t value = blk[0] | (blk[1] << 8) | (blk[2] << 16) | ((uint32_t)blk[3] << 24);
+
+        card->value_src = card->value_addr;
+        card->value_addr = -1;
+        if (len != 6 || !sim_crc_ok(tx, 6))
+            return 0;
+
+        if (card->value_cmd == PICC_INCREMENT)
+            value += operand;
+        else if (card->value_cmd == PICC_DECREMENT)
+            value -= operand;
+        card->value_buf = value;
+        card->value_ok = 1;
+        /* 第二阶段不应答 */
+        return 0;
+    }
+
+    if (len < 3 || !sim_crc_ok(tx, len))
+        return 0;
+
+    if (card->ul_pages)
+        return sim_card_ul(sim, card, tx, len - 2, resp, resp_bits, delay_ns);
+
+    switch (tx[0])
+    {
+    case PICC_HALT:
+        card->state = SIM_CARD_HALT;
+        card->authed = 0;
+        return 0;
+
+    case PICC_RATS:
+        if (len != 4 || card->ats[0] == 0)
+            return 0;
+        card->state = SIM_CARD_L4;
+        card->pps_ok = 1;
+        card->bn = 1;
+        card->fsd = fsd[((tx[1] >> 4) > 8) ? 8 : (tx[1] >> 4)];
+        sim_l4_send(card, card->ats, card->ats[0], resp, resp_bits);
+        return 1;
+
+    case PICC_READ:
+        if (len != 4 || tx[1] >= 64 || card->authed != (tx[1] / 4) + 1)
+            break;
+        memcpy(resp, &card->mem[tx[1] * 16], 16);
+        sim_resp_crc(resp, resp_bits, 16);
+        return 1;
+
+    case PICC_WRITE:
+        if (len != 4 || tx[1] == 0 || tx[1] >= 64 || card->authed != (tx[1] / 4) + 1)
+            break;
+        card->write_addr = tx[1];
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+
+    case PICC_INCREMENT:
+    case PICC_DECREMENT:
+    case PICC_RESTORE:
+        if (len != 4 || tx[1] >= 64 || card->authed != (tx[1] / 4) + 1 || !sim_value_ok(&card->mem[tx[1] * 16]))
+            break;
+        card->value_addr = tx[1];
+        card->value_cmd = tx[0];
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+
+    case PICC_TRANSFER:
+        if (len != 4 || tx[1] == 0 || tx[1] >= 64 || card->authed != (tx[1] / 4) + 1 || !card->value_ok)
+            break;
+        sim_value_put(&card->mem[tx[1] * 16], card->value_buf, card->value_src);
+        card->value_ok = 0;
+        *delay_ns += sim->timing.write_ns;
+        sim_resp_ack(resp, resp_bits, 0x0A);
+        return 1;
+
+    default:
+        return 0;
+    }
+
+    /* 操作未授权: NAK 并回到空闲态 */
+    sim_resp_ack(resp, resp_bits, 0x04);
+    sim_card_power_off(card);
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//芯片模型
+///////////////////////////////////////////////////////////////////////////////
+static int sim_antenna_on(struct rc522_sim_t *sim)
+{
+    return (sim->reg[TxControlReg] & 0x03) && !(sim->reg[CommandReg] & 0x10);
+}
+
+/* 天线场已开启, 且到 at_ns 时卡片已完成上电复位 */
+static int sim_field_ready(struct rc522_sim_t *sim, uint64_t at_ns)
+{
+    return sim_antenna_on(sim) && at_ns >= sim->field_on_ns + sim->timing.picc_boot_ns;
+}
+
+static void sim_fields_off(struct rc522_sim_t *sim)
+{
+    for (uint8_t i = 0; i < sim->n_cards; i++)
+        sim_card_power_off(&sim->cards[i]);
+}
+
+/**
+ * @brief TxControlReg 或软掉电改变后调用: 累计天线场开启时间, 开启时记下时间供卡片上电, 关闭时卡片掉电
+ */
+static void sim_field_update(struct rc522_sim_t *sim, int was_on)
+{
+    int on = sim_antenna_on(sim);
+
+    if (was_on && !on)
+    {
+        sim->stats.rf_on_ns += sim->now_ns - sim->rf_mark_ns;
+        sim_fields_off(sim);
+    }
+    else if (!was_on && on)
+    {
+        sim->field_on_ns = sim->now_ns;
+        sim->rf_mark_ns = sim->now_ns;
+    }
+}
+
+static void sim_timer_start(struct rc522_sim_t *sim, uint64_t at_ns)
+{
+    uint32_t presc = ((sim->reg[TModeReg] & 0x0F) << 8) | sim->reg[TPrescalerReg];
+    uint32_t reload = (sim->reg[TReloadRegH] << 8) | sim->reg[TReloadRegL];
+
+    sim->timer_period_ns = (uint64_t)(2 * presc + 1) * (reload + 1) * 1000000000ULL / SIM_FC_HZ;
+    sim->timer_at_ns = at_ns + sim->timer_period_ns;
+}
+
+static void sim_soft_reset(struct rc522_sim_t *sim)
+{
+    int was_on = sim_antenna_on(sim);
+
+    if (sim->reg[CommandReg] & 0x10)
+        sim->stats.pd_ns += sim->now_ns - sim->pd_mark_ns;
+
+    memcpy(sim->reg, sim_reg_default, sizeof(sim->reg));
+    sim->fifo_len = 0;
+    sim->timer_at_ns = 0;
+    sim->op = SIM_OP_NONE;
+    sim->reset_until_ns = sim->now_ns + SIM_SOFT_RESET_NS;
+    sim_field_update(sim, was_on);
+    sim_fields_off(sim);
+}
+
+/**
+ * @brief FIFO 长度变化后按 WaterLevelReg 置位 LoAlertIRq/HiAlertIRq
+ */
+static void sim_fifo_alert(struct rc522_sim_t *sim)
+{
+    if (sim->fifo_len <= sim->reg[WaterLevelReg])
+        sim->reg[ComIrqReg] |= SIM_IRQ_LOALERT;
+    if (sizeof(sim->fifo) - sim->fifo_len <= sim->reg[WaterLevelReg])
+        sim->reg[ComIrqReg] |= SIM_IRQ_HIALERT;
+}
+
+static void sim_fifo_push(struct rc522_sim_t *sim, uint8_t val)
+{
+    if (sim->fifo_len < sizeof(sim->fifo))
+    {
+        sim->fifo[sim->fifo_len++] = val;
+    }
+    else
+    {
+        sim->reg[ErrorReg] |= 0x10; //BufferOvfl
+        sim->reg[ComIrqReg] |= SIM_IRQ_ERR;
+    }
+    sim_fifo_alert(sim);
+}
+
+static uint8_t sim_fifo_pop(struct rc522_sim_t *sim)
+{
+    uint8_t val;
+
+    if (sim->fifo_len == 0)
+        return 0;
+
+    val = sim->fifo[0];
+    sim->fifo_len--;
+    memmove(sim->fifo, &sim->fifo[1], sim->fifo_len);
+    sim_fifo_alert(sim);
+
+    return val;
+}
+
+/**
+ * @brief 将待接收应答按 RxAlign 放入 FIFO 并设置 ControlReg/ErrorReg/CollReg
+ */
+static void sim_deliver_rx(struct rc522_sim_t *sim)
+{
+    uint8_t align = (sim->reg[BitFramingReg] >> 4) & 0x07;
+    uint8_t data[SIM_MAX_FRAME + 1] = {0};
+    uint16_t total = sim->rx_bits + align, i;
+
+    for (i = 0; i < sim->rx_bits; i++)
+    {
+        int val = bit_get(sim->rx_buf, i);
+
+        if (sim->rx_coll >= 0 && !(sim->reg[CollReg] & 0x80))
+        {
+            if (i == sim->rx_coll)
+                val = 1;
+            else if (i > sim->rx_coll)
+                val = 0;
+        }
+        bit_put(data, align + i, val);
+    }
+
+    sim->fifo_len = 0;
+    for (i = 0; i < (total + 7) / 8; i++)
+        sim_fifo_push(sim, data[i]);
+
+    sim->reg[ControlReg] = (sim->reg[ControlReg] & ~0x07) | (total & 0x07);
+
+    if (sim->rx_coll >= 0)
+    {
+        uint16_t pos = sim->rx_coll + align + 1;
+
+        sim->reg[ErrorReg] |= 0x08; //CollErr
+        if (pos > 32)
+            sim->reg[CollReg] = (sim->reg[CollReg] & 0x80) | 0x20;
+        else
+            sim->reg[CollReg] = (sim->reg[CollReg] & 0x80) | (pos & 0x1F);
+        sim->reg[ComIrqReg] |= SIM_IRQ_ERR;
+    }
+    else
+    {
+        sim->reg[CollReg] = (sim->reg[CollReg] & 0x80) | 0x20;
+    }
+
+    sim->reg[ComIrqReg] |= SIM_IRQ_RX | SIM_IRQ_TX;
+}
+
+/**
+ * @brief 流式接收: 把到当前时间为止收完的字节放入 FIFO, FIFO 满时溢出
+ */
+static void sim_rx_stream(struct rc522_sim_t *sim, uint64_t until_ns)
+{
+    uint32_t byte_ns = sim_byte_ns(sim_rx_br(sim));
+
+    while (sim->rx_pos < sim->rx_bits / 8 && sim->rx_first_ns + (uint64_t)(sim->rx_pos + 1) * byte_ns <= until_ns)
+        sim_fifo_push(sim, sim->rx_buf[sim->rx_pos++]);
+}
+
+static void sim_tx_advance(struct rc522_sim_t *sim);
+
+static void sim_advance(struct rc522_sim_t *sim)
+{
+    uint8_t i;
+
+    for (i = 0; i < sim->n_script;)
+    {
+        struct sim_event_t *ev = &sim->script[i];
+
+        if (ev->at_ns <= sim->now_ns)
+        {
+            rc522_sim_card_present(sim, ev->card, ev->present);
+            memmove(ev, ev + 1, (sim->n_script - i - 1) * sizeof(*ev));
+            sim->n_script--;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if (sim->op == SIM_OP_TX)
+        sim_tx_advance(sim);
+
+    /* 应答开始时定时器已停止 */
+    if (sim->op == SIM_OP_RX && sim->rx_stream && sim->timer_at_ns == 0)
+        sim_rx_stream(sim, (sim->now_ns < sim->op_at_ns) ? sim->now_ns : sim->op_at_ns);
+
+    if (sim->op != SIM_OP_NONE && sim->op_at_ns <= sim->now_ns &&
+        (sim->timer_at_ns == 0 || sim->op_at_ns < sim->timer_at_ns))
+    {
+        sim->timer_at_ns = 0;
+        if (sim->op == SIM_OP_RX && sim->rx_stream)
+        {
+            sim_rx_stream(sim, sim->op_at_ns);
+            sim->reg[ControlReg] &= ~0x07;
+            sim->reg[CollReg] = (sim->reg[CollReg] & 0x80) | 0x20;
+            sim->reg[ComIrqReg] |= SIM_IRQ_RX | SIM_IRQ_TX;
+        }
+        else if (sim->op == SIM_OP_RX)
+        {
+            sim_deliver_rx(sim);
+        }
+        else
+        {
+            sim->reg[Status2Reg] |= 0x08; //MFCrypto1On
+            sim->reg[ComIrqReg] |= SIM_IRQ_IDLE | SIM_IRQ_TX;
+            sim->reg[CommandReg] = (sim->reg[CommandReg] & 0xF0) | PCD_IDLE;
+        }
+        sim->op = SIM_OP_NONE;
+    }
+
+    if (sim->timer_at_ns && sim->timer_at_ns <= sim->now_ns)
+    {
+        sim->timer_at_ns = 0;
+        sim->op = SIM_OP_NONE;
+        sim->reg[ComIrqReg] |= SIM_IRQ_TIMER | SIM_IRQ_TX;
+    }
+}
+
+/**
+ * @brief 取出当前帧要注入的故障
+ *
+ * @return SIM_FAULT_*, 0 表示无故障
+ */
+static uint8_t sim_fault_take(struct rc522_sim_t *sim)
+{
+    for (uint8_t i = 0; i < sim->n_faults; i++)
+    {
+        uint8_t type = sim->faults[i].type;
+
+        if (sim->faults[i].frame != sim->stats.rf_frames)
+            continue;
+
+        memmove(&sim->faults[i], &sim->faults[i + 1], (sim->n_faults - i - 1) * sizeof(sim->faults[0]));
+        sim->n_faults--;
+        sim->stats.faults++;
+        return type;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 发送结束: 收集场内所有卡片的应答并合成冲突
+ */
+static void sim_tx_end(struct rc522_sim_t *sim)
+{
+    uint8_t resp[SIM_MAX_FRAME], *tx = sim->tx_buf, last = sim->reg[BitFramingReg] & 0x07, fault;
+    uint16_t tx_bits, resp_bits = 0, n = 0, i;
+    uint32_t delay_ns, max_delay = 0;
+    uint64_t tx_end;
+
+    tx_bits = (sim->tx_len - 1) * 8 + (last ? last : 8);
+    sim->op = SIM_OP_NONE;
+    sim->stats.rf_frames++;
+    fault = sim_fault_take(sim);
+
+    tx_end = sim->tx_start_ns + sim_air_ns(tx_bits, sim_tx_br(sim));
+    sim->reg[ComIrqReg] |= SIM_IRQ_TX;
+    if (sim->reg[TModeReg] & 0x80)
+        sim_timer_start(sim, tx_end);
+
+    sim->rx_coll = -1;
+    memset(sim->rx_buf, 0, sizeof(sim->rx_buf));
+
+    for (i = 0; i < sim->n_cards && sim_field_ready(sim, sim->tx_start_ns); i++)
+    {
+        struct sim_card_t *card = &sim->cards[i];
+        uint16_t bits = 0, b;
+
+        /* 速率不符的卡片收不到 */
+        if (!card->present || card->br_pcd != sim_tx_br(sim) || card->br_picc != sim_rx_br(sim))
+            continue;
+
+        memset(resp, 0, sizeof(resp));
+        if (!sim_card_frame(sim, card, tx, tx_bits, resp, &bits, &delay_ns))
+            continue;
+
+        if (n == 0)
+        {
+            memcpy(sim->rx_buf, resp, sizeof(resp));
+            resp_bits = bits;
+        }
+        else
+        {
+            for (b = 0; b < bits && b < resp_bits; b++)
+            {
+                if (bit_get(resp, b) != bit_get(sim->rx_buf, b) &&
+                    (sim->rx_coll < 0 || b < sim->rx_coll))
+                    sim->rx_coll = b;
+            }
+        }
+        if (delay_ns > max_delay)
+            max_delay = delay_ns;
+        n++;
+    }
+
+    /* 卡片状态照常推进, 只有空中的应答受影响 */
+    if (n && fault == SIM_FAULT_MUTE)
+        n = 0;
+    else if (n && fault == SIM_FAULT_CRC)
+        sim->rx_buf[0] ^= 0x03;
+    else if (n && fault == SIM_FAULT_COLL && resp_bits > 3 && (sim->rx_coll < 0 || sim->rx_coll > 3))
+        sim->rx_coll = 3;
+
+    if (n)
+    {
+        sim->rx_bits = resp_bits;
+        sim->rx_stream = sim->rx_coll < 0 && !(resp_bits & 7) && !(sim->reg[BitFramingReg] & 0x70);
+        sim->rx_pos = 0;
+        sim->rx_first_ns = tx_end + max_delay + (SIM_ETU_NS >> sim_rx_br(sim));
+        sim->op = SIM_OP_RX;
+        sim->op_at_ns = tx_end + max_delay + sim_air_ns(resp_bits, sim_rx_br(sim));
+        /* 收到首位后定时器停止 */
+        if (sim->timer_at_ns && tx_end + max_delay < sim->timer_at_ns)
+            sim->timer_at_ns = 0;
+    }
+}
+
+/**
+ * @brief 发送器在每个字节时间从 FIFO 取下一字节; 取空时帧结束, 来不及补充的数据不再发送
+ */
+static void sim_tx_advance(struct rc522_sim_t *sim)
+{
+    while (sim->op == SIM_OP_TX && sim->op_at_ns <= sim->now_ns)
+    {
+        if (sim->fifo_len == 0)
+        {
+            sim_tx_end(sim);
+            break;
+        }
+
+        if (sim->tx_len < sizeof(sim->tx_buf))
+            sim->tx_buf[sim->tx_len++] = sim_fifo_pop(sim);
+        else
+            sim_fifo_pop(sim);
+        sim->op_at_ns += sim_byte_ns(sim_tx_br(sim));
+    }
+}
+
+/**
+ * @brief StartSend: 开始发送 FIFO 中的数据
+ */
+static void sim_transceive(struct rc522_sim_t *sim)
+{
+    if (sim->fifo_len == 0)
+        return;
+
+    sim->reg[ErrorReg] = 0;
+    sim->tx_len = 0;
+    sim->tx_start_ns = sim->now_ns;
+    sim->op = SIM_OP_TX;
+    sim->op_at_ns = sim->now_ns;
+    sim_tx_advance(sim);
+}
+
+/**
+ * @brief MFAuthent: FIFO 中为 认证模式, 块地址, 6字节密钥, 4字节卡号
+ */
+static void sim_authent(struct rc522_sim_t *sim)
+{
+    uint8_t buf[12];
+    uint64_t tx_end;
+
+    if (sim->fifo_len < 12)
+        return;
+
+    memcpy(buf, sim->fifo, 12);
+    sim->fifo_len = 0;
+    sim->reg[ErrorReg] = 0;
+    sim->stats.rf_frames++;
+
+    tx_end = sim->now_ns + sim_air_ns(4 * 8, sim_tx_br(sim));
+    if (sim->reg[TModeReg] & 0x80)
+        sim_timer_start(sim, tx_end);
+
+    if (sim_fault_take(sim))
+        return;
+
+    for (uint8_t i = 0; i < sim->n_cards && sim_field_ready(sim, sim->now_ns); i++)
+    {
+        struct sim_card_t *card = &sim->cards[i];
+        const uint8_t *trailer;
+
+        if (!card->present || card->state != SIM_CARD_ACTIVE || buf[1] >= 64)
+            continue;
+        if (memcmp(&buf[8], &card->uid[card->uid_len - 4], 4))
+            continue;
+
+        trailer = &card->mem[(buf[1] / 4 * 4 + 3) * 16];
+        if (memcmp(&buf[2], (buf[0] == PICC_AUTHENT1A) ? trailer : &trailer[10], 6))
+        {
+            sim_card_power_off(card);
+            return;
+        }
+
+        card->authed = buf[1] / 4 + 1;
+        sim->op = SIM_OP_AUTH;
+        sim->op_at_ns = tx_end + sim->timing.auth_ns;
+        sim->timer_at_ns = 0;
+        return;
+    }
+}
+
+static void sim_calc_crc(struct rc522_sim_t *sim)
+{
+    uint16_t crc = rc522_sim_crc(sim->fifo, sim->fifo_len, sim_crc_preset(sim));
+
+    sim->fifo_len = 0;
+    sim->reg[CRCResultRegL] = crc & 0xFF;
+    sim->reg[CRCResultRegM] = crc >> 8;
+    sim->reg[DivIrqReg] |= SIM_DIVIRQ_CRC;
+}
+
+static void sim_command(struct rc522_sim_t *sim, uint8_t val)
+{
+    uint8_t cmd = val & 0x0F, pd = sim->reg[CommandReg] & 0x10;
+    int was_on = sim_antenna_on(sim);
+
+    sim->reg[CommandReg] = (val & 0x30) | cmd;
+
+    /* 软掉电: 振荡器停止, 天线场关闭, 寄存器与FIFO保持; 退出后 PowerDown 位保持到振荡器起振 */
+    if ((val & 0x10) != pd)
+    {
+        if (pd)
+        {
+            sim->stats.pd_ns += sim->now_ns - sim->pd_mark_ns;
+            sim->reset_until_ns = sim->now_ns + SIM_WAKE_NS;
+        }
+        else
+        {
+            sim->pd_mark_ns = sim->now_ns;
+            sim->timer_at_ns = 0;
+        }
+        sim_field_update(sim, was_on);
+    }
+
+    switch (cmd)
+    {
+    case PCD_IDLE:
+        sim->op = SIM_OP_NONE;
+        break;
+    case PCD_CALCCRC:
+        sim_calc_crc(sim);
+        break;
+    case PCD_AUTHENT:
+        sim_authent(sim);
+        break;
+    case PCD_RESETPHASE:
+        sim_soft_reset(sim);
+        break;
+    default:
+        break;
+    }
+}
+
+static uint8_t sim_irq_active(struct rc522_sim_t *sim)
+{
+    return (sim->reg[ComIrqReg] & sim->reg[ComIEnReg] & 0x7F) ||
+           (sim->reg[DivIrqReg] & sim->reg[DivlEnReg] & 0x14);
+}
+
+static uint8_t sim_reg_read(struct rc522_sim_t *sim, uint8_t reg)
+{
+    uint8_t val;
+
+    switch (reg)
+    {
+    case CommandReg:
+        val = sim->reg[CommandReg];
+        if (sim->now_ns < sim->reset_until_ns)
+            val |= 0x10;
+        return val;
+    case FIFODataReg:
+        return sim_fifo_pop(sim);
+    case FIFOLevelReg:
+        return sim->fifo_len;
+    case Status1Reg:
+        val = 0x20;
+        if (sim->fifo_len <= sim->reg[WaterLevelReg])
+            val |= 0x01;
+        if (64 - sim->fifo_len <= sim->reg[WaterLevelReg])
+            val |= 0x02;
+        if (sim->timer_at_ns)
+            val |= 0x08;
+        if (sim_irq_active(sim))
+            val |= 0x10;
+        return val;
+    default:
+        return sim->reg[reg & 0x3F];
+    }
+}
+
+static void sim_reg_write(struct rc522_sim_t *sim, uint8_t reg, uint8_t val)
+{
+    uint8_t old;
+
+    switch (reg)
+    {
+    case CommandReg:
+        sim_command(sim, val);
+        break;
+    case ComIrqReg:
+    case DivIrqReg:
+        if (val & 0x80)
+            sim->reg[reg] |= val & 0x7F;
+        else
+            sim->reg[reg] &= ~val;
+        break;
+    case FIFODataReg:
+        sim_fifo_push(sim, val);
+        break;
+    case FIFOLevelReg:
+        if (val & 0x80)
+        {
+            sim->fifo_len = 0;
+            sim->reg[ErrorReg] &= ~0x10;
+            sim_fifo_alert(sim);
+        }
+        break;
+    case ControlReg:
+        if (val & 0x80)
+            sim->timer_at_ns = 0;
+        if (val & 0x40)
+            sim_timer_start(sim, sim->now_ns);
+        break;
+    case BitFramingReg:
+        sim->reg[reg] = val;
+        if ((val & 0x80) && (sim->reg[CommandReg] & 0x0F) == PCD_TRANSCEIVE)
+            sim_transceive(sim);
+        break;
+    case TxControlReg:
+        old = sim_antenna_on(sim);
+        sim->reg[reg] = val;
+        sim_field_update(sim, old);
+        break;
+    case VersionReg:
+    case ErrorReg:
+    case Status1Reg:
+        break;
+    default:
+        sim->reg[reg & 0x3F] = val;
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//传输层
+///////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief 共用总线时, 进入传输层前跟上总线时间, 返回前把本芯片时间写回总线
+ */
+static void sim_bus_in(struct rc522_sim_t *sim)
+{
+    if (sim->bus_ns && *sim->bus_ns > sim->now_ns)
+    {
+        sim->now_ns = *sim->bus_ns;
+        sim_advance(sim);
+    }
+}
+
+static void sim_bus_out(struct rc522_sim_t *sim)
+{
+    if (sim->bus_ns)
+        *sim->bus_ns = sim->now_ns;
+}
+
+static void sim_spi_cost(struct rc522_sim_t *sim, uint32_t bytes)
+{
+    sim_bus_in(sim);
+    sim->stats.transactions++;
+    sim->stats.spi_bytes += bytes;
+    sim->now_ns += sim->timing.spi_cs_ns + (uint64_t)bytes * 8 * sim->timing.spi_bit_ns;
+    sim_advance(sim);
+    sim_bus_out(sim);
+}
+
+/**
+ * @brief FIFO 连续读写: 地址字节之后每个数据字节在自己的移位结束时访问, 发送/接收可同时进行
+ */
+static void sim_spi_burst_begin(struct rc522_sim_t *sim, uint32_t len)
+{
+    sim_bus_in(sim);
+    sim->stats.transactions++;
+    sim->stats.spi_bytes += len + 1;
+    sim->now_ns += sim->timing.spi_cs_ns + 8 * sim->timing.spi_bit_ns;
+    sim_advance(sim);
+}
+
+static void sim_spi_burst_byte(struct rc522_sim_t *sim)
+{
+    sim->now_ns += 8 * sim->timing.spi_bit_ns;
+    sim_advance(sim);
+}
+
+/**
+ * @brief MISO 线上的数据: 时钟超过接线上限时采样晚一位
+ */
+static uint8_t sim_miso(struct rc522_sim_t *sim, uint8_t val)
+{
+    return (sim->max_clk_hz && sim->clk_hz > sim->max_clk_hz) ? (val >> 1) : val;
+}
+
+static uint8_t sim_port_read_reg(void *priv, uint8_t reg)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_spi_cost(sim, 2);
+    sim->stats.reg_reads++;
+
+    return sim->dead ? 0x00 : sim_miso(sim, sim_reg_read(sim, reg & 0x3F));
+}
+
+static void sim_port_write_reg(void *priv, uint8_t reg, uint8_t val)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_spi_cost(sim, 2);
+    sim->stats.reg_writes++;
+    if (!sim->dead)
+        sim_reg_write(sim, reg & 0x3F, val);
+}
+
+static void sim_port_read_burst(void *priv, uint8_t reg, uint8_t *buf, uint8_t len)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_spi_burst_begin(sim, len);
+    sim->stats.reg_reads += len;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        sim_spi_burst_byte(sim);
+        buf[i] = sim->dead ? 0x00 : sim_miso(sim, sim_reg_read(sim, reg & 0x3F));
+    }
+    sim_bus_out(sim);
+}
+
+static void sim_port_write_burst(void *priv, uint8_t reg, const uint8_t *buf, uint8_t len)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_spi_burst_begin(sim, len);
+    sim->stats.reg_writes += len;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        sim_spi_burst_byte(sim);
+        if (!sim->dead)
+            sim_reg_write(sim, reg & 0x3F, buf[i]);
+    }
+    sim_bus_out(sim);
+}
+
+static void sim_port_delay_us(void *priv, uint32_t us)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_bus_in(sim);
+    sim->now_ns += (uint64_t)us * 1000;
+    sim_advance(sim);
+    sim_bus_out(sim);
+}
+
+static uint64_t sim_port_time_us(void *priv)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_bus_in(sim);
+
+    return sim->now_ns / 1000;
+}
+
+static int sim_port_irq_level(void *priv)
+{
+    struct rc522_sim_t *sim = priv;
+    int active;
+
+    sim_bus_in(sim);
+    sim_advance(sim);
+    active = !sim->dead && sim_irq_active(sim);
+
+    /* IRqInv 置位时低电平有效 */
+    return (sim->reg[ComIEnReg] & 0x80) ? !active : active;
+}
+
+/**
+ * @brief 仿真时间直接跳到下一个事件, 期间没有SPI访问
+ */
+static int sim_port_wait_irq(void *priv, uint32_t timeout_us)
+{
+    struct rc522_sim_t *sim = priv;
+    uint64_t deadline;
+
+    sim_bus_in(sim);
+    deadline = sim->now_ns + (uint64_t)timeout_us * 1000;
+    if (sim->dead)
+    {
+        sim->now_ns = deadline;
+        sim_bus_out(sim);
+        return 0;
+    }
+
+    sim_advance(sim);
+    while (!sim_irq_active(sim))
+    {
+        uint64_t next = deadline;
+
+        if (sim->op != SIM_OP_NONE && sim->op_at_ns < next)
+            next = sim->op_at_ns;
+        if (sim->op == SIM_OP_RX && sim->rx_stream && sim->timer_at_ns == 0 && sim->rx_pos < sim->rx_bits / 8)
+        {
+            uint64_t at = sim->rx_first_ns + (uint64_t)(sim->rx_pos + 1) * sim_byte_ns(sim_rx_br(sim));
+
+            if (at < next)
+                next = at;
+        }
+        if (sim->timer_at_ns && sim->timer_at_ns < next)
+            next = sim->timer_at_ns;
+        for (uint8_t i = 0; i < sim->n_script; i++)
+        {
+            if (sim->script[i].at_ns < next)
+                next = sim->script[i].at_ns;
+        }
+
+        if (next > sim->now_ns)
+            sim->now_ns = next;
+        sim_advance(sim);
+
+        if (sim->now_ns >= deadline && !sim_irq_active(sim))
+        {
+            sim_bus_out(sim);
+            return 0;
+        }
+    }
+
+    sim->stats.irq_waits++;
+    sim_bus_out(sim);
+
+    return 1;
+}
+
+int rc522_sim_fault(struct rc522_sim_t *sim, uint32_t frame, uint8_t type)
+{
+    if (sim->n_faults >= SIM_MAX_FAULTS)
+        return -1;
+
+    sim->faults[sim->n_faults].frame = frame;
+    sim->faults[sim->n_faults].type = type;
+    sim->n_faults++;
+
+    return 0;
+}
+
+void rc522_sim_wire_irq(struct rc522_sim_t *sim, uint8_t wired)
+{
+    sim->port.irq_level = wired ? sim_port_irq_level : NULL;
+    sim->port.wait_irq = wired ? sim_port_wait_irq : NULL;
+}
+
+static uint32_t sim_port_set_clk_hz(void *priv, uint32_t hz)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim->clk_hz = hz;
+    sim->timing.spi_bit_ns = 1000000000UL / hz;
+
+    return hz;
+}
+
+static void sim_port_hard_reset(void *priv)
+{
+    struct rc522_sim_t *sim = priv;
+
+    sim_bus_in(sim);
+    sim->now_ns += 10 * 1000 * 1000;
+    sim_soft_reset(sim);
+    sim_bus_out(sim);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void rc522_sim_init(struct rc522_sim_t *sim)
+{
+    memset(sim, 0, sizeof(*sim));
+    memcpy(sim->reg, sim_reg_default, sizeof(sim->reg));
+
+    rc522_sim_timing_bitbang(sim, 3);
+    sim->timing.fdt_ns = 86 * 1000;
+    sim->timing.auth_ns = 1000 * 1000;
+    sim->timing.write_ns = 2500 * 1000;
+
+    sim->port.read_reg = sim_port_read_reg;
+    sim->port.write_reg = sim_port_write_reg;
+    sim->port.read_burst = sim_port_read_burst;
+    sim->port.write_burst = sim_port_write_burst;
+    sim->port.delay_us = sim_port_delay_us;
+    sim->port.time_us = sim_port_time_us;
+    sim->port.hard_reset = sim_port_hard_reset;
+    sim->port.set_clk_hz = sim_port_set_clk_hz;
+    sim->port.priv = sim;
+    rc522_sim_wire_irq(sim, 0);
+}
+
+void rc522_sim_timing_bitbang(struct rc522_sim_t *sim, uint8_t clk_delay_us)
+{
+    /* 每位两次 usleep, 每次片选前后各 usleep(10), 另计约 0.5us 调用开销 */
+    sim->timing.spi_bit_ns = 2 * (clk_delay_us * 1000 + 500);
+    sim->timing.spi_cs_ns = 2 * (10 * 1000 + 500);
+    sim->clk_hz = 1000000000UL / sim->timing.spi_bit_ns;
+}
+
+void rc522_sim_timing_hwspi(struct rc522_sim_t *sim, uint32_t hz)
+{
+    sim->timing.spi_bit_ns = 1000000000UL / hz;
+    sim->timing.spi_cs_ns = 2000;
+    sim->clk_hz = hz;
+}
+
+void rc522_sim_timing_fastbb(struct rc522_sim_t *sim, uint32_t hz)
+{
+    /* 片选前后各等待至少100ns, 另计约0.4us调用开销 */
+    sim->timing.spi_bit_ns = 1000000000UL / hz;
+    sim->timing.spi_cs_ns = 2 * 100 + 400;
+    sim->clk_hz = hz;
+}
+
+int rc522_sim_add_card(struct rc522_sim_t *sim, const uint8_t *uid, uint8_t uid_len)
+{
+    struct sim_card_t *card;
+
+    if (sim->n_cards >= SIM_MAX_CARDS || (uid_len != 4 && uid_len != 7 && uid_len != 10))
+        return -1;
+
+    card = &sim->cards[sim->n_cards];
+    memset(card, 0, sizeof(*card));
+    memcpy(card->uid, uid, uid_len);
+    card->uid_len = uid_len;
+    /* ATQA 0x0004, bit7-6 为 UID 长度 */
+    card->atqa[0] = 0x04 | ((uid_len == 7) ? 0x40 : ((uid_len == 10) ? 0x80 : 0x00));
+    card->atqa[1] = 0x00;
+    card->sak = 0x08;
+    card->present = 1;
+    sim_card_power_off(card);
+
+    /* 厂商块 */
+    memcpy(card->mem, uid, uid_len);
+    for (uint8_t sector = 0; sector < 16; sector++)
+        memcpy(&card->mem[(sector * 4 + 3) * 16], sim_default_trailer, 16);
+
+    return sim->n_cards++;
+}
+
+int rc522_sim_set_ats(struct rc522_sim_t *sim, uint8_t card, const uint8_t *ats)
+{
+    if (card >= sim->n_cards || ats[0] < 1 || ats[0] > sizeof(sim->cards[card].ats))
+        return -1;
+
+    memcpy(sim->cards[card].ats, ats, ats[0]);
+    sim->cards[card].sak = 0x20;
+
+    return 0;
+}
+
+int rc522_sim_set_ul(struct rc522_sim_t *sim, uint8_t card, const uint8_t *version, uint16_t pages)
+{
+    struct sim_card_t *c = &sim->cards[card];
+    uint8_t *mem;
+
+    if (card >= sim->n_cards || c->uid_len != 7 || pages < 8 || pages * 4 > sizeof(c->mem) || pages > 256)
+        return -1;
+
+    memcpy(c->ul_version, version, sizeof(c->ul_version));
+    c->ul_pages = pages;
+    c->sak = 0x00;
+
+    /* 页0~2: UID 与两个 BCC, 页3: 能力容器 */
+    mem = c->mem;
+    memset(mem, 0, sizeof(c->mem));
+    memcpy(&mem[0], c->uid, 3);
+    mem[3] = PICC_CT ^ c->uid[0] ^ c->uid[1] ^ c->uid[2];
+    memcpy(&mem[4], &c->uid[3], 4);
+    mem[8] = c->uid[3] ^ c->uid[4] ^ c->uid[5] ^ c->uid[6];
+    mem[12] = 0xE1;
+    mem[13] = 0x10;
+    mem[14] = (pages - 9) / 2;
+
+    /* CFG0: AUTH0 = 0xFF, CFG1: ACCESS = 0, PWD 全 FF, PACK 为0 */
+    mem = &c->mem[(pages - 4) * 4];
+    mem[0] = 0x04;
+    mem[3] = 0xFF;
+    memset(&mem[8], 0xFF, 4);
+
+    return 0;
+}
+
+void rc522_sim_card_present(struct rc522_sim_t *sim, uint8_t card, uint8_t present)
+{
+    if (card >= sim->n_cards)
+        return;
+
+    sim->cards[card].present = present;
+    if (!present)
+        sim_card_power_off(&sim->cards[card]);
+}
+
+int rc522_sim_schedule(struct rc522_sim_t *sim, uint64_t at_ns, uint8_t card, uint8_t present)
+{
+    if (sim->n_script >= SIM_MAX_SCRIPT)
+        return -1;
+
+    sim->script[sim->n_script].at_ns = at_ns;
+    sim->script[sim->n_script].card = card;
+    sim->script[sim->n_script].present = present;
+    sim->n_script++;
+
+    return 0;
+}
+
+void rc522_sim_attach_bus(struct rc522_sim_t *sim, uint64_t *bus_ns)
+{
+    sim->bus_ns = bus_ns;
+    if (*bus_ns < sim->now_ns)
+        *bus_ns = sim->now_ns;
+}
+
+const struct rfid_port_t *rc522_sim_port(struct rc522_sim_t *sim)
+{
+    return &sim->port;
+}
+
+void rc522_sim_reset_stats(struct rc522_sim_t *sim)
+{
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    sim->rf_mark_ns = sim->now_ns;
+    sim->pd_mark_ns = sim->now_ns;
+}
+
+void rc522_sim_power_time(struct rc522_sim_t *sim, uint64_t *rf_on_ns, uint64_t *pd_ns)
+{
+    *rf_on_ns = sim->stats.rf_on_ns;
+    if (sim_antenna_on(sim))
+        *rf_on_ns += sim->now_ns - sim->rf_mark_ns;
+
+    *pd_ns = sim->stats.pd_ns;
+    if (sim->reg[CommandReg] & 0x10)
+        *pd_ns += sim->now_ns - sim->pd_mark_ns;
+}
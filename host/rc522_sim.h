@@ -0,0 +1,269 @@
+#ifndef __RC522_SIM_H__
+#define __RC522_SIM_H__
+
+#include <stdint.h>
+
+#include "rfid_port.h"
+
+/* clang-format off */
+#define SIM_MAX_CARDS           (8)
+#define SIM_MAX_SCRIPT          (64)
+#define SIM_MAX_FAULTS          (16)
+#define SIM_MAX_FRAME           (260)   //一帧最多字节数, ISO14443-4 FSD 上限256加余量
+
+#define SIM_CARD_IDLE           (0)
+#define SIM_CARD_READY          (1)
+#define SIM_CARD_ACTIVE         (2)
+#define SIM_CARD_HALT           (3)
+#define SIM_CARD_L4             (4)    //RATS 之后, 只接受 ISO14443-4 块
+
+#define SIM_OP_NONE             (0)
+#define SIM_OP_RX               (1)    //收发命令等待卡片应答
+#define SIM_OP_AUTH             (2)    //MFAuthent 等待认证完成
+#define SIM_OP_TX               (3)    //发送中, 按空中速率从 FIFO 取字节, 取空时帧结束
+
+#define SIM_FAULT_CRC           (1)    //应答首字节翻转两位, 奇偶校验正确而 CRC_A 错误
+#define SIM_FAULT_COLL          (2)    //应答第4位起受干扰, 按位冲突上报
+#define SIM_FAULT_MUTE          (3)    //应答丢失, 认证帧上的任何故障均按此处理
+/* clang-format on */
+
+/**
+ * @brief 虚拟 ISO14443A 卡片, 默认为 Mifare_One(S50)
+ */
+struct sim_card_t
+{
+    uint8_t uid[10];
+    uint8_t uid_len;    /* 4, 7 或 10 */
+    uint8_t atqa[2];    /* 空中发送顺序 */
+    uint8_t sak;
+    uint8_t present;    /* 是否在天线场内 */
+    uint8_t state;      /* SIM_CARD_* */
+    uint8_t level;      /* 当前级联层 1~3 */
+    uint8_t authed;     /* 已认证扇区号 + 1, 0 表示未认证 */
+    int16_t write_addr; /* 两阶段写等待数据的块号, -1 表示无 */
+    int16_t value_addr; /* 值操作等待操作数的块号, -1 表示无 */
+    uint8_t value_cmd;  /* 等待操作数的值操作命令 */
+    uint8_t value_ok;   /* 内部缓冲区有效, 可以传送 */
+    uint8_t value_src;  /* 缓冲区来源块号, 传送时写入地址字节 */
+    int32_t value_buf;  /* 内部缓冲区 */
+    uint32_t fdt_ns;    /* 帧等待时间, 0 使用 timing.fdt_ns */
+    uint8_t mem[1024];
+
+    /* ISO14443-4, 见 rc522_sim_set_ats */
+    uint8_t ats[16];    /* ats[0] 为长度, 0 表示不支持 */
+    uint8_t br_pcd;     /* 读卡器到卡片的速率 RFID_BR_* */
+    uint8_t br_picc;    /* 卡片到读卡器的速率 */
+    uint8_t pps_ok;     /* ATS 之后第一帧才可以是 PPS */
+    uint8_t bn;         /* 卡片当前块号 */
+    uint16_t fsd;       /* 读卡器可接收的最大帧长 */
+    uint8_t last[SIM_MAX_FRAME]; /* 上一个发出的块, 不含CRC, 供重发 */
+    uint16_t last_len;
+    uint8_t wtx;        /* 已发 S(WTX), 等待读卡器应答后再给出结果 */
+    uint8_t apdu[272];  /* 链接收集中的命令APDU */
+    uint16_t apdu_len;
+    uint8_t rsp[272];   /* 待发送的应答APDU */
+    uint16_t rsp_len;
+    uint16_t rsp_off;
+    uint32_t proc_ns;   /* 当前APDU的处理时间 */
+
+    /* Ultralight/NTAG, 见 rc522_sim_set_ul; mem 按页(4字节)组织 */
+    uint16_t ul_pages;  /* 总页数, 0 表示不是 Ultralight/NTAG */
+    uint8_t ul_version[8]; /* GET_VERSION 应答 */
+    uint8_t ul_authed;  /* 已通过 PWD_AUTH */
+};
+
+/**
+ * @brief 时间模型参数, 单位 ns
+ */
+struct sim_timing_t
+{
+    uint32_t spi_bit_ns; /* SPI 每位时间 */
+    uint32_t spi_cs_ns;  /* 每次片选的固定开销 */
+    uint32_t fdt_ns;     /* 卡片帧等待时间 */
+    uint32_t auth_ns;    /* 三次认证耗时 */
+    uint32_t write_ns;   /* EEPROM 写入耗时 */
+    uint32_t picc_boot_ns; /* 天线场开启后卡片上电复位的时间, 其间不应答; 默认0 */
+};
+
+struct sim_stats_t
+{
+    uint32_t transactions; /* SPI 片选次数 */
+    uint32_t spi_bytes;
+    uint32_t reg_reads;
+    uint32_t reg_writes;
+    uint32_t rf_frames;
+    uint32_t irq_waits; /* 经IRQ引脚唤醒的次数 */
+    uint32_t faults;    /* 已注入的故障数 */
+    uint64_t rf_on_ns;  /* 天线场开启时间, 见 rc522_sim_power_time */
+    uint64_t pd_ns;     /* 软掉电时间 */
+};
+
+struct sim_event_t
+{
+    uint64_t at_ns;
+    uint8_t card;
+    uint8_t present;
+};
+
+struct sim_fault_t
+{
+    uint32_t frame; /* stats.rf_frames 计到该值的一帧 */
+    uint8_t type;   /* SIM_FAULT_* */
+};
+
+struct rc522_sim_t
+{
+    uint8_t reg[0x40];
+    uint8_t fifo[64];
+    uint8_t fifo_len;
+
+    uint64_t now_ns;
+    uint64_t reset_until_ns; /* 软复位期间 PowerDown 位保持置位 */
+    uint64_t field_on_ns;    /* 天线场最近一次开启的时间 */
+    uint64_t rf_mark_ns;     /* stats.rf_on_ns 已累计到的时间 */
+    uint64_t pd_mark_ns;     /* stats.pd_ns 已累计到的时间 */
+    uint64_t timer_at_ns;    /* 定时器到期时间, 0 表示未运行 */
+    uint64_t timer_period_ns;
+    uint64_t op_at_ns;
+    uint8_t op;
+
+    /* 发送中的帧 */
+    uint8_t tx_buf[SIM_MAX_FRAME];
+    uint16_t tx_len;
+    uint64_t tx_start_ns;
+
+    /* 待接收的应答, 按空中顺序低位在前 */
+    uint8_t rx_buf[SIM_MAX_FRAME];
+    uint16_t rx_bits;
+    int16_t rx_coll;     /* 第一个冲突位, -1 表示无冲突 */
+    uint8_t rx_stream;   /* 整字节且无冲突: 逐字节进入 FIFO, 超过 FIFO 容量须及时取出 */
+    uint16_t rx_pos;     /* 已进入 FIFO 的字节数 */
+    uint64_t rx_first_ns; /* 起始位结束时间, 第k字节在其后 (k+1) 个字节时间进入 FIFO */
+
+    struct sim_card_t cards[SIM_MAX_CARDS];
+    uint8_t n_cards;
+    struct sim_event_t script[SIM_MAX_SCRIPT];
+    uint8_t n_script;
+    struct sim_fault_t faults[SIM_MAX_FAULTS];
+    uint8_t n_faults;
+
+    struct sim_timing_t timing;
+    struct sim_stats_t stats;
+    struct rfid_port_t port;
+
+    uint64_t *bus_ns; /* 共用SPI总线的仿真时钟, NULL 表示独立 */
+    uint8_t dead;     /* 芯片无响应: MISO 恒为低, 写入无效, IRQ 引脚不动作 */
+
+    uint32_t clk_hz;     /* 当前SPI时钟 */
+    uint32_t max_clk_hz; /* 接线允许的最高SPI时钟, 超过时MISO采样错后一位; 0 不限 */
+};
+
+/**
+ * @brief 初始化仿真芯片, 默认使用 clk_delay_us = 3 的软件 SPI 时间模型
+ */
+void rc522_sim_init(struct rc522_sim_t *sim);
+
+/**
+ * @brief 软件 SPI 时间模型
+ *
+ * @param [in], clk_delay_us: 与 rfid_io_cfg_t.clk_delay_us 相同
+ */
+void rc522_sim_timing_bitbang(struct rc522_sim_t *sim, uint8_t clk_delay_us);
+
+/**
+ * @brief 硬件 SPI 时间模型
+ *
+ * @param [in], hz: SPI 时钟频率
+ */
+void rc522_sim_timing_hwspi(struct rc522_sim_t *sim, uint32_t hz);
+
+/**
+ * @brief 高速软件 SPI(RFID_IO_GPIOHS_FAST) 时间模型, 之后可经 port.set_clk_hz 调整
+ *
+ * @param [in], hz: 位时钟频率
+ */
+void rc522_sim_timing_fastbb(struct rc522_sim_t *sim, uint32_t hz);
+
+/**
+ * @brief 添加一张 Mifare_One(S50) 卡片, 密钥全 FF
+ *
+ * @param [in], uid: 卡号
+ * @param [in], uid_len: 卡号长度, 4, 7 或 10
+ *
+ * @return 卡片索引, 失败返回 -1
+ */
+int rc522_sim_add_card(struct rc522_sim_t *sim, const uint8_t *uid, uint8_t uid_len);
+
+/**
+ * @brief 令卡片支持 ISO14443-4: SAK 置为 0x20, RATS 返回 ats
+ *
+ * @param [in], ats: ATS, ats[0] 为长度字节 TL, 不超过 16
+ *
+ * @note 应用层实现 READ BINARY(00 B0) 与 UPDATE BINARY(00 D6), 文件即 mem[];
+ *       写入按每16字节 timing.write_ns 计处理时间, 超过卡片 FWT 时以 S(WTX) 请求延长
+ */
+int rc522_sim_set_ats(struct rc522_sim_t *sim, uint8_t card, const uint8_t *ats);
+
+/**
+ * @brief 令卡片成为 Ultralight EV1/NTAG21x: SAK 置为 0x00, mem 按页组织, 最后4页为 CFG0/CFG1/PWD/PACK,
+ *        出厂时 AUTH0 为 0xFF(不保护), PWD 全 FF, PACK 为0
+ *
+ * @param [in], version: GET_VERSION 的8字节应答
+ * @param [in], pages: 总页数, 不超过256, 卡号须为7字节
+ *
+ * @note 实现 GET_VERSION, READ, FAST_READ, WRITE, COMPATIBILITY_WRITE 与 PWD_AUTH; 页2/3 的写入按位或;
+ *       应答超过 SIM_MAX_FRAME 的 FAST_READ 按页地址无效处理
+ */
+int rc522_sim_set_ul(struct rc522_sim_t *sim, uint8_t card, const uint8_t *version, uint16_t pages);
+
+/**
+ * @brief 立即移入/移出天线场
+ */
+void rc522_sim_card_present(struct rc522_sim_t *sim, uint8_t card, uint8_t present);
+
+/**
+ * @brief 在仿真时间 at_ns 时移入/移出天线场
+ *
+ * @return 0 成功, -1 脚本已满
+ */
+int rc522_sim_schedule(struct rc522_sim_t *sim, uint64_t at_ns, uint8_t card, uint8_t present);
+
+/**
+ * @brief 在第 frame 个射频帧(按 stats.rf_frames 计, 从1开始)的应答上注入故障
+ *
+ * @param [in], type: SIM_FAULT_*
+ *
+ * @return 0 成功, -1 故障表已满
+ */
+int rc522_sim_fault(struct rc522_sim_t *sim, uint32_t frame, uint8_t type);
+
+/**
+ * @brief 连接/断开 IRQ 引脚, 连接后驱动休眠等待而不轮询 ComIrqReg
+ */
+void rc522_sim_wire_irq(struct rc522_sim_t *sim, uint8_t wired);
+
+/**
+ * @brief 多片芯片共用一条SPI总线: 各自的仿真时间统一由 bus_ns 推进, 访问任一芯片都占用总线时间
+ *
+ * @param [in], bus_ns: 总线时钟, 各芯片须指向同一变量
+ */
+void rc522_sim_attach_bus(struct rc522_sim_t *sim, uint64_t *bus_ns);
+
+/**
+ * @brief 获取绑定到本仿真芯片的传输层
+ */
+const struct rfid_port_t *rc522_sim_port(struct rc522_sim_t *sim);
+
+void rc522_sim_reset_stats(struct rc522_sim_t *sim);
+
+/**
+ * @brief 自上次 rc522_sim_reset_stats 起天线场开启与芯片软掉电的累计时间, 含进行中的一段, 用于估算平均电流
+ */
+void rc522_sim_power_time(struct rc522_sim_t *sim, uint64_t *rf_on_ns, uint64_t *pd_ns);
+
+/**
+ * @brief CRC_A 位串行参考实现, 与芯片 CRC 协处理器一致
+ */
+uint16_t rc522_sim_crc(const uint8_t *data, uint32_t len, uint16_t preset);
+
+#endif /* __RC522_SIM_H__ */
@@ -0,0 +1,1272 @@
+/**
+ * 主机端基准程序: 在仿真 RC522 上运行 rfid.c, 统计每个操作的 SPI 事务数与模型耗时
+ *
+ * 编译:
+ *   gcc -O2 -Isrc -Ihost src/rfid.c src/rfid_poll.c src/rfid_auth.c src/rfid_engine.c src/rfid_isodep.c \
+ *       src/rfid_ultralight.c host/rc522_sim.c host/rfid_bench.c -pthread -o rfid_bench
+ *
+ * 用法:
+ *   ./rfid_bench [bitbang|hwspi] [irq]    单卡操作后枚举场内多张卡
+ *   ./rfid_bench [bitbang|hwspi] [irq] poll    轮询引擎: 卡片按脚本进出天线场, 统计事件延迟
+ *   ./rfid_bench [bitbang|hwspi] [irq] multi   4个读卡器共用SPI总线轮流寻卡, 其中一个无响应
+ *   ./rfid_bench [bitbang|hwspi] [irq] engine  射频引擎在独立线程运行, 经无锁环交换事件与读写命令
+ *   ./rfid_bench [bitbang|hwspi] [irq] async   非阻塞读块, 统计轮询间隙归还给应用的时间
+ *   ./rfid_bench [bitbang|hwspi] [irq] isodep  ISO14443-4: 各速率与 FSD 下的 RATS/PPS, 256 字节读与 200 字节写, WTX 及出错重发
+ *   ./rfid_bench [bitbang|hwspi] [irq] ntag    NTAG216: 型号识别, READ 与 FAST_READ 读全卡, 写页与密码保护
+ *   ./rfid_bench [bitbang|hwspi] [irq] boot    上电到第一次寻卡成功的时间: 原有初始化序列与 PcdInit 比较
+ *   ./rfid_bench [bitbang|hwspi] [irq] lowpower  低功耗探测: 天线常开与各唤醒周期的天线场开启时间, 平均电流与检测延迟
+ *   ./rfid_bench fastbb     高速软件 SPI: 校准出接线允许的最高时钟后执行单卡操作
+ *   ./rfid_bench crc        校验软件 CRC_A 与芯片 CRC 协处理器结果一致
+ *
+ * 以 -DRFID_CFG_STATS=1 编译时, 单卡操作后打印驱动的性能计数与帧耗时直方图, 并与仿真器的SPI计数核对
+ * 以 -DRFID_CFG_TRACE=1 编译时, 输出寻卡到读块的跟踪环, 可用 host/rfid_trace.c 解码
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rfid.h"
+#include "rfid_poll.h"
+#include "rfid_auth.h"
+#include "rfid_engine.h"
+#include "rfid_isodep.h"
+#include "rfid_ultralight.h"
+#include "rc522_sim.h"
+
+static struct rc522_sim_t sim;
+static struct rfid_reader_t reader;
+
+struct bench_snap_t
+{
+    struct sim_stats_t stats;
+    uint64_t now_ns;
+};
+
+static void bench_begin(struct bench_snap_t *snap)
+{
+    snap->stats = sim.stats;
+    snap->now_ns = sim.now_ns;
+}
+
+static void bench_end(const struct bench_snap_t *snap, const char *name, uint8_t status)
+{
+    printf("%-14s %-6s %6u %6u %8u %6u %6u %10.1f\r\n", name,
+           (status == MI_OK) ? "OK" : ((status == MI_NOTAGERR) ? "NOTAG" : "ERR"),
+           sim.stats.rf_frames - snap->stats.rf_frames,
+           sim.stats.transactions - snap->stats.transactions,
+           sim.stats.spi_bytes - snap->stats.spi_bytes,
+           sim.stats.reg_reads - snap->stats.reg_reads,
+           sim.stats.reg_writes - snap->stats.reg_writes,
+           (sim.now_ns - snap->now_ns) / 1000.0);
+}
+
+#if RFID_CFG_STATS
+/* 驱动计数的起点, PcdCalibrateClock 直接访问传输层, 不计入 */
+static struct sim_stats_t stats_base;
+
+static int bench_stats(void)
+{
+    static const char *const names[RFID_OP_MAX] = {
+        "request", "anticoll", "select", "auth", "read", "write", "write_data", "halt", "value", "value_data",
+        "transfer", "isodep"};
+    struct rfid_stats_t st;
+    uint8_t i, j;
+
+    PcdGetStats(&reader, &st);
+
+    printf("\r\n%-11s %6s %6s %6s %5s %5s %5s %8s %6s %7s  hist(<%u<<i us)\r\n", "op", "frames", "ok", "notag",
+           "coll", "err", "tmo", "spi", "polls", "max(us)", RFID_STATS_HIST_BASE_US);
+    for (i = 0; i < RFID_OP_MAX; i++)
+    {
+        const struct rfid_op_stats_t *op = &st.op[i];
+
+        if (op->frames == 0)
+            continue;
+        printf("%-11s %6u %6u %6u %5u %5u %5u %8u %6u %7u ", names[i], op->frames, op->ok, op->notag, op->coll,
+               op->err, op->timeouts, op->spi_bytes, op->irq_polls, op->max_us);
+        for (j = 0; j < RFID_STATS_HIST_LEN; j++)
+            printf(" %u", op->hist[j]);
+        printf("\r\n");
+    }
+    printf("spi %u bytes, %u reads, %u writes, %u shadow hits, %u irq polls, %u irq sleeps\r\n", st.spi_bytes,
+           st.reg_reads, st.reg_writes, st.shadow_hits, st.irq_polls, st.irq_sleeps);
+
+    if ((st.spi_bytes != sim.stats.spi_bytes - stats_base.spi_bytes) ||
+        (st.reg_reads != sim.stats.reg_reads - stats_base.reg_reads) ||
+        (st.reg_writes != sim.stats.reg_writes - stats_base.reg_writes))
+    {
+        printf("stats mismatch: sim %u bytes, %u reads, %u writes\r\n", sim.stats.spi_bytes - stats_base.spi_bytes,
+               sim.stats.reg_reads - stats_base.reg_reads, sim.stats.reg_writes - stats_base.reg_writes);
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * @brief 经传输层直接驱动芯片 CRC 协处理器
+ */
+static void bench_chip_crc(const struct rfid_port_t *port, const uint8_t *data, uint8_t len, uint8_t *out)
+{
+    port->write_reg(port->priv, CommandReg, PCD_IDLE);
+    port->write_reg(port->priv, DivIrqReg, 0x04);
+    port->write_reg(port->priv, FIFOLevelReg, 0x80);
+    port->write_burst(port->priv, FIFODataReg, data, len);
+    port->write_reg(port->priv, CommandReg, PCD_CALCCRC);
+    while (!(port->read_reg(port->priv, DivIrqReg) & 0x04))
+        ;
+    out[0] = port->read_reg(port->priv, CRCResultRegL);
+    out[1] = port->read_reg(port->priv, CRCResultRegM);
+}
+
+static int bench_crc(void)
+{
+    /* ISO/IEC 14443-3 附录B 示例 */
+    static const struct
+    {
+        uint8_t data[2];
+        uint8_t crc[2];
+    } vectors[] = {
+        {{0x00, 0x00}, {0xA0, 0x1E}},
+        {{0x12, 0x34}, {0x26, 0xCF}},
+    };
+    const struct rfid_port_t *port = rc522_sim_port(&sim);
+    uint8_t data[DEF_FIFO_LENGTH], sw[2], hw[2];
+    uint32_t i, fail = 0;
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+    {
+        PcdCalcCrcA(&reader, vectors[i].data, 2, sw);
+        if (memcmp(sw, vectors[i].crc, 2))
+        {
+            printf("vector %u: %02X%02X != %02X%02X\r\n", i, sw[0], sw[1],
+                   vectors[i].crc[0], vectors[i].crc[1]);
+            fail++;
+        }
+    }
+
+    srand(1);
+    for (i = 0; i < 10000; i++)
+    {
+        uint8_t len = rand() % (DEF_FIFO_LENGTH + 1);
+
+        for (uint8_t j = 0; j < len; j++)
+            data[j] = rand();
+
+        PcdCalcCrcA(&reader, data, len, sw);
+        bench_chip_crc(port, data, len, hw);
+        if (memcmp(sw, hw, 2))
+        {
+            printf("len %u: sw %02X%02X, chip %02X%02X\r\n", len, sw[0], sw[1], hw[0], hw[1]);
+            fail++;
+        }
+    }
+
+    printf("crc: %u frames, %u mismatches\r\n", i, fail);
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief 多卡枚举: 4/7/10 字节 UID 混合, 部分卡号前缀相同以产生深层冲突
+ */
+static int bench_enum(void)
+{
+    static const uint8_t uids[][10] = {
+        {0xDE, 0xAD, 0xBE, 0xEE},
+        {0xDE, 0xAD, 0x3E, 0xEF},
+        {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66},
+        {0x04, 0x11, 0x22, 0x37, 0x44, 0x55, 0x67},
+        {0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09},
+    };
+    static const uint8_t lens[] = {4, 4, 7, 7, 10};
+    struct rfid_card_t cards[SIM_MAX_CARDS];
+    struct bench_snap_t snap;
+    uint8_t count, status;
+
+    for (uint8_t i = 0; i < sizeof(lens); i++)
+        rc522_sim_add_card(&sim, uids[i], lens[i]);
+
+    bench_begin(&snap);
+    status = PcdEnumerate(&reader, PICC_REQALL, cards, SIM_MAX_CARDS, &count);
+    bench_end(&snap, "enumerate", status);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        printf("  card %u: atqa %02X%02X sak %02X uid ", i, cards[i].atqa[0], cards[i].atqa[1], cards[i].sak);
+        for (uint8_t j = 0; j < cards[i].uid_len; j++)
+            printf("%02X", cards[i].uid[j]);
+        printf("\r\n");
+    }
+
+    return (count == sim.n_cards) ? 0 : 1;
+}
+
+/**
+ * @brief 轮询引擎: 卡0始终在场, 其余卡按脚本进出, 打印事件及相对脚本时间的检测延迟
+ */
+static int bench_poll(void)
+{
+    static const uint8_t uid1[4] = {0xDE, 0xAD, 0x3E, 0xEF};
+    static const uint8_t uid2[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    static const struct
+    {
+        uint32_t at_ms;
+        uint8_t card;
+        uint8_t present;
+    } script[] = {
+        {200, 1, 1}, {400, 2, 1}, {700, 1, 0}, {900, 0, 0}, {1100, 2, 0}, {1200, 1, 1},
+    };
+    const struct rfid_poll_cfg_t cfg = {.period_us = 20000, .wupa_every = 5, .depart_us = 150000};
+    static struct rfid_poll_t poll;
+    struct rfid_poll_event_t ev;
+    struct rfid_poll_stats_t stats;
+    uint64_t start_ns = sim.now_ns, end_ns = start_ns + 1500ULL * 1000 * 1000;
+    uint64_t last_change_us[SIM_MAX_CARDS] = {0};
+    int fail = 0;
+
+    rc522_sim_card_present(&sim, rc522_sim_add_card(&sim, uid1, sizeof(uid1)), 0);
+    rc522_sim_card_present(&sim, rc522_sim_add_card(&sim, uid2, sizeof(uid2)), 0);
+    for (uint8_t i = 0; i < sizeof(script) / sizeof(script[0]); i++)
+        rc522_sim_schedule(&sim, start_ns + script[i].at_ms * 1000000ULL, script[i].card, script[i].present);
+
+    rc522_sim_reset_stats(&sim);
+    PcdPollInit(&poll, &reader, &cfg);
+
+    printf("%-10s %-9s %-22s %10s\r\n", "time(ms)", "event", "uid", "delay(ms)");
+    while (sim.now_ns < end_ns)
+    {
+        PcdPoll(&poll);
+
+        while (PcdPollGetEvent(&poll, &ev))
+        {
+            uint64_t at_us = start_ns / 1000;
+            char uid[24];
+            int card = -1;
+
+            for (uint8_t i = 0; i < sim.n_cards; i++)
+            {
+                if (sim.cards[i].uid_len == ev.card.uid_len && !memcmp(sim.cards[i].uid, ev.card.uid, ev.card.uid_len))
+                    card = i;
+            }
+            for (uint8_t i = 0; i < sizeof(script) / sizeof(script[0]); i++)
+            {
+                uint64_t t = start_ns / 1000 + script[i].at_ms * 1000ULL;
+
+                if (script[i].card == card && script[i].present == (ev.type == RFID_POLL_EV_ARRIVED) &&
+                    t <= ev.time_us && t > at_us && t > last_change_us[card])
+                    at_us = t;
+            }
+            if (card >= 0)
+                last_change_us[card] = ev.time_us;
+            else
+                fail++;
+
+            for (uint8_t i = 0; i < ev.card.uid_len; i++)
+                sprintf(&uid[2 * i], "%02X", ev.card.uid[i]);
+            printf("%-10.1f %-9s %-22s %10.1f\r\n", (ev.time_us - start_ns / 1000) / 1000.0,
+                   (ev.type == RFID_POLL_EV_ARRIVED) ? "arrived" : "departed", uid, (ev.time_us - at_us) / 1000.0);
+        }
+    }
+
+    PcdPollGetStats(&poll, &stats);
+    printf("cycles %u (%.1f/s), max cycle %u us, overruns %u, arrived %u, departed %u, dropped %u, spi xfers %u\r\n",
+           stats.cycles, stats.cycles / ((sim.now_ns - start_ns) / 1e9), stats.max_cycle_us, stats.overruns,
+           stats.arrived, stats.departed, stats.dropped, sim.stats.transactions);
+
+    /* 卡0在场后离开, 卡1进出后在1200ms再次进入, 卡2进出一次 */
+    if (stats.arrived != 4 || stats.departed != 3 || stats.dropped)
+        fail++;
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief 多读卡器: 4片RC522共用一条SPI总线, 读卡器3无响应, 其余各有一张卡按脚本进出,
+ *        由 PcdPollSchedule 轮流寻卡, 统计各读卡器的周期与事件延迟
+ */
+static int bench_multi(uint8_t hwspi, uint8_t irq)
+{
+    static const uint8_t uids[3][4] = {
+        {0xDE, 0xAD, 0xBE, 0xEF},
+        {0xDE, 0xAD, 0x3E, 0xEF},
+        {0x12, 0x34, 0x56, 0x78},
+    };
+    static const struct
+    {
+        uint32_t at_ms;
+        uint8_t reader;
+        uint8_t present;
+    } script[] = {
+        {200, 0, 1}, {250, 2, 1}, {300, 1, 1}, {600, 0, 0}, {800, 2, 0}, {1000, 2, 1}, {1100, 1, 0},
+    };
+    static const uint8_t expect[4][2] = {{1, 1}, {1, 1}, {2, 1}, {0, 0}}; /* 各读卡器到达/离开次数 */
+    const struct rfid_poll_cfg_t cfg = {.period_us = 20000, .wupa_every = 5, .depart_us = 150000};
+    static struct rc522_sim_t sims[4];
+    static struct rfid_reader_t readers[4];
+    static struct rfid_poll_t polls[4];
+    struct rfid_poll_event_t ev;
+    struct rfid_poll_stats_t stats;
+    uint64_t bus_ns = 0, start_ns, end_ns;
+    double max_delay[2] = {0, 0};
+    int fail = 0;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        rc522_sim_init(&sims[i]);
+        if (hwspi)
+            rc522_sim_timing_hwspi(&sims[i], 10 * 1000 * 1000);
+        rc522_sim_wire_irq(&sims[i], irq);
+        rc522_sim_attach_bus(&sims[i], &bus_ns);
+
+        if (i < 3)
+            rc522_sim_card_present(&sims[i], rc522_sim_add_card(&sims[i], uids[i], 4), 0);
+        else
+            sims[i].dead = 1;
+
+        Pcd_port_init(&readers[i], rc522_sim_port(&sims[i]));
+        PcdReset(&readers[i]);
+        PcdAntennaOn(&readers[i]);
+        M500PcdConfigISOType(&readers[i], 'A');
+    }
+
+    start_ns = bus_ns;
+    end_ns = start_ns + 1500ULL * 1000 * 1000;
+    for (uint8_t i = 0; i < sizeof(script) / sizeof(script[0]); i++)
+        rc522_sim_schedule(&sims[script[i].reader], start_ns + script[i].at_ms * 1000000ULL, 0, script[i].present);
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        rc522_sim_reset_stats(&sims[i]);
+        PcdPollInit(&polls[i], &readers[i], &cfg);
+    }
+
+    printf("%-10s %-6s %-9s %-10s %10s\r\n", "time(ms)", "reader", "event", "uid", "delay(ms)");
+    while (bus_ns < end_ns)
+    {
+        uint8_t n = PcdPollSchedule(polls, 4);
+
+        while (PcdPollGetEvent(&polls[n], &ev))
+        {
+            uint8_t arrived = (ev.type == RFID_POLL_EV_ARRIVED);
+            uint64_t at_us = 0;
+            double delay;
+
+            for (uint8_t i = 0; i < sizeof(script) / sizeof(script[0]); i++)
+            {
+                uint64_t t = start_ns / 1000 + script[i].at_ms * 1000ULL;
+
+                if (script[i].reader == n && script[i].present == arrived && t <= ev.time_us && t > at_us)
+                    at_us = t;
+            }
+            if (!at_us)
+                fail++;
+
+            delay = (ev.time_us - at_us) / 1000.0;
+            if (delay > max_delay[!arrived])
+                max_delay[!arrived] = delay;
+
+            printf("%-10.1f %-6u %-9s %02X%02X%02X%02X   %10.1f\r\n", (ev.time_us - start_ns / 1000) / 1000.0, n,
+                   arrived ? "arrived" : "departed", ev.card.uid[0], ev.card.uid[1], ev.card.uid[2], ev.card.uid[3],
+                   delay);
+        }
+    }
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        PcdPollGetStats(&polls[i], &stats);
+        printf("reader %u: cycles %u (%.1f/s), max cycle %u us, overruns %u, faults %u, arrived %u, departed %u\r\n",
+               i, stats.cycles, stats.cycles / ((bus_ns - start_ns) / 1e9), stats.max_cycle_us, stats.overruns,
+               stats.faults, stats.arrived, stats.departed);
+
+        if (stats.arrived != expect[i][0] || stats.departed != expect[i][1] || stats.dropped)
+            fail++;
+    }
+    printf("max arrival delay %.1f ms, max departure delay %.1f ms\r\n", max_delay[0], max_delay[1]);
+
+    return fail ? 1 : 0;
+}
+
+static double bench_real_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define RING_ITEMS (1U << 22)
+
+static struct rfid_ring_t ring;
+
+static void *ring_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < RING_ITEMS; i++)
+    {
+        while (!PcdRingPush(&ring, &i))
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+static void *engine_thread(void *arg)
+{
+    PcdEngineRun(arg);
+
+    return NULL;
+}
+
+/**
+ * @brief 射频引擎: 先以两个线程压测环形队列的顺序与吞吐, 再让引擎线程驱动仿真读卡器,
+ *        主线程在卡片到达时提交读写命令并校验完成事件中的数据
+ */
+static int bench_engine(void)
+{
+    static const uint8_t uid[4] = {0x12, 0x34, 0x56, 0x78};
+    const uint8_t key[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const struct rfid_poll_cfg_t cfg = {.period_us = 20000, .wupa_every = 5, .depart_us = 150000};
+    static uint32_t ring_buf[64];
+    static struct rfid_poll_t poll;
+    static struct rfid_engine_t engine;
+    struct rfid_engine_event_t ev;
+    struct rfid_engine_cmd_t cmd;
+    uint8_t expect[2][16];
+    uint32_t value, next = 0, arrived = 0, done = 0;
+    pthread_t th;
+    double t0, t;
+    int fail = 0;
+
+    PcdRingInit(&ring, ring_buf, sizeof(ring_buf[0]), 64);
+    t0 = bench_real_s();
+    pthread_create(&th, NULL, ring_producer, NULL);
+    while (next < RING_ITEMS)
+    {
+        if (!PcdRingPop(&ring, &value))
+        {
+            sched_yield();
+            continue;
+        }
+        if (value != next)
+            fail++;
+        next++;
+    }
+    pthread_join(th, NULL);
+    t = bench_real_s() - t0;
+    printf("ring: %u items in %.3f s (%.1f M/s), order errors %d\r\n", RING_ITEMS, t, RING_ITEMS / t / 1e6, fail);
+
+    /* 卡0在200ms到达, 先写后读; 卡1在400ms到达, 只读预置数据 */
+    rc522_sim_add_card(&sim, uid, 4);
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        rc522_sim_card_present(&sim, i, 0);
+        rc522_sim_schedule(&sim, sim.now_ns + (200 + 200 * i) * 1000000ULL, i, 1);
+        for (uint8_t k = 0; k < 16; k++)
+        {
+            sim.cards[i].mem[0x11 * 16 + k] = 0xA0 + k;
+            expect[i][k] = i ? (0xA0 + k) : (0x50 + k);
+        }
+    }
+
+    PcdPollInit(&poll, &reader, &cfg);
+    PcdEngineInit(&engine, &poll, 1);
+    pthread_create(&th, NULL, engine_thread, &engine);
+
+    t0 = bench_real_s();
+    while (done < 3 && bench_real_s() - t0 < 5.0)
+    {
+        if (!PcdEngineGetEvent(&engine, &ev))
+        {
+            sched_yield();
+            continue;
+        }
+
+        if (ev.type == RFID_ENGINE_EV_ARRIVED)
+        {
+            memset(&cmd, 0, sizeof(cmd));
+            cmd.reader = ev.reader;
+            cmd.auth_mode = PICC_AUTHENT1A;
+            cmd.addr = 0x11;
+            memcpy(cmd.key, key, 6);
+            cmd.card = ev.card;
+            cmd.tag = !memcmp(ev.card.uid, uid, 4);
+
+            if (cmd.tag == 0)
+            {
+                cmd.type = RFID_ENGINE_CMD_WRITE;
+                memcpy(cmd.data, expect[0], 16);
+                if (!PcdEngineSubmit(&engine, &cmd))
+                    fail++;
+            }
+            cmd.type = RFID_ENGINE_CMD_READ;
+            if (!PcdEngineSubmit(&engine, &cmd))
+                fail++;
+
+            arrived++;
+            printf("arrived  %02X%02X%02X%02X at %.1f ms\r\n", ev.card.uid[0], ev.card.uid[1], ev.card.uid[2],
+                   ev.card.uid[3], ev.time_us / 1000.0);
+        }
+        else if (ev.type == RFID_ENGINE_EV_READ || ev.type == RFID_ENGINE_EV_WRITE)
+        {
+            if (ev.status != MI_OK || (ev.type == RFID_ENGINE_EV_READ && memcmp(ev.data, expect[ev.tag], 16)))
+                fail++;
+
+            done++;
+            printf("%-8s %02X%02X%02X%02X block 0x%02X %s\r\n", (ev.type == RFID_ENGINE_EV_READ) ? "read" : "write",
+                   ev.card.uid[0], ev.card.uid[1], ev.card.uid[2], ev.card.uid[3], ev.addr,
+                   (ev.status == MI_OK) ? "OK" : "ERR");
+        }
+    }
+
+    PcdEngineStop(&engine);
+    pthread_join(th, NULL);
+    printf("engine: arrived %u, completed %u, dropped %u, real %.3f s\r\n", arrived, done, engine.dropped,
+           bench_real_s() - t0);
+
+    if (arrived != 2 || done != 3 || engine.dropped)
+        fail++;
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief 非阻塞读块: 每次轮询之间以 slice_us 的延时模拟应用的其他工作,
+ *        统计每次读块的总耗时与驱动占用的时间, 差值即归还给应用的CPU时间
+ */
+static int bench_async(uint32_t slice_us)
+{
+    const uint8_t key[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const uint32_t reads = 100;
+    const struct rfid_port_t *port = rc522_sim_port(&sim);
+    struct rfid_card_t card_info;
+    uint8_t expect[16], buf[16], status;
+    uint64_t t0, t, busy_ns = 0, total_ns, block_ns;
+    uint32_t polls = 0;
+    int fail = 0;
+
+    if (PcdActivate(&reader, PICC_REQALL, &card_info) != MI_OK ||
+        PcdAuthState(&reader, PICC_AUTHENT1A, 0x11, key, card_info.uid) != MI_OK ||
+        PcdRead(&reader, 0x11, expect) != MI_OK)
+        return 1;
+
+    t0 = sim.now_ns;
+    for (uint32_t i = 0; i < reads; i++)
+    {
+        if (PcdRead(&reader, 0x11, buf) != MI_OK || memcmp(buf, expect, 16))
+            fail++;
+    }
+    block_ns = sim.now_ns - t0;
+
+    t0 = sim.now_ns;
+    for (uint32_t i = 0; i < reads; i++)
+    {
+        t = sim.now_ns;
+        status = PcdReadStart(&reader, 0x11, buf);
+        busy_ns += sim.now_ns - t;
+
+        if (status == MI_OK)
+            status = MI_BUSY;
+
+        while (status == MI_BUSY)
+        {
+            port->delay_us(port->priv, slice_us);
+
+            t = sim.now_ns;
+            status = PcdOpPoll(&reader);
+            busy_ns += sim.now_ns - t;
+            polls++;
+        }
+
+        if (status != MI_OK || memcmp(buf, expect, 16))
+            fail++;
+    }
+    total_ns = sim.now_ns - t0;
+
+    printf("read (blocking)  %8.1f us driver\r\n", block_ns / 1000.0 / reads);
+    printf("read (async)     %8.1f us latency, %8.1f us driver, %8.1f us reclaimed, %.1f polls, slice %u us\r\n",
+           total_ns / 1000.0 / reads, busy_ns / 1000.0 / reads, (total_ns - busy_ns) / 1000.0 / reads,
+           (double)polls / reads, slice_us);
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief ISO14443-4: 在各最高速率下分别以 FSD 64 与 256 激活, 读 256 字节并写 200 字节;
+ *        FSD 256 的帧超过 FIFO, 需流式收发, 软件 SPI 只在 106kbit/s 下跟得上.
+ *        再换成 FWI=4 的卡片使写入触发 S(WTX), 并在读取途中注入 CRC 错误与丢帧;
+ *        最后以约1s的写入检查超过655ms的帧等待时间: FWI=12, 以及 FWI=7 经 S(WTX) 延长
+ */
+static int bench_isodep(int card, uint8_t slow_spi)
+{
+    static const uint8_t ats_fast[] = {0x05, 0x78, 0x77, 0x81, 0x02};
+    static const uint8_t ats_slow[] = {0x05, 0x78, 0x80, 0x40, 0x00};
+    static const uint8_t read_bin[5] = {0x00, 0xB0, 0x00, 0x00, 0x00};
+    static const char *const br_names[4] = {"106", "212", "424", "848"};
+    static const uint8_t fsdi[2] = {ISODEP_FSDI_64, ISODEP_FSDI_256};
+    struct rfid_card_t card_info;
+    struct rfid_isodep_t dep;
+    struct bench_snap_t snap;
+    uint8_t apdu[5 + 200], rx[258], status;
+    uint16_t rx_len;
+    char name[24];
+    int fail = 0;
+
+    for (uint16_t i = 0; i < sizeof(sim.cards[card].mem); i++)
+        sim.cards[card].mem[i] = i * 7;
+    rc522_sim_set_ats(&sim, card, ats_fast);
+
+    apdu[0] = 0x00;
+    apdu[1] = 0xD6;
+    apdu[2] = 0x01;
+    apdu[3] = 0x00;
+    apdu[4] = 200;
+    for (uint8_t i = 0; i < 200; i++)
+        apdu[5 + i] = ~i;
+
+    printf("%-14s %-6s %6s %6s %8s %6s %6s %10s\r\n", "op", "status", "frames", "xfers", "bytes", "reads", "writes",
+           "time(us)");
+
+    for (uint8_t br = RFID_BR_106; br <= RFID_BR_848; br++)
+    {
+        for (uint8_t f = 0; f < sizeof(fsdi); f++)
+        {
+            if (slow_spi && br > RFID_BR_106 && fsdi[f] > ISODEP_FSDI_64)
+                continue;
+
+            bench_begin(&snap);
+            status = PcdActivate(&reader, PICC_REQALL, &card_info);
+            if (status == MI_OK)
+                status = (card_info.sak & 0x20) ? PcdIsoDepActivate(&reader, br, fsdi[f], &dep) : MI_ERR;
+            snprintf(name, sizeof(name), "rats+pps@%s", br_names[br]);
+            if (f == 0)
+                bench_end(&snap, name, status);
+            if (status != MI_OK || dep.br_tx != br || dep.br_rx != br)
+                return 1;
+
+            bench_begin(&snap);
+            status = PcdIsoDepExchange(&reader, &dep, read_bin, sizeof(read_bin), rx, sizeof(rx), &rx_len);
+            snprintf(name, sizeof(name), "read256@%s/%u", br_names[br], dep.fsd);
+            bench_end(&snap, name, status);
+            if (status != MI_OK || rx_len != 258 || memcmp(rx, sim.cards[card].mem, 256) || rx[256] != 0x90)
+                fail++;
+
+            bench_begin(&snap);
+            status = PcdIsoDepExchange(&reader, &dep, apdu, sizeof(apdu), rx, sizeof(rx), &rx_len);
+            snprintf(name, sizeof(name), "update200@%s/%u", br_names[br], dep.fsd);
+            bench_end(&snap, name, status);
+            if (status != MI_OK || rx_len != 2 || rx[0] != 0x90 ||
+                memcmp(&sim.cards[card].mem[0x100], &apdu[5], 200))
+                fail++;
+
+            if (PcdIsoDepDeselect(&reader, &dep) != MI_OK)
+                fail++;
+        }
+    }
+
+    /* 读取途中丢失一个应答块, 随后一个应答 CRC 错误 */
+    PcdActivate(&reader, PICC_REQALL, &card_info);
+    PcdIsoDepActivate(&reader, slow_spi ? RFID_BR_106 : RFID_BR_848, ISODEP_FSDI_256, &dep);
+    rc522_sim_fault(&sim, sim.stats.rf_frames + 1, SIM_FAULT_MUTE);
+    rc522_sim_fault(&sim, sim.stats.rf_frames + 3, SIM_FAULT_CRC);
+#if RFID_CFG_TRACE
+    PcdTraceClear(&reader);
+#endif
+    bench_begin(&snap);
+    status = PcdIsoDepExchange(&reader, &dep, read_bin, sizeof(read_bin), rx, sizeof(rx), &rx_len);
+    bench_end(&snap, "read256(fault)", status);
+#if RFID_CFG_TRACE
+    PcdTraceDump(&reader);
+#endif
+    if (status != MI_OK || rx_len != 258 || memcmp(rx, sim.cards[card].mem, 256) || sim.n_faults)
+        fail++;
+    PcdIsoDepDeselect(&reader, &dep);
+
+    rc522_sim_set_ats(&sim, card, ats_slow);
+    PcdActivate(&reader, PICC_REQALL, &card_info);
+    PcdIsoDepActivate(&reader, RFID_BR_848, ISODEP_FSDI_256, &dep);
+    bench_begin(&snap);
+    status = PcdIsoDepExchange(&reader, &dep, apdu, sizeof(apdu), rx, sizeof(rx), &rx_len);
+    bench_end(&snap, "update200(wtx)", status);
+    printf("fwt %u us, %u wtx\r\n", dep.fwt_us, dep.wtx);
+    if (status != MI_OK || rx_len != 2 || rx[0] != 0x90 || dep.wtx == 0)
+        fail++;
+    PcdIsoDepDeselect(&reader, &dep);
+
+    /* 写入耗时约1s, 超过默认分频下定时器的上限(约655ms): FWI=12 的卡片在 FWT 内应答, FWI=7 的卡片经 S(WTX) 延长 */
+    {
+        static const uint8_t ats_fwi[2][5] = {{0x05, 0x78, 0x80, 0xC0, 0x00}, {0x05, 0x78, 0x80, 0x70, 0x00}};
+        static const char *const fwi_names[2] = {"update200(fwi12)", "update200(wtx1s)"};
+        uint32_t write_ns = sim.timing.write_ns;
+
+        sim.timing.write_ns = 80 * 1000 * 1000;
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            rc522_sim_set_ats(&sim, card, ats_fwi[i]);
+            PcdActivate(&reader, PICC_REQALL, &card_info);
+            PcdIsoDepActivate(&reader, RFID_BR_848, ISODEP_FSDI_64, &dep);
+            bench_begin(&snap);
+            status = PcdIsoDepExchange(&reader, &dep, apdu, sizeof(apdu), rx, sizeof(rx), &rx_len);
+            bench_end(&snap, fwi_names[i], status);
+            printf("fwt %u us, %u wtx\r\n", dep.fwt_us, dep.wtx);
+            /* 定时器提前到期时会多出 R(NAK) 帧: 只允许链接的I块加 S(WTX) 应答 */
+            if (status != MI_OK || rx_len != 2 || rx[0] != 0x90 || (dep.wtx == 0) != (i == 0) ||
+                sim.stats.rf_frames - snap.stats.rf_frames != (sizeof(apdu) + dep.fsd - 4) / (dep.fsd - 3) + dep.wtx)
+                fail++;
+            PcdIsoDepDeselect(&reader, &dep);
+        }
+        sim.timing.write_ns = write_ns;
+    }
+
+#if RFID_CFG_STATS
+    if (bench_stats())
+        return 1;
+#endif
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief NTAG216: GET_VERSION 识别型号, 以 READ(每帧4页) 与 FAST_READ 分别读全卡比较耗时,
+ *        WRITE 与 COMPATIBILITY_WRITE 各写一页, 再设置密码保护, 验证未认证时读取被拒绝
+ */
+static int bench_ntag(int classic)
+{
+    static const uint8_t uid[7] = {0x04, 0x6E, 0x21, 0x9A, 0x3C, 0x5D, 0x80};
+    static const uint8_t version[8] = {0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x13, 0x03};
+    static const uint8_t pwd[4] = {0x12, 0x34, 0x56, 0x78}, bad_pwd[4] = {0x12, 0x34, 0x56, 0x79};
+    static const uint8_t page[4] = {0xCA, 0xFE, 0xF0, 0x0D}, page2[4] = {0x5A, 0xA5, 0x0F, 0xF0};
+    static uint8_t image[231 * 4], image2[232 * 4];
+    struct rfid_card_t card_info;
+    struct rfid_ul_t tag;
+    struct bench_snap_t snap;
+    uint8_t buf[16], cfg[4], pack[2], status;
+    int card, fail = 0;
+
+    card = rc522_sim_add_card(&sim, uid, sizeof(uid));
+    if (card < 0 || rc522_sim_set_ul(&sim, card, version, 231))
+        return 1;
+    for (uint16_t i = 16; i < 226 * 4; i++)
+        sim.cards[card].mem[i] = i * 13;
+    rc522_sim_card_present(&sim, classic, 0);
+
+    printf("%-14s %-6s %6s %6s %8s %6s %6s %10s\r\n", "op", "status", "frames", "xfers", "bytes", "reads", "writes",
+           "time(us)");
+
+    bench_begin(&snap);
+    status = PcdActivate(&reader, PICC_REQALL, &card_info);
+    if (status == MI_OK)
+        status = (card_info.sak == 0x00) ? PcdUlGetVersion(&reader, &tag) : MI_ERR;
+    bench_end(&snap, "get_version", status);
+    printf("type %u, %u pages, cfg page %u\r\n", tag.type, tag.pages, tag.cfg_page);
+    if (status != MI_OK || tag.type != RFID_NTAG_216 || tag.pages != 231)
+        return 1;
+
+    /* READ 超出末页时回到第0页, 58帧覆盖232页 */
+    bench_begin(&snap);
+    status = MI_OK;
+    for (uint8_t p = 0; p < 58 && status == MI_OK; p++)
+        status = PcdUlRead(&reader, p * 4, &image2[p * 16]);
+    bench_end(&snap, "read x58", status);
+
+    bench_begin(&snap);
+    status = PcdUlFastRead(&reader, 0, tag.pages - 1, image);
+    bench_end(&snap, "fast_read 231", status);
+    if (status != MI_OK || memcmp(image, image2, sizeof(image)) || memcmp(image2 + sizeof(image), image, 4) ||
+        memcmp(&image[16], &sim.cards[card].mem[16], (tag.cfg_page - 4) * 4))
+        fail++;
+
+    bench_begin(&snap);
+    status = PcdUlWrite(&reader, 4, page);
+    bench_end(&snap, "write", status);
+    if (status != MI_OK)
+        fail++;
+
+    bench_begin(&snap);
+    status = PcdUlCompatWrite(&reader, 5, page2);
+    bench_end(&snap, "comp_write", status);
+    if (status != MI_OK || PcdUlRead(&reader, 4, buf) != MI_OK || memcmp(buf, page, 4) || memcmp(&buf[4], page2, 4))
+        fail++;
+
+    /* PWD, PACK, CFG1 的 PROT 位(读取也受保护), 最后写 CFG0 的 AUTH0 使保护生效 */
+    cfg[0] = 0xAB;
+    cfg[1] = 0xCD;
+    cfg[2] = cfg[3] = 0x00;
+    if (PcdUlWrite(&reader, tag.cfg_page + 2, pwd) != MI_OK || PcdUlWrite(&reader, tag.cfg_page + 3, cfg) != MI_OK)
+        fail++;
+    cfg[0] = 0x80;
+    cfg[1] = 0x05;
+    if (PcdUlWrite(&reader, tag.cfg_page + 1, cfg) != MI_OK)
+        fail++;
+    cfg[0] = 0x04;
+    cfg[1] = cfg[2] = 0x00;
+    cfg[3] = 0x10;
+    if (PcdUlWrite(&reader, tag.cfg_page, cfg) != MI_OK)
+        fail++;
+
+#if RFID_CFG_TRACE
+    PcdTraceClear(&reader);
+#endif
+    PcdHalt(&reader);
+    PcdActivate(&reader, PICC_REQALL, &card_info);
+    bench_begin(&snap);
+    status = PcdUlFastRead(&reader, 0, tag.pages - 1, image);
+    bench_end(&snap, "read(locked)", status);
+    if (status == MI_OK)
+        fail++;
+
+    PcdActivate(&reader, PICC_REQALL, &card_info);
+    bench_begin(&snap);
+    status = PcdUlPwdAuth(&reader, bad_pwd, pack);
+    bench_end(&snap, "pwd_auth(bad)", status);
+    if (status == MI_OK)
+        fail++;
+
+    PcdActivate(&reader, PICC_REQALL, &card_info);
+    bench_begin(&snap);
+    status = PcdUlPwdAuth(&reader, pwd, pack);
+    bench_end(&snap, "pwd_auth", status);
+#if RFID_CFG_TRACE
+    PcdTraceDump(&reader);
+#endif
+    if (status != MI_OK || pack[0] != 0xAB || pack[1] != 0xCD)
+        fail++;
+
+    bench_begin(&snap);
+    status = PcdUlFastRead(&reader, 0, tag.pages - 1, image);
+    bench_end(&snap, "fast_read(auth)", status);
+    if (status != MI_OK || memcmp(&image[16], page, 4) || image[(tag.cfg_page + 2) * 4] != 0x00)
+        fail++;
+
+#if RFID_CFG_STATS
+    if (bench_stats())
+        return 1;
+#endif
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief 上电到第一次寻卡成功: 分别以 PcdReset/PcdAntennaOn/M500PcdConfigISOType 与 PcdInit 初始化,
+ *        随后连续 REQA 直到卡片应答; 卡片在天线场开启 2ms 后才能应答.
+ *        接有 RST 时由驱动硬复位, 否则芯片已上电, 只做软复位
+ */
+static int bench_boot(void)
+{
+    static const char *const names[2][2][2] = {
+        {{"init(legacy)", "boot(legacy)"}, {"init", "boot"}},
+        {{"init(rst,leg)", "boot(rst,leg)"}, {"init(rst)", "boot(rst)"}},
+    };
+    void (*hard_reset)(void *priv) = sim.port.hard_reset;
+    struct bench_snap_t snap;
+    uint8_t type[2], status;
+    uint16_t tries;
+    int fail = 0;
+
+    sim.timing.picc_boot_ns = 2000 * 1000;
+
+    printf("%-14s %-6s %6s %6s %8s %6s %6s %10s\r\n", "op", "status", "frames", "xfers", "bytes", "reads", "writes",
+           "time(us)");
+
+    for (uint8_t rst = 0; rst < 2; rst++)
+    {
+        for (uint8_t fast = 0; fast < 2; fast++)
+        {
+            /* 上电: 寄存器为复位值, 天线场关闭 */
+            hard_reset(sim.port.priv);
+            sim.port.hard_reset = rst ? hard_reset : NULL;
+
+            bench_begin(&snap);
+            if (fast)
+            {
+                status = PcdInit(&reader);
+            }
+            else
+            {
+                status = PcdReset(&reader);
+                PcdAntennaOn(&reader);
+                M500PcdConfigISOType(&reader, 'A');
+            }
+            bench_end(&snap, names[rst][fast][0], status);
+
+            for (tries = 0; status == MI_OK && tries < 100; tries++)
+            {
+                if (PcdRequest(&reader, PICC_REQALL, type) == MI_OK)
+                    break;
+            }
+            if (tries == 100)
+                status = MI_NOTAGERR;
+            bench_end(&snap, names[rst][fast][1], status);
+            printf("%u requests unanswered\r\n", tries);
+            if (status != MI_OK)
+                fail++;
+        }
+    }
+    sim.port.hard_reset = hard_reset;
+
+    return fail ? 1 : 0;
+}
+
+/**
+ * @brief 低功耗探测: 天线常开与按不同周期唤醒探测比较. 先无卡运行10s, 统计天线场开启时间与估算的平均电流,
+ *        再让卡片间隔约3s刷卡5次, 每次停留300ms, 统计检测到的次数与到达/离开的检测延迟;
+ *        卡片在天线场开启 2ms 后才能应答
+ */
+static int bench_lowpower(int card)
+{
+    /* 平均电流估算, MFRC522 数据手册典型值: 软掉电 10uA, 数字与模拟部分 13.5mA, 天线驱动另加 60mA */
+    static const double ma_pd = 0.01, ma_awake = 13.5, ma_rf = 60.0;
+    static const uint32_t lp_ms[] = {0, 100, 250, 500};
+    static const uint32_t tap_ms[] = {1370, 4110, 7530, 10290, 13800};
+    struct rfid_poll_cfg_t cfg = {.period_us = 20000, .wupa_every = 5, .depart_us = 150000, .lp_guard_us = 2500};
+    static struct rfid_poll_t poll;
+    struct rfid_poll_event_t ev;
+    struct rfid_poll_stats_t stats;
+    uint64_t start_ns, end_ns, rf_ns, pd_ns, idle_ns;
+    double arrive_sum, depart_sum, arrive_max, ma;
+    uint8_t arrived, departed;
+    int fail = 0;
+
+    sim.timing.picc_boot_ns = 2000 * 1000;
+    rc522_sim_card_present(&sim, card, 0);
+
+    printf("%-10s %8s %10s %8s %6s %10s %10s %10s %10s\r\n", "lp(ms)", "wakeups", "rf_on(s/h)", "I(mA)", "taps",
+           "arrive(ms)", "max(ms)", "depart(ms)", "rf_taps(s)");
+
+    for (uint8_t i = 0; i < sizeof(lp_ms) / sizeof(lp_ms[0]); i++)
+    {
+        cfg.lp_period_us = lp_ms[i] * 1000;
+        if (PcdInit(&reader) != MI_OK)
+            return 1;
+        PcdPollInit(&poll, &reader, &cfg);
+        rc522_sim_reset_stats(&sim);
+
+        /* 无卡 */
+        start_ns = sim.now_ns;
+        end_ns = start_ns + 10000ULL * 1000 * 1000;
+        while (sim.now_ns < end_ns)
+            PcdPoll(&poll);
+        idle_ns = sim.now_ns - start_ns;
+        rc522_sim_power_time(&sim, &rf_ns, &pd_ns);
+        ma = (pd_ns * ma_pd + (idle_ns - pd_ns) * ma_awake + rf_ns * ma_rf) / idle_ns;
+        PcdPollGetStats(&poll, &stats);
+        printf("%-10u %8u %10.1f %8.3f", lp_ms[i], stats.wakeups, rf_ns / 1e9 * 3600e9 / idle_ns, ma);
+        if (lp_ms[i] == 0 ? (rf_ns < idle_ns * 99 / 100) : (rf_ns > idle_ns / 10 || !stats.wakeups))
+            fail++;
+
+        /* 刷卡 */
+        rc522_sim_reset_stats(&sim);
+        start_ns = sim.now_ns;
+        for (uint8_t t = 0; t < sizeof(tap_ms) / sizeof(tap_ms[0]); t++)
+        {
+            rc522_sim_schedule(&sim, start_ns + tap_ms[t] * 1000000ULL, card, 1);
+            rc522_sim_schedule(&sim, start_ns + (tap_ms[t] + 300) * 1000000ULL, card, 0);
+        }
+        end_ns = start_ns + 16000ULL * 1000 * 1000;
+        arrive_sum = depart_sum = arrive_max = 0;
+        arrived = departed = 0;
+        while (sim.now_ns < end_ns)
+        {
+            PcdPoll(&poll);
+            while (PcdPollGetEvent(&poll, &ev))
+            {
+                uint64_t at_us = 0;
+
+                /* 该事件之前最近一次对应的进出 */
+                for (uint8_t t = 0; t < sizeof(tap_ms) / sizeof(tap_ms[0]); t++)
+                {
+                    uint64_t us = start_ns / 1000 + (tap_ms[t] + ((ev.type == RFID_POLL_EV_ARRIVED) ? 0 : 300)) * 1000ULL;
+
+                    if (us <= ev.time_us)
+                        at_us = us;
+                }
+                if (ev.type == RFID_POLL_EV_ARRIVED)
+                {
+                    arrived++;
+                    arrive_sum += (ev.time_us - at_us) / 1000.0;
+                    if ((ev.time_us - at_us) / 1000.0 > arrive_max)
+                        arrive_max = (ev.time_us - at_us) / 1000.0;
+                }
+                else
+                {
+                    departed++;
+                    depart_sum += (ev.time_us - at_us) / 1000.0;
+                }
+            }
+        }
+        rc522_sim_power_time(&sim, &rf_ns, &pd_ns);
+        printf(" %4u/5 %10.1f %10.1f %10.1f %10.2f\r\n", arrived, arrived ? arrive_sum / arrived : 0.0, arrive_max,
+               departed ? depart_sum / departed : 0.0, rf_ns / 1e9);
+        /* 唤醒周期长于刷卡停留时间时会漏掉刷卡 */
+        if (arrived != departed || (lp_ms[i] < 300 && arrived != 5))
+            fail++;
+    }
+
+    return fail ? 1 : 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    const uint8_t card_uid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    const uint8_t key[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    struct bench_snap_t snap;
+    uint8_t type[2], uid[4], buf[16], status;
+    static uint8_t image[2][RFID_M1_SIZE];
+    static const uint8_t dict[4][6] = {
+        {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5},
+        {0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7},
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    };
+    uint8_t sector_status[RFID_M1_SECTORS];
+    struct rfid_card_t card_info;
+    int card, poll = 0, multi = 0, engine = 0, async = 0, isodep = 0, ntag = 0, boot = 0, lowpower = 0, fastbb = 0, hwspi = 0, irq = 0;
+
+    rc522_sim_init(&sim);
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "hwspi"))
+            hwspi = 1;
+        else if (!strcmp(argv[i], "irq"))
+            irq = 1;
+        else if (!strcmp(argv[i], "poll"))
+            poll = 1;
+        else if (!strcmp(argv[i], "multi"))
+            multi = 1;
+        else if (!strcmp(argv[i], "engine"))
+            engine = 1;
+        else if (!strcmp(argv[i], "async"))
+            async = 1;
+        else if (!strcmp(argv[i], "isodep"))
+            isodep = 1;
+        else if (!strcmp(argv[i], "ntag"))
+            ntag = 1;
+        else if (!strcmp(argv[i], "boot"))
+            boot = 1;
+        else if (!strcmp(argv[i], "lowpower"))
+            lowpower = 1;
+        else if (!strcmp(argv[i], "fastbb"))
+            fastbb = 1;
+    }
+
+    if (multi)
+        return bench_multi(hwspi, irq);
+
+    if (hwspi)
+        rc522_sim_timing_hwspi(&sim, 10 * 1000 * 1000);
+    if (fastbb)
+    {
+        /* 模拟接线只能可靠工作到 3MHz */
+        rc522_sim_timing_fastbb(&sim, RFID_SPI_MAX_HZ);
+        sim.max_clk_hz = 3 * 1000 * 1000;
+    }
+    rc522_sim_wire_irq(&sim, irq);
+
+    card = rc522_sim_add_card(&sim, card_uid, sizeof(card_uid));
+    Pcd_port_init(&reader, rc522_sim_port(&sim));
+
+    if (fastbb)
+    {
+        uint32_t hz;
+
+        bench_begin(&snap);
+        hz = PcdCalibrateClock(&reader, RFID_SPI_MAX_HZ, 100 * 1000);
+        bench_end(&snap, "calibrate", hz ? MI_OK : MI_ERR);
+        printf("spi clock %u Hz, wiring limit %u Hz\r\n", hz, sim.max_clk_hz);
+        if (hz == 0 || hz > sim.max_clk_hz)
+            return 1;
+    }
+
+    if (boot)
+        return bench_boot();
+
+#if RFID_CFG_STATS
+    stats_base = sim.stats;
+#endif
+
+    bench_begin(&snap);
+    status = PcdReset(&reader);
+    PcdAntennaOn(&reader);
+    M500PcdConfigISOType(&reader, 'A');
+    bench_end(&snap, "init", status);
+
+    if (argc > 1 && !strcmp(argv[1], "crc"))
+        return bench_crc();
+
+    if (poll)
+        return bench_poll();
+
+    if (engine)
+        return bench_engine();
+
+    if (async)
+        return bench_async(20);
+
+    if (isodep)
+        return bench_isodep(card, !hwspi);
+
+    if (ntag)
+        return bench_ntag(card);
+
+    if (lowpower)
+        return bench_lowpower(card);
+
+    printf("%-14s %-6s %6s %6s %8s %6s %6s %10s\r\n", "op", "status", "frames", "xfers", "bytes", "reads", "writes",
+           "time(us)");
+
+#if RFID_CFG_TRACE
+    PcdTraceClear(&reader);
+#endif
+
+    rc522_sim_card_present(&sim, card, 0);
+    bench_begin(&snap);
+    status = PcdRequest(&reader, PICC_REQALL, type);
+    bench_end(&snap, "request(none)", status);
+    rc522_sim_card_present(&sim, card, 1);
+
+    bench_begin(&snap);
+    status = PcdRequest(&reader, PICC_REQALL, type);
+    bench_end(&snap, "request", status);
+
+    bench_begin(&snap);
+    status = PcdAnticoll(&reader, uid);
+    bench_end(&snap, "anticoll", status);
+
+    bench_begin(&snap);
+    status = PcdSelect(&reader, uid);
+    bench_end(&snap, "select", status);
+
+    bench_begin(&snap);
+    status = PcdAuthState(&reader, PICC_AUTHENT1A, 0x11, key, uid);
+    bench_end(&snap, "auth", status);
+
+    for (uint8_t i = 0; i < 16; i++)
+        buf[i] = i;
+
+    bench_begin(&snap);
+    status = PcdWrite(&reader, 0x11, buf);
+    bench_end(&snap, "write", status);
+
+    bench_begin(&snap);
+    status = PcdRead(&reader, 0x11, buf);
+    bench_end(&snap, "read", status);
+
+#if RFID_CFG_TRACE
+    PcdTraceDump(&reader);
+#endif
+
+    /* 整卡读取: 每块认证一次(同 MFRC522_DumpClassic1K) 与 每扇区认证一次 */
+    bench_begin(&snap);
+    for (uint8_t i = 0; i < RFID_M1_SIZE / 16; i++)
+    {
+        status = PcdAuthState(&reader, PICC_AUTHENT1A, i, key, uid);
+        if (status == MI_OK)
+            status = PcdRead(&reader, i, &image[0][i * 16]);
+        if (status != MI_OK)
+            break;
+    }
+    bench_end(&snap, "dump(block)", status);
+
+    memcpy(card_info.uid, uid, 4);
+    card_info.uid_len = 4;
+    bench_begin(&snap);
+    status = PcdReadCard(&reader, &card_info, PICC_AUTHENT1A, key, image[1], sector_status, 0);
+    bench_end(&snap, "dump(sector)", status);
+    if (memcmp(image[0], image[1], RFID_M1_SIZE))
+    {
+        printf("dump mismatch\r\n");
+        return 1;
+    }
+
+    /* 密钥字典: 扇区 s 的 A 密钥为 dict[s % 4], 第一遍逐个猜测, 第二遍命中缓存 */
+    for (uint8_t i = 0; i < RFID_M1_SECTORS; i++)
+        memcpy(&sim.cards[card].mem[(i * RFID_M1_SECTOR_BLOCKS + 3) * 16], dict[i % 4], 6);
+    PcdKeyDictInit(dict, 4);
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        bench_begin(&snap);
+        for (uint8_t i = 0; i < RFID_M1_SECTORS; i++)
+        {
+            uint8_t idx;
+
+            status = PcdAuthDict(&reader, &card_info, PICC_AUTHENT1A, i, &idx);
+            if (status == MI_OK)
+                status = PcdReadSector(&reader, i, PICC_AUTHENT1A, PcdKeyDictGet(idx), uid, &image[1][i * 64],
+                                       0);
+            if (status != MI_OK)
+                break;
+        }
+        bench_end(&snap, pass ? "dict(warm)" : "dict(cold)", status);
+    }
+
+    /* 钱包扣款, 主块 0x10, 备份块 0x12: 读-改-写 与 卡片值操作 */
+    {
+        const uint8_t *wallet_key = dict[0];
+        int32_t value, backup;
+        uint32_t amount;
+        uint8_t live;
+
+        PcdAuthSector(&reader, PICC_AUTHENT1A, 0x10, wallet_key, uid);
+        PcdWriteValue(&reader, 0x10, 1000);
+
+        bench_begin(&snap);
+        status = ReadAmount(&reader, 0x10, &amount);
+        if (status == MI_OK)
+            status = WriteAmount(&reader, 0x10, amount - 10);
+        bench_end(&snap, "debit(rmw)", status);
+
+        bench_begin(&snap);
+        status = PcdValue(&reader, PICC_DECREMENT, 0x10, 10);
+        if (status == MI_OK)
+            status = PcdTransfer(&reader, 0x10);
+        bench_end(&snap, "debit(value)", status);
+
+        bench_begin(&snap);
+        status = ReadAmount(&reader, 0x10, &amount);
+        if (status == MI_OK)
+            status = WriteAmount(&reader, 0x12, amount);
+        if (status == MI_OK)
+            status = WriteAmount(&reader, 0x10, amount - 10);
+        bench_end(&snap, "debit(rmw+bak)", status);
+
+        bench_begin(&snap);
+        status = PcdDecrementTransfer(&reader, 0x10, 0x12, 10);
+        bench_end(&snap, "debit(dec+bak)", status);
+
+        /* 0x12 为当前块, 0x10 保留扣款前的余额 */
+        if (PcdReadValue(&reader, 0x12, &value) != MI_OK || PcdReadValue(&reader, 0x10, &backup) != MI_OK ||
+            value != 960 || backup != 970)
+        {
+            printf("wallet mismatch: %d %d\r\n", value, backup);
+            return 1;
+        }
+
+        bench_begin(&snap);
+        status = PcdReadValuePair(&reader, 0x10, 0x12, &live, &value);
+        if (status == MI_OK)
+            status = PcdDecrementTransfer(&reader, live, (live == 0x10) ? 0x12 : 0x10, 10);
+        bench_end(&snap, "debit(pair)", status);
+
+        if (status != MI_OK || live != 0x12 || PcdReadValuePair(&reader, 0x10, 0x12, &live, &value) != MI_OK ||
+            live != 0x10 || value != 950)
+        {
+            printf("wallet mismatch: %02X %d\r\n", live, value);
+            return 1;
+        }
+    }
+
+    bench_begin(&snap);
+    status = PcdHalt(&reader);
+    bench_end(&snap, "halt", status);
+
+#if RFID_CFG_STATS
+    if (bench_stats())
+        return 1;
+#endif
+
+    return bench_enum();
+}
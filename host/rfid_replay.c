@@ -0,0 +1,479 @@
+/**
+ * 主机端回放基准: 用录制的卡片应答(UID, ATQA/SAK, 块内容, 帧等待时间)与注入的冲突/CRC错误驱动仿真 RC522,
+ * 按场景统计射频帧数, SPI 事务数, SPI 字节数与模型耗时. 仿真是确定性的, 结果可与基线逐项比较,
+ * 作为驱动改动的回归门限.
+ *
+ * 编译:
+ *   gcc -O2 -Isrc -Ihost src/rfid.c host/rc522_sim.c host/rfid_replay.c -o rfid_replay
+ *   使用CRC协处理器时加 -DRFID_CFG_SW_CRC=0, 与 host/replay_baseline_hwcrc.txt 比较
+ *
+ * 用法:
+ *   ./rfid_replay [-c card.mfd] [-b baseline] [-w baseline]
+ *     -c  用 1K 卡片映像(.mfd, 按块地址排列的 1024 字节)替换单卡场景的卡片, 所有扇区 A 密钥须相同
+ *     -b  与基线比较, 任一场景结果不同或帧数/事务数/字节数/耗时增加时返回 1
+ *     -w  写出基线
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfid.h"
+#include "rc522_sim.h"
+
+/* clang-format off */
+#define REPLAY_MAX_ROWS         (64)
+#define REPLAY_IDLE_POLLS       (50)
+#define REPLAY_RETRY            (3)
+#define REPLAY_WALLET           (8)     //钱包当前块, 另一块紧随其后
+/* clang-format on */
+
+/**
+ * @brief 录制的卡片应答参数
+ */
+struct replay_card_t
+{
+    uint8_t uid[10];
+    uint8_t uid_len;
+    uint8_t atqa[2];
+    uint8_t sak;
+    uint32_t fdt_ns;
+};
+
+struct replay_fault_t
+{
+    uint32_t frame; /* 场景内第几个射频帧, 从1开始 */
+    uint8_t type;   /* SIM_FAULT_* */
+};
+
+struct replay_scenario_t
+{
+    const char *name;
+    const struct replay_card_t *cards;
+    uint8_t n_cards;
+    const struct replay_fault_t *faults;
+    uint8_t n_faults;
+    int (*run)(void);
+};
+
+struct replay_mode_t
+{
+    const char *name;
+    uint8_t hwspi;
+    uint8_t irq;
+};
+
+struct replay_row_t
+{
+    char mode[16];
+    char name[16];
+    char result[8];
+    uint32_t frames;
+    uint32_t xfers;
+    uint32_t bytes;
+    uint32_t faults;
+    double time_us;
+};
+
+static struct rc522_sim_t sim;
+static struct rfid_reader_t reader;
+static uint8_t image[RFID_M1_SIZE];
+static uint8_t key[6];
+
+/* Mifare_One(S50), 帧等待时间按 ISO14443-3 FDT = 1172/fc 计 */
+static struct replay_card_t card_s50 = {{0x3A, 0x5F, 0x91, 0xC4}, 4, {0x04, 0x00}, 0x08, 86 * 1000};
+
+static const struct replay_card_t cards_field[] = {
+    {{0x3A, 0x5F, 0x91, 0xC4}, 4, {0x04, 0x00}, 0x08, 86 * 1000},
+    /* 与上一张卡前两字节相同, 冲突位落在第三字节 */
+    {{0x3A, 0x5F, 0x11, 0xC4}, 4, {0x04, 0x00}, 0x08, 86 * 1000},
+    /* Mifare_One(S70) */
+    {{0x7D, 0x12, 0xC9, 0xA0}, 4, {0x02, 0x00}, 0x18, 86 * 1000},
+    /* Ultralight */
+    {{0x04, 0xA2, 0x3B, 0x1A, 0x5C, 0x2D, 0x80}, 7, {0x44, 0x00}, 0x00, 91 * 1000},
+    /* DESFire EV1 */
+    {{0x04, 0x51, 0x29, 0xB2, 0x7C, 0x33, 0x80}, 7, {0x44, 0x03}, 0x20, 96 * 1000},
+};
+
+/* 单卡场景帧序: 1 WUPA, 2 ANTICOLL, 3 SELECT, 4 AUTH, 5 READ */
+static const struct replay_fault_t faults_read[] = {{5, SIM_FAULT_CRC}};
+static const struct replay_fault_t faults_dump[] = {
+    {4, SIM_FAULT_MUTE}, {12, SIM_FAULT_CRC}, {30, SIM_FAULT_COLL}};
+static const struct replay_fault_t faults_multi[] = {{2, SIM_FAULT_COLL}, {9, SIM_FAULT_MUTE}};
+
+/**
+ * @brief 默认卡片映像: 厂商块, 一块标识, 一对钱包块, 其余数据块按地址填充, 扇区尾块为出厂值
+ */
+static void replay_image_default(void)
+{
+    static const uint8_t trailer[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t maker[12] = {0x08, 0x04, 0x00, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x00};
+
+    for (uint32_t i = 0; i < RFID_M1_SIZE; i++)
+        image[i] = (uint8_t)((i * 7) ^ (i >> 4) ^ 0x5A);
+    for (uint8_t s = 0; s < RFID_M1_SECTORS; s++)
+        memcpy(&image[(s * RFID_M1_SECTOR_BLOCKS + 3) * 16], trailer, 16);
+
+    memcpy(image, card_s50.uid, 4);
+    image[4] = card_s50.uid[0] ^ card_s50.uid[1] ^ card_s50.uid[2] ^ card_s50.uid[3];
+    memcpy(&image[5], maker, sizeof(maker) - 1);
+    memcpy(&image[1 * 16], "SP_RFID REPLAY01", 16);
+}
+
+static int replay_image_load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    size_t n;
+
+    if (fp == NULL)
+        return -1;
+    n = fread(image, 1, RFID_M1_SIZE, fp);
+    fclose(fp);
+
+    return (n == RFID_M1_SIZE) ? 0 : -1;
+}
+
+/**
+ * @brief 按值块格式写入仿真卡片存储
+ */
+static void replay_value_put(uint8_t *blk, int32_t value, uint8_t addr)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        blk[i] = (uint8_t)(value >> (8 * i));
+        blk[4 + i] = (uint8_t)(~value >> (8 * i));
+        blk[8 + i] = (uint8_t)(value >> (8 * i));
+    }
+    blk[12] = addr;
+    blk[13] = ~addr;
+    blk[14] = addr;
+    blk[15] = ~addr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//场景
+///////////////////////////////////////////////////////////////////////////////
+static int replay_idle(void)
+{
+    uint8_t type[2];
+
+    for (uint8_t i = 0; i < REPLAY_IDLE_POLLS; i++)
+    {
+        if (PcdRequest(&reader, PICC_REQIDL, type) != MI_NOTAGERR)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int replay_read(void)
+{
+    struct rfid_card_t card;
+    uint8_t buf[16], status = MI_ERR;
+
+    if (PcdActivate(&reader, PICC_REQALL, &card) != MI_OK ||
+        PcdAuthSector(&reader, PICC_AUTHENT1A, 4, key, card.uid) != MI_OK)
+        return -1;
+
+    /* 读出错时卡片仍处于认证状态, 直接重读 */
+    for (uint8_t i = 0; i < REPLAY_RETRY && status != MI_OK; i++)
+        status = PcdRead(&reader, 4, buf);
+
+    return (status == MI_OK && !memcmp(buf, &image[4 * 16], 16)) ? 0 : -1;
+}
+
+static int replay_dump(void)
+{
+    static uint8_t out[RFID_M1_SIZE];
+    uint8_t sector_status[RFID_M1_SECTORS];
+    struct rfid_card_t card;
+
+    if (PcdActivate(&reader, PICC_REQALL, &card) != MI_OK)
+        return -1;
+
+    PcdReadCard(&reader, &card, PICC_AUTHENT1A, key, out, sector_status, 0);
+
+    /* 失败的扇区重新唤醒后补读 */
+    for (uint8_t s = 0; s < RFID_M1_SECTORS; s++)
+    {
+        for (uint8_t i = 0; i < REPLAY_RETRY && sector_status[s] != MI_OK; i++)
+        {
+            sector_status[s] = PcdWakeup(&reader, &card);
+            if (sector_status[s] == MI_OK)
+                sector_status[s] = PcdReadSector(&reader, s, PICC_AUTHENT1A, key, card.uid,
+                                                 &out[s * RFID_M1_SECTOR_BLOCKS * 16], 0);
+        }
+        if (sector_status[s] != MI_OK)
+            return -1;
+    }
+
+    /* 尾块的 A 密钥不可读, 仅比较数据块 */
+    for (uint8_t b = 0; b < RFID_M1_SIZE / 16; b++)
+    {
+        if ((b % RFID_M1_SECTOR_BLOCKS) != 3 && memcmp(&out[b * 16], &image[b * 16], 16))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int replay_multi(void)
+{
+    struct rfid_card_t cards[SIM_MAX_CARDS];
+    uint8_t count = 0;
+
+    if (PcdEnumerate(&reader, PICC_REQALL, cards, SIM_MAX_CARDS, &count) != MI_OK)
+        return -1;
+
+    return (count == sim.n_cards) ? 0 : -1;
+}
+
+static int replay_wallet(void)
+{
+    struct rfid_card_t card;
+
+    if (PcdActivate(&reader, PICC_REQALL, &card) != MI_OK ||
+        PcdAuthSector(&reader, PICC_AUTHENT1A, REPLAY_WALLET, key, card.uid) != MI_OK ||
+        PcdDecrementTransfer(&reader, REPLAY_WALLET, REPLAY_WALLET + 1, 10) != MI_OK)
+        return -1;
+
+    return 0;
+}
+
+static const struct replay_scenario_t scenarios[] = {
+    {"idle", NULL, 0, NULL, 0, replay_idle},
+    {"read", &card_s50, 1, NULL, 0, replay_read},
+    {"read+crc", &card_s50, 1, faults_read, 1, replay_read},
+    {"dump", &card_s50, 1, NULL, 0, replay_dump},
+    {"dump+noise", &card_s50, 1, faults_dump, 3, replay_dump},
+    {"multi", cards_field, 5, NULL, 0, replay_multi},
+    {"multi+noise", cards_field, 5, faults_multi, 2, replay_multi},
+    {"wallet", &card_s50, 1, NULL, 0, replay_wallet},
+};
+
+static const struct replay_mode_t modes[] = {
+    {"bitbang", 0, 0},
+    {"hwspi", 1, 0},
+    {"irq", 1, 1},
+};
+
+static void replay_setup(const struct replay_mode_t *mode, const struct replay_scenario_t *sc)
+{
+    rc522_sim_init(&sim);
+    if (mode->hwspi)
+        rc522_sim_timing_hwspi(&sim, 10 * 1000 * 1000);
+    rc522_sim_wire_irq(&sim, mode->irq);
+
+    for (uint8_t i = 0; i < sc->n_cards; i++)
+    {
+        const struct replay_card_t *rc = &sc->cards[i];
+        struct sim_card_t *card;
+        int idx = rc522_sim_add_card(&sim, rc->uid, rc->uid_len);
+
+        if (idx < 0)
+            continue;
+        card = &sim.cards[idx];
+        card->atqa[0] = rc->atqa[0];
+        card->atqa[1] = rc->atqa[1];
+        card->sak = rc->sak;
+        card->fdt_ns = rc->fdt_ns;
+        if (sc->n_cards == 1)
+            memcpy(card->mem, image, RFID_M1_SIZE);
+    }
+
+    Pcd_port_init(&reader, rc522_sim_port(&sim));
+    PcdReset(&reader);
+    PcdAntennaOn(&reader);
+    M500PcdConfigISOType(&reader, 'A');
+
+    /* 场景从零开始计数, 故障按场景内的帧序注入 */
+    rc522_sim_reset_stats(&sim);
+    for (uint8_t i = 0; i < sc->n_faults; i++)
+        rc522_sim_fault(&sim, sc->faults[i].frame, sc->faults[i].type);
+}
+
+static void replay_run(const struct replay_mode_t *mode, const struct replay_scenario_t *sc,
+                       struct replay_row_t *row)
+{
+    uint64_t start_ns;
+    int ret;
+
+    replay_setup(mode, sc);
+    if (!strcmp(sc->name, "wallet"))
+    {
+        replay_value_put(&sim.cards[0].mem[REPLAY_WALLET * 16], 1000, REPLAY_WALLET);
+        replay_value_put(&sim.cards[0].mem[(REPLAY_WALLET + 1) * 16], 1000, REPLAY_WALLET);
+    }
+
+    start_ns = sim.now_ns;
+    ret = sc->run();
+
+    memset(row, 0, sizeof(*row));
+    snprintf(row->mode, sizeof(row->mode), "%s", mode->name);
+    snprintf(row->name, sizeof(row->name), "%s", sc->name);
+    row->frames = sim.stats.rf_frames;
+    row->xfers = sim.stats.transactions;
+    row->bytes = sim.stats.spi_bytes;
+    row->faults = sim.stats.faults;
+    row->time_us = (sim.now_ns - start_ns) / 1000.0;
+
+    if (ret == 0 && !strcmp(sc->name, "wallet"))
+    {
+        const uint8_t *blk = sim.cards[0].mem;
+
+        /* 减值结果在后一块, 原块保留扣款前的余额 */
+        if (memcmp(&blk[REPLAY_WALLET * 16], "\xE8\x03\x00\x00", 4) ||
+            memcmp(&blk[(REPLAY_WALLET + 1) * 16], "\xDE\x03\x00\x00", 4))
+            ret = -1;
+    }
+    /* 故障未全部命中时场景已偏离录制的帧序 */
+    snprintf(row->result, sizeof(row->result), "%s",
+             (ret == 0 && row->faults == sc->n_faults) ? "OK" : "FAIL");
+}
+
+static void replay_print(FILE *fp, const struct replay_row_t *row)
+{
+    fprintf(fp, "%-8s %-12s %-5s %6u %6u %8u %6u %12.1f", row->mode, row->name, row->result, row->frames,
+            row->xfers, row->bytes, row->faults, row->time_us);
+}
+
+/**
+ * @brief 与基线逐行比较
+ *
+ * @return 退化的场景数
+ */
+static int replay_compare(const char *path, const struct replay_row_t *rows, uint32_t n)
+{
+    struct replay_row_t base;
+    char line[256];
+    FILE *fp = fopen(path, "r");
+    uint32_t i, found[REPLAY_MAX_ROWS] = {0};
+    int worse = 0;
+
+    if (fp == NULL)
+    {
+        printf("cannot open %s\r\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#' ||
+            sscanf(line, "%15s %15s %7s %u %u %u %u %lf", base.mode, base.name, base.result, &base.frames,
+                   &base.xfers, &base.bytes, &base.faults, &base.time_us) != 8)
+            continue;
+
+        for (i = 0; i < n; i++)
+        {
+            const struct replay_row_t *row = &rows[i];
+
+            if (strcmp(row->mode, base.mode) || strcmp(row->name, base.name))
+                continue;
+
+            found[i] = 1;
+            if (strcmp(row->result, base.result) || row->frames > base.frames || row->xfers > base.xfers ||
+                row->bytes > base.bytes || row->time_us > base.time_us + 0.05)
+            {
+                printf("REGRESSION %s %s: %s %u frames %u xfers %u bytes %.1f us, baseline %s %u %u %u %.1f\r\n",
+                       row->mode, row->name, row->result, row->frames, row->xfers, row->bytes, row->time_us,
+                       base.result, base.frames, base.xfers, base.bytes, base.time_us);
+                worse++;
+            }
+            else if (row->xfers < base.xfers || row->bytes < base.bytes || row->time_us < base.time_us - 0.05)
+            {
+                printf("improved %s %s: %.1f us (%+.1f%%), %u xfers, %u bytes\r\n", row->mode, row->name,
+                       row->time_us, (row->time_us - base.time_us) * 100.0 / base.time_us,
+                       row->xfers, row->bytes);
+            }
+            break;
+        }
+    }
+    fclose(fp);
+
+    for (i = 0; i < n; i++)
+    {
+        if (!found[i])
+            printf("no baseline for %s %s\r\n", rows[i].mode, rows[i].name);
+    }
+
+    return worse;
+}
+
+int main(int argc, char const *argv[])
+{
+    static struct replay_row_t rows[REPLAY_MAX_ROWS];
+    const char *base_path = NULL, *write_path = NULL;
+    uint32_t n = 0, fail = 0;
+
+    replay_image_default();
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            if (replay_image_load(argv[++i]))
+            {
+                printf("cannot load %s\r\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+        {
+            base_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            write_path = argv[++i];
+        }
+        else
+        {
+            printf("usage: %s [-c card.mfd] [-b baseline] [-w baseline]\r\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* 单卡场景的 UID 与密钥取自映像 */
+    memcpy(card_s50.uid, image, 4);
+    memcpy(key, &image[3 * 16], 6);
+
+    for (uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+    {
+        for (uint8_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+        {
+            replay_run(&modes[m], &scenarios[s], &rows[n]);
+            if (strcmp(rows[n].result, "OK"))
+                fail++;
+            n++;
+        }
+    }
+
+    printf("# %-6s %-12s %-5s %6s %6s %8s %6s %12s\r\n", "mode", "scenario", "result", "frames", "xfers", "bytes",
+           "faults", "time(us)");
+    for (uint32_t i = 0; i < n; i++)
+    {
+        replay_print(stdout, &rows[i]);
+        printf("\r\n");
+    }
+
+    if (write_path)
+    {
+        FILE *fp = fopen(write_path, "w");
+
+        if (fp == NULL)
+        {
+            printf("cannot write %s\r\n", write_path);
+            return 1;
+        }
+        fprintf(fp, "# rfid_replay baseline: mode scenario result frames xfers bytes faults time(us)\n");
+        for (uint32_t i = 0; i < n; i++)
+        {
+            replay_print(fp, &rows[i]);
+            fprintf(fp, "\n");
+        }
+        fclose(fp);
+    }
+
+    if (base_path)
+        fail += replay_compare(base_path, rows, n);
+
+    return fail ? 1 : 0;
+}
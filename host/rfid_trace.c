@@ -0,0 +1,467 @@
+/**
+ * 主机端跟踪解码: 读取 PcdTraceDump 经串口输出的文本, 还原为带注释的 ISO14443A 帧与时序
+ *
+ * 编译:
+ *   gcc -O2 -Isrc -Ihost host/rfid_trace.c -o rfid_trace
+ *
+ * 用法:
+ *   ./rfid_trace [-r] [log]    log 缺省为标准输入, 可含其他串口输出; -r 同时列出每次寄存器访问
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfid.h"
+#include "rfid_isodep.h"
+#include "rfid_ultralight.h"
+
+#define TRACE_MAX_RECS (1 << 16)
+
+struct trace_frame_t
+{
+    uint8_t active;
+    uint8_t op;
+    uint8_t cmd;
+    uint8_t tx_len;
+    uint32_t t0;
+    uint8_t tx[ISODEP_FSD_MAX]; /* 流式收发的帧由多次FIFO读写拼接 */
+    uint16_t tx_n;
+    uint8_t rx[ISODEP_FSD_MAX];
+    uint16_t rx_n;
+    uint8_t rx_last_bits;
+    uint8_t tx_last_bits;
+    uint32_t regs;
+    uint32_t polls;
+};
+
+static const char *const reg_names[0x40] = {
+    "RFU00", "CommandReg", "ComIEnReg", "DivlEnReg", "ComIrqReg", "DivIrqReg", "ErrorReg", "Status1Reg",
+    "Status2Reg", "FIFODataReg", "FIFOLevelReg", "WaterLevelReg", "ControlReg", "BitFramingReg", "CollReg", "RFU0F",
+    "RFU10", "ModeReg", "TxModeReg", "RxModeReg", "TxControlReg", "TxAutoReg", "TxSelReg", "RxSelReg",
+    "RxThresholdReg", "DemodReg", "RFU1A", "RFU1B", "MifareReg", "RFU1D", "RFU1E", "SerialSpeedReg",
+    "RFU20", "CRCResultRegM", "CRCResultRegL", "RFU23", "ModWidthReg", "RFU25", "RFCfgReg", "GsNReg",
+    "CWGsCfgReg", "ModGsCfgReg", "TModeReg", "TPrescalerReg", "TReloadRegH", "TReloadRegL", "TCounterValueRegH",
+    "TCounterValueRegL", "RFU30", "TestSel1Reg", "TestSel2Reg", "TestPinEnReg", "TestPinValueReg", "TestBusReg",
+    "AutoTestReg", "VersionReg", "AnalogTestReg", "TestDAC1Reg", "TestDAC2Reg", "TestADCReg", "RFU3C", "RFU3D",
+    "RFU3E", "RFU3F"};
+
+static const char *const op_names[RFID_OP_MAX] = {
+    "REQUEST", "ANTICOLL", "SELECT", "AUTH", "READ", "WRITE", "WRITE_DATA", "HALT", "VALUE", "VALUE_DATA",
+    "TRANSFER", "ISODEP"};
+
+static int show_regs;
+
+static const char *status_name(uint8_t status, uint8_t flags)
+{
+    if (flags & 0x01)
+        return "TIMEOUT";
+
+    switch (status)
+    {
+    case MI_OK:
+        return "OK";
+    case MI_NOTAGERR:
+        return "NOTAG";
+    case MI_COLLERR:
+        return "COLL";
+    case MI_BUSY:
+        return "BUSY";
+    default:
+        return "ERR";
+    }
+}
+
+static void print_bytes(char *out, size_t size, const uint8_t *data, uint16_t len, uint8_t last_bits)
+{
+    size_t pos = 0;
+    uint16_t i;
+
+    out[0] = 0;
+    for (i = 0; i < len && pos + 8 < size; i++)
+        pos += snprintf(out + pos, size - pos, "%s%02X", i ? " " : "", data[i]);
+    if (i < len)
+        pos += snprintf(out + pos, size - pos, " ..");
+    if (last_bits && pos + 4 < size)
+        snprintf(out + pos, size - pos, "/%u", last_bits);
+}
+
+/**
+ * @brief 按PCB注释 ISO14443-4 块, 数据不含CRC_A
+ */
+static void annotate_block(const uint8_t *blk, uint16_t len, char *out, size_t size)
+{
+    uint8_t pcb = blk[0];
+
+    if ((pcb & 0xE2) == ISODEP_PCB_I)
+        snprintf(out, size, "I(%u)%s, %u INF bytes", pcb & ISODEP_PCB_BN, (pcb & ISODEP_PCB_CHAIN) ? " chained" : "",
+                 len - 1);
+    else if ((pcb & 0xE6) == 0xA2)
+        snprintf(out, size, "R(%s)(%u)", (pcb & 0x10) ? "NAK" : "ACK", pcb & ISODEP_PCB_BN);
+    else if ((pcb & 0xF7) == ISODEP_PCB_S_WTX && len >= 2)
+        snprintf(out, size, "S(WTX) WTXM %u", blk[1] & 0x3F);
+    else if ((pcb & 0xF7) == ISODEP_PCB_S_DESELECT)
+        snprintf(out, size, "S(DESELECT)");
+}
+
+/**
+ * @brief 按首字节注释主机发出的帧
+ */
+static void annotate_tx(const struct trace_frame_t *f, char *out, size_t size)
+{
+    const uint8_t *tx = f->tx;
+
+    out[0] = 0;
+    if (f->tx_n == 0)
+        return;
+
+    if (f->cmd == PCD_AUTHENT)
+    {
+        if (f->tx_n >= 12)
+            snprintf(out, size, "AUTH key %c, block %u, uid %02X%02X%02X%02X", (tx[0] == PICC_AUTHENT1B) ? 'B' : 'A',
+                     tx[1], tx[8], tx[9], tx[10], tx[11]);
+        return;
+    }
+
+    switch (f->op)
+    {
+    case RFID_OP_WRITE_DATA:
+        if (tx[0] == PICC_UL_WRITE && f->tx_n == 8)
+            snprintf(out, size, "WRITE page %u", tx[1]);
+        else
+            snprintf(out, size, "block data");
+        return;
+    case RFID_OP_VALUE_DATA:
+        if (f->tx_n >= 4)
+            snprintf(out, size, "operand %u", tx[0] | (tx[1] << 8) | (tx[2] << 16) | ((uint32_t)tx[3] << 24));
+        return;
+    case RFID_OP_ISODEP:
+        if (tx[0] == PICC_RATS && f->tx_n >= 2)
+            snprintf(out, size, "RATS FSDI %u", tx[1] >> 4);
+        else if (tx[0] == PICC_PPS && f->tx_n >= 3)
+            snprintf(out, size, "PPS DSI %u DRI %u", (tx[2] >> 2) & 0x03, tx[2] & 0x03);
+        else
+            annotate_block(tx, (f->tx_n > 2) ? f->tx_n - 2 : 1, out, size);
+        return;
+    default:
+        break;
+    }
+
+    switch (tx[0])
+    {
+    case PICC_REQIDL:
+        snprintf(out, size, "REQA");
+        break;
+    case PICC_REQALL:
+        snprintf(out, size, "WUPA");
+        break;
+    case PICC_ANTICOLL1:
+    case PICC_ANTICOLL2:
+    case PICC_ANTICOLL3:
+        if (f->tx_n >= 2 && tx[1] == 0x70)
+            snprintf(out, size, "SELECT CL%u", (tx[0] - PICC_ANTICOLL1) / 2 + 1);
+        else if (f->tx_n >= 2)
+            snprintf(out, size, "ANTICOLL CL%u, %u known bits", (tx[0] - PICC_ANTICOLL1) / 2 + 1,
+                     ((tx[1] >> 4) - 2) * 8 + (tx[1] & 0x0F));
+        break;
+    case PICC_HALT:
+        snprintf(out, size, "HLTA");
+        break;
+    case PICC_READ:
+        snprintf(out, size, "READ block %u", tx[1]);
+        break;
+    case PICC_WRITE:
+        snprintf(out, size, "WRITE block %u", tx[1]);
+        break;
+    case PICC_DECREMENT:
+        snprintf(out, size, "DECREMENT block %u", tx[1]);
+        break;
+    case PICC_INCREMENT:
+        snprintf(out, size, "INCREMENT block %u", tx[1]);
+        break;
+    case PICC_RESTORE:
+        snprintf(out, size, "RESTORE block %u", tx[1]);
+        break;
+    case PICC_TRANSFER:
+        snprintf(out, size, "TRANSFER block %u", tx[1]);
+        break;
+    case PICC_UL_GET_VERSION:
+        snprintf(out, size, "GET_VERSION");
+        break;
+    case PICC_UL_FAST_READ:
+        if (f->tx_n >= 3)
+            snprintf(out, size, "FAST_READ pages %u-%u", tx[1], tx[2]);
+        break;
+    case PICC_UL_PWD_AUTH:
+        snprintf(out, size, "PWD_AUTH");
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 按操作类型注释卡片应答
+ */
+static void annotate_rx(const struct trace_frame_t *f, char *out, size_t size)
+{
+    const uint8_t *rx = f->rx;
+
+    out[0] = 0;
+    if (f->rx_n == 0)
+        return;
+
+    //4位应答
+    if (f->rx_n == 1 && f->rx_last_bits == 4)
+    {
+        snprintf(out, size, ((rx[0] & 0x0F) == 0x0A) ? "ACK" : "NAK");
+        return;
+    }
+
+    switch (f->op)
+    {
+    case RFID_OP_REQUEST:
+        snprintf(out, size, "ATQA %02X%02X", rx[0], rx[1]);
+        break;
+    case RFID_OP_ANTICOLL:
+        if (f->rx_n >= 5)
+            snprintf(out, size, "UID part + BCC%s", (rx[0] == PICC_CT) ? ", cascade tag" : "");
+        break;
+    case RFID_OP_SELECT:
+        snprintf(out, size, "SAK %02X%s", rx[0], (rx[0] & 0x04) ? ", UID not complete" : "");
+        break;
+    case RFID_OP_READ:
+        snprintf(out, size, "%u data bytes + CRC_A", (f->rx_n > 2) ? f->rx_n - 2 : 0);
+        break;
+    case RFID_OP_AUTH:
+        if (f->tx[0] == PICC_UL_PWD_AUTH && f->rx_n == 4)
+            snprintf(out, size, "PACK %02X%02X", rx[0], rx[1]);
+        break;
+    case RFID_OP_WRITE:
+    case RFID_OP_WRITE_DATA:
+    case RFID_OP_VALUE:
+    case RFID_OP_VALUE_DATA:
+    case RFID_OP_TRANSFER:
+    case RFID_OP_HALT:
+        snprintf(out, size, ((rx[0] & 0x0F) == 0x0A) ? "ACK" : "NAK");
+        break;
+    case RFID_OP_ISODEP:
+        if (f->tx[0] == PICC_RATS)
+            snprintf(out, size, "ATS, %u bytes", rx[0]);
+        else if (f->tx[0] == PICC_PPS)
+            snprintf(out, size, "PPS response");
+        else
+            annotate_block(rx, (f->rx_n > 2) ? f->rx_n - 2 : 1, out, size);
+        break;
+    default:
+        break;
+    }
+}
+
+static void print_reg(uint32_t t, const uint8_t *rec)
+{
+    if (rec[0] == RFID_TRACE_RD && rec[3])
+        printf("  %10u   rd %-16s %02X  x%u\n", t, reg_names[rec[1] & 0x3F], rec[2], rec[3] + 1);
+    else
+        printf("  %10u   %s %-16s %02X\n", t, (rec[0] == RFID_TRACE_RD) ? "rd" : "wr", reg_names[rec[1] & 0x3F],
+               rec[2]);
+}
+
+static void decode(const uint8_t *recs, uint32_t count, uint32_t total)
+{
+    struct trace_frame_t f;
+    uint32_t i = 0, t, t_prev = 0, idle_regs = 0, frames = 0;
+    char tx_hex[200], rx_hex[200], tx_note[80], rx_note[80];
+
+    memset(&f, 0, sizeof(f));
+    printf("%u records, %u written, %u overwritten\n", count, total, total - count);
+    printf("  %10s %8s  %-10s %-7s %5s %5s\n", "t(us)", "dur(us)", "op", "result", "regs", "polls");
+
+    //最旧的几条可能是失去了头记录的数据
+    while (i < count && recs[i * 8] == RFID_TRACE_DATA)
+        i++;
+
+    for (; i < count; i++)
+    {
+        const uint8_t *rec = &recs[i * 8];
+        uint8_t type = rec[0], n;
+        uint8_t *dst;
+        uint16_t *dst_n;
+
+        t = rec[4] | (rec[5] << 8) | (rec[6] << 16) | ((uint32_t)rec[7] << 24);
+
+        switch (type)
+        {
+        case RFID_TRACE_RD:
+        case RFID_TRACE_WR:
+            if (show_regs)
+                print_reg(t, rec);
+            if (!f.active)
+            {
+                idle_regs += 1 + ((type == RFID_TRACE_RD) ? rec[3] : 0);
+                break;
+            }
+            f.regs += 1 + ((type == RFID_TRACE_RD) ? rec[3] : 0);
+            if (type == RFID_TRACE_RD && rec[1] == ComIrqReg)
+                f.polls += 1 + rec[3];
+            if (type == RFID_TRACE_RD && rec[1] == ControlReg)
+                f.rx_last_bits = rec[2] & 0x07;
+            if (type == RFID_TRACE_WR && rec[1] == BitFramingReg && !(rec[2] & 0x80))
+                f.tx_last_bits = rec[2] & 0x07;
+            break;
+
+        case RFID_TRACE_FIFO_RD:
+        case RFID_TRACE_FIFO_WR:
+            //数据记录紧随其后, 每条7字节
+            n = (rec[1] > DEF_FIFO_LENGTH) ? DEF_FIFO_LENGTH : rec[1];
+            dst = (type == RFID_TRACE_FIFO_WR) ? f.tx : f.rx;
+            dst_n = (type == RFID_TRACE_FIFO_WR) ? &f.tx_n : &f.rx_n;
+            for (uint8_t k = 0; k < n; k++)
+            {
+                uint32_t r = i + 1 + k / 7;
+
+                if (r >= count || recs[r * 8] != RFID_TRACE_DATA)
+                {
+                    n = k;
+                    break;
+                }
+                if (f.active && *dst_n + k < ISODEP_FSD_MAX)
+                    dst[*dst_n + k] = recs[r * 8 + 1 + k % 7];
+            }
+            i += (n + 6) / 7;
+            if (show_regs)
+                printf("  %10u   %s FIFO %u bytes\n", t, (type == RFID_TRACE_FIFO_RD) ? "rd" : "wr", n);
+            //帧内的多次FIFO读写依次拼接
+            if (f.active)
+                *dst_n = (*dst_n + n > ISODEP_FSD_MAX) ? ISODEP_FSD_MAX : (*dst_n + n);
+            f.regs += f.active ? 1 : 0;
+            idle_regs += f.active ? 0 : 1;
+            break;
+
+        case RFID_TRACE_FRAME:
+            if (idle_regs)
+                printf("  %10s %8s  %u register accesses outside frames\n", "", "", idle_regs);
+            idle_regs = 0;
+            memset(&f, 0, sizeof(f));
+            f.active = 1;
+            f.op = rec[1];
+            f.cmd = rec[2];
+            f.tx_len = rec[3];
+            f.t0 = t;
+            break;
+
+        case RFID_TRACE_DONE:
+            if (!f.active)
+                break;
+            frames++;
+            //间隔为与上一帧开始的时间差, 便于看出轮询周期
+            printf("  %10u %8u  %-10s %-7s %5u %5u  +%u\n", f.t0, t - f.t0,
+                   (f.op < RFID_OP_MAX) ? op_names[f.op] : "?", status_name(rec[2], rec[3]), f.regs, f.polls,
+                   t_prev ? f.t0 - t_prev : 0);
+            t_prev = f.t0;
+
+            annotate_tx(&f, tx_note, sizeof(tx_note));
+            print_bytes(tx_hex, sizeof(tx_hex), f.tx, f.tx_n, f.tx_last_bits);
+            printf("  %10s %8s    > %-40s %s%s\n", "", "", tx_hex, tx_note,
+                   (f.cmd == PCD_AUTHENT) ? " (key not traced)" : "");
+            //无应答时FIFO读出的是空字节
+            if (f.rx_n && rec[2] != MI_NOTAGERR && !(rec[3] & 0x01))
+            {
+                annotate_rx(&f, rx_note, sizeof(rx_note));
+                print_bytes(rx_hex, sizeof(rx_hex), f.rx, f.rx_n, f.rx_last_bits);
+                printf("  %10s %8s    < %-40s %s\n", "", "", rx_hex, rx_note);
+            }
+            f.active = 0;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (idle_regs)
+        printf("  %10s %8s  %u register accesses outside frames\n", "", "", idle_regs);
+    if (f.active)
+        printf("  %10u %8s  %-10s unfinished\n", f.t0, "", (f.op < RFID_OP_MAX) ? op_names[f.op] : "?");
+    printf("%u frames\n", frames);
+}
+
+static int hex_val(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t recs[TRACE_MAX_RECS * 8];
+    FILE *fp = stdin;
+    char line[1024];
+    uint32_t count = 0, total = 0, expect = 0, dumps = 0, nbytes = 0;
+    int in_dump = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-r"))
+            show_regs = 1;
+        else if (!(fp = fopen(argv[i], "r")))
+        {
+            perror(argv[i]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *p = strstr(line, "RFID TRACE");
+
+        if (p && !strncmp(p, "RFID TRACE END", 14))
+        {
+            if (in_dump)
+            {
+                if (count != expect)
+                    printf("warning: %u records expected, %u read\n", expect, count);
+                decode(recs, count, total);
+                dumps++;
+            }
+            in_dump = 0;
+            continue;
+        }
+
+        if (p && sscanf(p, "RFID TRACE %u %u", &expect, &total) == 2)
+        {
+            in_dump = 1;
+            count = 0;
+            nbytes = 0;
+            continue;
+        }
+
+        if (!in_dump)
+            continue;
+
+        //每条记录16个十六进制字符, 行尾等其他字符忽略
+        for (char *c = line; c[0] && c[1] && nbytes < sizeof(recs); c++)
+        {
+            int hi = hex_val(c[0]), lo = hex_val(c[1]);
+
+            if (hi < 0 || lo < 0)
+                continue;
+            recs[nbytes++] = (uint8_t)((hi << 4) | lo);
+            c++;
+        }
+        count = nbytes / 8;
+    }
+
+    if (dumps == 0)
+    {
+        fprintf(stderr, "no RFID TRACE dump found\n");
+        return 1;
+    }
+
+    return 0;
+}
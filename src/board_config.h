@@ -5,10 +5,26 @@
 #define RFID_CK_PIN (21)
 #define RFID_MO_PIN (8)
 #define RFID_MI_PIN (15)
+#define RFID_IRQ_PIN (6)
 
 #define RFID_CS_HSNUM (20)
 #define RFID_CK_HSNUM (21)
 #define RFID_MO_HSNUM (8)
 #define RFID_MI_HSNUM (15)
+#define RFID_IRQ_HSNUM (6)
+
+/* 共用 CLK/MOSI/MISO 的读卡器个数, 第2~4个读卡器的片选 */
+#define RFID_READER_NUM (1)
+
+/* 1: 射频引擎运行在核1, 经无锁环与核0交换数据; 0: 在核0主循环中执行 */
+#define RFID_RF_CORE (1)
+
+#define RFID_CS1_PIN (22)
+#define RFID_CS2_PIN (23)
+#define RFID_CS3_PIN (24)
+
+#define RFID_CS1_HSNUM (22)
+#define RFID_CS2_HSNUM (23)
+#define RFID_CS3_HSNUM (24)
 
 #endif  //!__BOARD_CONFIG__H__
@@ -1,4 +1,7 @@
 #include "rfid.h"
+#include "rfid_poll.h"
+#include "rfid_engine.h"
+#include "entry.h"
 #include "fpioa.h"
 #include "gpiohs.h"
 #include "sleep.h"
@@ -6,73 +9,119 @@
 #include "sysctl.h"
 #include "board_config.h"
 
+#include <string.h>
+
+static struct rfid_reader_t readers[RFID_READER_NUM];
+static struct rfid_poll_t polls[RFID_READER_NUM];
+static struct rfid_engine_t engine;
+
+static void rf_init(void)
+{
+    const struct rfid_poll_cfg_t poll_cfg =
+        {.period_us = 20000,
+         .wupa_every = 5,
+         .depart_us = 150000};
+    const uint8_t cs_pin[4] = {RFID_CS_PIN, RFID_CS1_PIN, RFID_CS2_PIN, RFID_CS3_PIN};
+    const uint8_t cs_hsnum[4] = {RFID_CS_HSNUM, RFID_CS1_HSNUM, RFID_CS2_HSNUM, RFID_CS3_HSNUM};
+    struct rfid_io_cfg_t io_cfg =
+        {.hs_clk = RFID_CK_HSNUM,
+         .hs_mosi = RFID_MO_HSNUM,
+         .hs_miso = RFID_MI_HSNUM,
+         .hs_rst = 0xFF,
+         .clk_delay_us = 3,
+         .hs_irq = 0xFF};
+
+    for (int i = 0; i < RFID_READER_NUM; i++)
+    {
+        io_cfg.hs_cs = cs_hsnum[i];
+        io_cfg.cs_pin = cs_pin[i];
+
+        Pcd_io_init(&readers[i], &io_cfg);
+        if (PcdInit(&readers[i]) != MI_OK)
+            printf("reader %d init failed\r\n", i);
+        PcdPollInit(&polls[i], &readers[i], &poll_cfg);
+    }
+}
+
+#if RFID_RF_CORE
+static int rf_core_main(void *ctx)
+{
+    // 在射频核上初始化, IRQ引脚中断注册在本核
+    rf_init();
+    PcdEngineRun(&engine);
+    return 0;
+}
+#endif
+
 int main(int argc, char const *argv[])
 {
-    uint8_t w_buf[16];
-    uint8_t r_buf[16];
-    uint8_t type[2];
-    uint8_t uid[4];
     uint32_t w_val = 110;
     uint32_t r_val;
     uint8_t key[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    struct rfid_engine_event_t ev;
+    struct rfid_engine_cmd_t cmd;
 
     uint32_t freq = 0;
     freq = sysctl_pll_set_freq(SYSCTL_PLL0, 800000000);
     uint64_t core = current_coreid();
     printf("pll freq: %dhz\r\n", freq);
-    const struct rfid_io_cfg_t io_cfg =
-        {.hs_cs = RFID_CS_HSNUM,
-         .hs_clk = RFID_CK_HSNUM,
-         .hs_mosi = RFID_MO_HSNUM,
-         .hs_miso = RFID_MI_HSNUM,
-         .hs_rst = 0xFF,
-         .clk_delay_us = 3};
 
-    Pcd_io_init(&io_cfg);
-    PcdReset();
-    PcdAntennaOn();
-    M500PcdConfigISOType('A');
+    PcdEngineInit(&engine, polls, RFID_READER_NUM);
+#if RFID_RF_CORE
+    register_core1(rf_core_main, NULL);
+#else
+    rf_init();
+#endif
 
     for (int i = 0; i < 16; i++)
     {
-        w_buf[i] = i;
+        cmd.data[i] = i;
     }
 
     while (1)
     {
-        // find card
-        if (PcdRequest(0x52, type) == MI_OK)
-            printf("find card success Tagtype: 0x%x\r\n", type[0] << 8 | type[1]);
-        msleep(100);
-
-        // get uid
-        if (PcdAnticoll(uid) != MI_OK)
-            continue;
-        printf("uid: %x,%x,%x,%x\r\n", uid[0], uid[1], uid[2], uid[3]);
-        msleep(100);
-
-        // select card
-        if (PcdSelect(uid) == MI_OK)
-            printf("pcd select success\r\n");
-        msleep(100);
-
-        // auth key
-        if (PcdAuthState(0x60, 0x11, key, uid) != MI_OK)
-            continue;
-        printf("auth success\r\n");
-
-        // write
-        if (PcdWrite(0x11, w_buf) == MI_OK)
-            printf("write success\r\n");
-        msleep(100);
-
-        // read
-        if (PcdRead(0x11, &r_buf) == MI_OK)
+#if !RFID_RF_CORE
+        // 引擎与应用同在本核, 不等待
+        PcdEngineStep(&engine);
+#endif
+
+        while (PcdEngineGetEvent(&engine, &ev))
         {
-            printf("read success: %d\r\n", r_buf[1]);
-            break;
+            if (ev.type == RFID_ENGINE_EV_READ)
+            {
+                if (ev.status == MI_OK)
+                    printf("read success: %d\r\n", ev.data[1]);
+                continue;
+            }
+
+            if (ev.type == RFID_ENGINE_EV_WRITE)
+            {
+                if (ev.status == MI_OK)
+                    printf("write success\r\n");
+                continue;
+            }
+
+            printf("reader %d %s uid:", ev.reader, (ev.type == RFID_ENGINE_EV_ARRIVED) ? "arrived" : "departed");
+            for (int i = 0; i < ev.card.uid_len; i++)
+                printf(" %02x", ev.card.uid[i]);
+            printf(", Tagtype: 0x%x, sak: 0x%x\r\n", ev.card.atqa[0] << 8 | ev.card.atqa[1], ev.card.sak);
+
+            if (ev.type != RFID_ENGINE_EV_ARRIVED)
+                continue;
+
+            // 射频核按UID唤醒选卡并认证, 先写后读, 结果经事件环返回
+            cmd.reader = ev.reader;
+            cmd.auth_mode = 0x60;
+            cmd.addr = 0x11;
+            memcpy(cmd.key, key, 6);
+            cmd.card = ev.card;
+            cmd.tag = 0;
+
+            cmd.type = RFID_ENGINE_CMD_WRITE;
+            PcdEngineSubmit(&engine, &cmd);
+            cmd.type = RFID_ENGINE_CMD_READ;
+            PcdEngineSubmit(&engine, &cmd);
         }
-        sleep(2);
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -1,61 +1,263 @@
 #include "rfid.h"
 
-#include "fpioa.h"
-#include "gpiohs.h"
-#include "sleep.h"
+#include "rfid_config.h"
+#include "rfid_port.h"
+
+#include <stddef.h>
+
 #include "printf.h"
 
-#include "board_config.h"
+/* 定时器分频: 13.56MHz / (2 * 67 + 1) ≈ 100kHz, 每个计数约10us */
+#define PCD_TIMER_PRESCALER (67)
+/* 12位分频的上限, 每个计数约604us, 0x10000 个计数约39.6s */
+#define PCD_TIMER_PRESCALER_MAX (0xFFF)
+/* 106kbit/s 下每字节(含奇偶校验位)空中传输时间, us */
+#define PCD_BYTE_AIR_US (86)
+
+/*
+ * 帧等待时间, 定时器在发送结束时启动, 收到第一位时停止:
+ * ISO14443-3 REQA/WUPA/防冲撞/选卡 FDT 固定为 1236/fc ≈ 91us, 留约3倍余量;
+ * HALT 在1ms内无应答即视为成功; MIFARE Classic 读/写/认证每一步 ACK 不超过1ms,
+ * 写数据阶段与传送含EEPROM编程时间, 取10ms; 值操作第二阶段卡片只回NAK, 等满1ms即视为成功.
+ * ISO14443-4 取激活帧等待时间 FWT_ACTIVATION = 71680/fc ≈ 5.3ms, 收到 ATS 后按卡片的 FWI 改写.
+ */
+static const uint32_t pcd_timeout_default_us[RFID_OP_MAX] = {
+    [RFID_OP_REQUEST] = 300,
+    [RFID_OP_ANTICOLL] = 300,
+    [RFID_OP_SELECT] = 300,
+    [RFID_OP_AUTH] = 1000,
+    [RFID_OP_READ] = 1000,
+    [RFID_OP_WRITE] = 1000,
+    [RFID_OP_WRITE_DATA] = 10000,
+    [RFID_OP_HALT] = 1000,
+    [RFID_OP_VALUE] = 1000,
+    [RFID_OP_VALUE_DATA] = 1000,
+    [RFID_OP_TRANSFER] = 10000,
+    [RFID_OP_ISODEP] = 5300,
+};
+
+/* 软复位或退出软掉电后等待振荡器起振的上限 */
+#define PCD_RESET_TIMEOUT_US (50000)
+
+/* 复位后的工作方式, 按序写入 */
+static const uint8_t pcd_reset_regs[][2] = {
+    {ModeReg, 0x3D},                               //和Mifare卡通讯, CRC初始值0x6363
+    {TModeReg, 0x80 | (PCD_TIMER_PRESCALER >> 8)}, //TAuto=1: 发送结束后自动启动定时器, 重载值由每次通讯按操作设置
+    {TPrescalerReg, PCD_TIMER_PRESCALER & 0xFF},   //定时器分频系数
+    {TxAutoReg, 0x40},                             //调制发送信号为100%ASK
+};
+
+/* ISO14443A 接收配置 */
+static const uint8_t pcd_iso_a_regs[][2] = {
+    {RxSelReg, 0x86}, //内部模拟接收, RxWait 6位
+    {RFCfgReg, 0x7F}, //接收增益48dB
+};
+
+/* 各发送速率的 ModWidthReg 调制脉宽 */
+static const uint8_t pcd_mod_width[4] = {0x26, 0x15, 0x0A, 0x05};
+
+#if RFID_CFG_REG_SHADOW
+/* 只由主机写入, 芯片不会改变的寄存器位; 0xFF 的寄存器读操作直接返回影子值 */
+static const uint8_t shadow_owned[0x40] = {
+    [ComIEnReg] = 0xFF,
+    [DivlEnReg] = 0xFF,
+    [Status2Reg] = 0xC8, //MFCrypto1On 由芯片置位, 软件只能清零
+    [WaterLevelReg] = 0x3F,
+    [BitFramingReg] = 0xFF,
+    [CollReg] = 0x80, //其余位只读
+    [ModeReg] = 0xFF,
+    [TxModeReg] = 0xFF,
+    [RxModeReg] = 0xFF,
+    [TxControlReg] = 0xFF,
+    [TxAutoReg] = 0xFF,
+    [TxSelReg] = 0xFF,
+    [RxSelReg] = 0xFF,
+    [RxThresholdReg] = 0xFF,
+    [DemodReg] = 0xFF,
+    [MifareReg] = 0xFF,
+    [ModWidthReg] = 0xFF,
+    [RFCfgReg] = 0xFF,
+    [GsNReg] = 0xFF,
+    [CWGsCfgReg] = 0xFF,
+    [ModGsCfgReg] = 0xFF,
+    [TModeReg] = 0xFF,
+    [TPrescalerReg] = 0xFF,
+    [TReloadRegH] = 0xFF,
+    [TReloadRegL] = 0xFF,
+};
+
+#define SHADOW_VALID(reader, reg) (((reader)->shadow_valid >> (reg)) & 1)
+#endif
+
+#if RFID_CFG_STATS
+#define STATS_ADD(reader, field, n)             ((reader)->stats.field += (n))
+#else
+#define STATS_ADD(reader, field, n)             ((void)0)
+#endif
+
+#if RFID_CFG_TRACE
+#define TRACE_REG(reader, type, reg, val)       TraceReg(reader, type, reg, val)
+#define TRACE_FIFO(reader, type, data, len)     TraceFifo(reader, type, data, len)
+#else
+#define TRACE_REG(reader, type, reg, val)       ((void)0)
+#define TRACE_FIFO(reader, type, data, len)     ((void)0)
+#endif
+
+#if RFID_CFG_STATS || RFID_CFG_TRACE
+#define FRAME_BEGIN(reader, op, cmd, len)       FrameBegin(reader, op, cmd, len)
+#define FRAME_END(reader, st, tmo)              FrameEnd(reader, st, tmo)
+#else
+#define FRAME_BEGIN(reader, op, cmd, len)       ((void)0)
+#define FRAME_END(reader, st, tmo)              ((void)0)
+#endif
+
+#if RFID_CFG_TRACE
+/**
+  * @brief  写入一条跟踪记录, 环满时覆盖最旧的记录
+  */
+static struct rfid_trace_rec_t *TracePut(struct rfid_reader_t *pReader, uint8_t ucType, uint8_t ucArg0,
+                                         uint8_t ucArg1, uint8_t ucArg2)
+{
+    struct rfid_trace_rec_t *pRec = &pReader->trace[pReader->trace_head++ & (RFID_CFG_TRACE_LEN - 1)];
 
-/* clang-format off */
-#define GPIOHS_OUT_HIGH(io) (*(volatile uint32_t *)0x3800100CU) |= (1 << (io))
-#define GPIOHS_OUT_LOWX(io) (*(volatile uint32_t *)0x3800100CU) &= ~(1 << (io))
+    pRec->type = ucType;
+    pRec->arg[0] = ucArg0;
+    pRec->arg[1] = ucArg1;
+    pRec->arg[2] = ucArg2;
+    pRec->time_us = (ucType == RFID_TRACE_DATA) ? 0 : (uint32_t)PcdTimeUs(pReader);
 
-#define GET_GPIOHS_VALX(io) (((*(volatile uint32_t *)0x38001000U) >> (io)) & 1)
-/* clang-format on */
+    return pRec;
+}
 
-static struct rfid_io_cfg_t spi_io_cfg;
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
 /**
- * @brief io模拟spi读写
- * 
- * @param [in], data: 写的数据
- * 
- * @return 读到的数据
- */
-static uint8_t spi_rw(uint8_t data)
+  * @brief  记录一次寄存器访问, FIFO数据由 TraceFifo 记录
+  * 
+  * @param  [in], ucType: RFID_TRACE_RD 或 RFID_TRACE_WR
+  */
+static void TraceReg(struct rfid_reader_t *pReader, uint8_t ucType, uint8_t ucAddress, uint8_t ucValue)
 {
-    uint8_t temp = 0;
+    struct rfid_trace_rec_t *pRec;
 
-    for (uint8_t i = 0; i < 8; i++)
-    {
-        GPIOHS_OUT_LOWX(spi_io_cfg.hs_clk);
-        usleep(spi_io_cfg.clk_delay_us);
+    if (ucAddress == FIFODataReg)
+        return;
 
-        if (data & 0x80)
-        {
-            GPIOHS_OUT_HIGH(spi_io_cfg.hs_mosi);
-        }
-        else
-        {
-            GPIOHS_OUT_LOWX(spi_io_cfg.hs_mosi);
-        }
-        data <<= 1;
-        temp <<= 1;
-        if (GET_GPIOHS_VALX(spi_io_cfg.hs_miso))
+    //等待完成时重复读到相同的值, 只累加次数, 保留第一次的时间
+    if ((ucType == RFID_TRACE_RD) && pReader->trace_head)
+    {
+        pRec = &pReader->trace[(pReader->trace_head - 1) & (RFID_CFG_TRACE_LEN - 1)];
+        if ((pRec->type == RFID_TRACE_RD) && (pRec->arg[0] == ucAddress) && (pRec->arg[1] == ucValue) &&
+            (pRec->arg[2] < 0xFF))
         {
-            temp++;
+            pRec->arg[2]++;
+            return;
         }
+    }
+
+    TracePut(pReader, ucType, ucAddress, ucValue, 0);
+}
+
+/**
+  * @brief  记录一次FIFO读写及其数据, 每条数据记录7字节
+  * 
+  * @param  [in], ucType: RFID_TRACE_FIFO_RD 或 RFID_TRACE_FIFO_WR
+  */
+static void TraceFifo(struct rfid_reader_t *pReader, uint8_t ucType, const uint8_t *pData, uint8_t ucLen)
+{
+    struct rfid_trace_rec_t *pRec = NULL;
+    uint8_t uc, ucByte;
+
+    TracePut(pReader, ucType, ucLen, 0, 0);
+
+    for (uc = 0; uc < ucLen; uc++)
+    {
+        //认证帧: 认证模式 块地址 密钥[6] UID[4], 密钥不进入跟踪
+        ucByte = ((ucType == RFID_TRACE_FIFO_WR) && (pReader->frame.cmd == PCD_AUTHENT) && (uc >= 2) && (uc < 8))
+                     ? 0x00
+                     : pData[uc];
 
-        GPIOHS_OUT_HIGH(spi_io_cfg.hs_clk);
-        usleep(spi_io_cfg.clk_delay_us);
+        if (uc % 7 == 0)
+            pRec = TracePut(pReader, RFID_TRACE_DATA, 0, 0, 0);
+
+        if (uc % 7 < 3)
+            pRec->arg[uc % 7] = ucByte;
+        else
+            pRec->time_us |= (uint32_t)ucByte << (8 * (uc % 7 - 3));
     }
+}
+#endif
 
-    return temp;
+#if RFID_CFG_STATS || RFID_CFG_TRACE
+/**
+  * @brief  记录一帧的开始
+  * 
+  * @param  [in], ucOp: RFID_OP_*
+  * @param  [in], ucCommand: RC522命令字
+  * @param  [in], ucInLenByte: 发送字节数
+  */
+static void FrameBegin(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCommand, uint8_t ucInLenByte)
+{
+    pReader->frame.op = ucOp;
+    pReader->frame.cmd = ucCommand;
+
+#if RFID_CFG_STATS
+    pReader->frame.start_us = PcdTimeUs(pReader);
+    pReader->frame.spi_bytes = pReader->stats.spi_bytes;
+    pReader->frame.irq_polls = pReader->stats.irq_polls;
+#endif
+
+#if RFID_CFG_TRACE
+    TracePut(pReader, RFID_TRACE_FRAME, ucOp, ucCommand, ucInLenByte);
+#else
+    (void)ucInLenByte;
+#endif
 }
 
+/**
+  * @brief  一帧结果已判定, 计入该帧的操作类型
+  * 
+  * @param  [in], cStatus: 帧结果
+  * @param  [in], ucTimeout: 单调时钟超时
+  */
+static void FrameEnd(struct rfid_reader_t *pReader, uint8_t cStatus, uint8_t ucTimeout)
+{
+#if RFID_CFG_STATS
+    struct rfid_op_stats_t *pOp = &pReader->stats.op[pReader->frame.op];
+    uint32_t ulUs = PcdTimeUs(pReader) - pReader->frame.start_us;
+    uint8_t uc;
+
+    pOp->frames++;
+    if (ucTimeout)
+        pOp->timeouts++;
+    else if (cStatus == MI_OK)
+        pOp->ok++;
+    else if (cStatus == MI_NOTAGERR)
+        pOp->notag++;
+    else if (cStatus == MI_COLLERR)
+        pOp->coll++;
+    else
+        pOp->err++;
+
+    pOp->spi_bytes += pReader->stats.spi_bytes - pReader->frame.spi_bytes;
+    pOp->irq_polls += pReader->stats.irq_polls - pReader->frame.irq_polls;
+
+    if (ulUs > pOp->max_us)
+        pOp->max_us = ulUs;
+
+    for (uc = 0; (uc < RFID_STATS_HIST_LEN - 1) && (ulUs >= ((uint32_t)RFID_STATS_HIST_BASE_US << uc)); uc++)
+        ;
+    pOp->hist[uc]++;
+#endif
+
+#if RFID_CFG_TRACE
+    TracePut(pReader, RFID_TRACE_DONE, pReader->frame.op, cStatus, ucTimeout ? 0x01 : 0x00);
+#endif
+
+    pReader->frame.cmd = PCD_IDLE;
+}
+#endif
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 /**
   * @brief  读RC522寄存器
   * 
@@ -63,18 +265,30 @@ static uint8_t spi_rw(uint8_t data)
   * 
   * @return 寄存器的当前值
   */
-static uint8_t ReadRawRC(uint8_t ucAddress)
+static uint8_t ReadRawRC(struct rfid_reader_t *pReader, uint8_t ucAddress)
 {
-    uint8_t ret, ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+    uint8_t ret;
 
-    GPIOHS_OUT_LOWX(spi_io_cfg.hs_cs);
-    usleep(10);
+#if RFID_CFG_REG_SHADOW
+    if ((shadow_owned[ucAddress] == 0xFF) && SHADOW_VALID(pReader, ucAddress))
+    {
+        STATS_ADD(pReader, shadow_hits, 1);
+        return pReader->reg_shadow[ucAddress];
+    }
+#endif
 
-    spi_rw(ucAddr);
-    ret = spi_rw(0x00);
+    ret = pReader->port->read_reg(pReader->port->priv, ucAddress);
+    STATS_ADD(pReader, spi_bytes, 2);
+    STATS_ADD(pReader, reg_reads, 1);
+    TRACE_REG(pReader, RFID_TRACE_RD, ucAddress, ret);
 
-    GPIOHS_OUT_HIGH(spi_io_cfg.hs_cs);
-    usleep(10);
+#if RFID_CFG_REG_SHADOW
+    if (shadow_owned[ucAddress])
+    {
+        pReader->reg_shadow[ucAddress] = ret & shadow_owned[ucAddress];
+        pReader->shadow_valid |= (uint64_t)1 << ucAddress;
+    }
+#endif
 
     return ret;
 }
@@ -85,34 +299,169 @@ static uint8_t ReadRawRC(uint8_t ucAddress)
   * @param  [in], ucAddress: 寄存器地址
   * @param  [in], ucValue:写入寄存器的值
   */
-static void WriteRawRC(uint8_t ucAddress, uint8_t ucValue)
+static void WriteRawRC(struct rfid_reader_t *pReader, uint8_t ucAddress, uint8_t ucValue)
+{
+#if RFID_CFG_REG_SHADOW
+    if (shadow_owned[ucAddress])
+    {
+        //值未改变时跳过; Status2Reg 写0会清除芯片置位的 MFCrypto1On,
+        //StartSend 每次写1都启动发送, 均不能跳过
+        if (SHADOW_VALID(pReader, ucAddress) && (ucValue == pReader->reg_shadow[ucAddress]) &&
+            (ucAddress != Status2Reg) && !((ucAddress == BitFramingReg) && (ucValue & 0x80)))
+        {
+            STATS_ADD(pReader, shadow_hits, 1);
+            return;
+        }
+
+        pReader->reg_shadow[ucAddress] = ucValue & shadow_owned[ucAddress];
+        pReader->shadow_valid |= (uint64_t)1 << ucAddress;
+    }
+#endif
+
+    pReader->port->write_reg(pReader->port->priv, ucAddress, ucValue);
+    STATS_ADD(pReader, spi_bytes, 2);
+    STATS_ADD(pReader, reg_writes, 1);
+    TRACE_REG(pReader, RFID_TRACE_WR, ucAddress, ucValue);
+}
+
+/**
+  * @brief  使影子缓存失效, 芯片复位后调用
+  */
+static void InvalidateShadow(struct rfid_reader_t *pReader)
+{
+#if RFID_CFG_REG_SHADOW
+    pReader->shadow_valid = 0;
+#else
+    (void)pReader;
+#endif
+}
+
+/**
+  * @brief  写FIFO
+  * 
+  * @param  [in], pData: 写入的数据
+  * @param  [in], ucLen: 字节数
+  */
+static void WriteFIFO(struct rfid_reader_t *pReader, const uint8_t *pData, uint8_t ucLen)
+{
+#if RFID_CFG_FIFO_BURST
+    pReader->port->write_burst(pReader->port->priv, FIFODataReg, pData, ucLen);
+    STATS_ADD(pReader, spi_bytes, ucLen ? (ucLen + 1) : 0);
+    STATS_ADD(pReader, reg_writes, ucLen);
+#else
+    for (uint8_t uc = 0; uc < ucLen; uc++)
+        WriteRawRC(pReader, FIFODataReg, pData[uc]);
+#endif
+
+    TRACE_FIFO(pReader, RFID_TRACE_FIFO_WR, pData, ucLen);
+}
+
+/**
+  * @brief  读FIFO
+  * 
+  * @param  [out], pData: 读出的数据
+  * @param  [in], ucLen: 字节数
+  */
+static void ReadFIFO(struct rfid_reader_t *pReader, uint8_t *pData, uint8_t ucLen)
 {
-    uint8_t ucAddr = (ucAddress << 1) & 0x7E;
+#if RFID_CFG_FIFO_BURST
+    pReader->port->read_burst(pReader->port->priv, FIFODataReg, pData, ucLen);
+    STATS_ADD(pReader, spi_bytes, ucLen ? (ucLen + 1) : 0);
+    STATS_ADD(pReader, reg_reads, ucLen);
+#else
+    for (uint8_t uc = 0; uc < ucLen; uc++)
+        pData[uc] = ReadRawRC(pReader, FIFODataReg);
+#endif
+
+    TRACE_FIFO(pReader, RFID_TRACE_FIFO_RD, pData, ucLen);
+}
 
-    GPIOHS_OUT_LOWX(spi_io_cfg.hs_cs);
-    usleep(10);
+uint64_t PcdTimeUs(struct rfid_reader_t *pReader)
+{
+    return pReader->port->time_us(pReader->port->priv);
+}
 
-    spi_rw(ucAddr);
-    spi_rw(ucValue);
+/**
+  * @brief  设置定时器重载值; 默认分频下超过 0x10000 个计数(约655ms)时加大分频,
+  *         只有超过最大分频的范围(约39.6s)才截断
+  * 
+  * @param  [in], ulUs: 定时时间(us)
+  */
+static void PcdSetTimer(struct rfid_reader_t *pReader, uint32_t ulUs)
+{
+    uint64_t ullCycles = ((uint64_t)ulUs * 13560 + 999) / 1000;
+    uint64_t ullDiv = (ullCycles + 0xFFFF) / 0x10000;
+    uint16_t usPresc = PCD_TIMER_PRESCALER, reload;
+    uint64_t ticks;
+
+    //2 * usPresc + 1 >= ullDiv
+    if (ullDiv > 2 * PCD_TIMER_PRESCALER + 1)
+        usPresc = (ullDiv / 2 > PCD_TIMER_PRESCALER_MAX) ? PCD_TIMER_PRESCALER_MAX : (ullDiv / 2);
+
+    ticks = ((uint64_t)ulUs * 13560 + (2 * usPresc + 1) * 1000 - 1) / ((2 * usPresc + 1) * 1000);
+    if (ticks > 0x10000)
+        ticks = 0x10000;
+    reload = (ticks > 1) ? (ticks - 1) : 1;
+
+    //分频不变时不写, 不依赖寄存器影子
+    if (usPresc != pReader->timer_presc)
+    {
+        WriteRawRC(pReader, TModeReg, 0x80 | (usPresc >> 8));
+        WriteRawRC(pReader, TPrescalerReg, usPresc & 0xFF);
+        pReader->timer_presc = usPresc;
+    }
+    WriteRawRC(pReader, TReloadRegH, reload >> 8);
+    WriteRawRC(pReader, TReloadRegL, reload & 0xFF);
+}
 
-    GPIOHS_OUT_HIGH(spi_io_cfg.hs_cs);
-    usleep(10);
+void PcdDelayUs(struct rfid_reader_t *pReader, uint32_t us)
+{
+    pReader->port->delay_us(pReader->port->priv, us);
 }
 ///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
+/**
+  * @brief  读取置位/清位操作的基准值
+  * 
+  * @param  [in], ucReg: 寄存器地址
+  * @param  [in], ucMask: 要修改的位
+  * 
+  * @return 要修改的位全部由主机独占时返回影子值, 否则读寄存器
+  */
+static uint8_t ReadMaskRC(struct rfid_reader_t *pReader, uint8_t ucReg, uint8_t ucMask)
+{
+#if RFID_CFG_REG_SHADOW
+    uint8_t owned = shadow_owned[ucReg];
+
+    if (owned && ((ucMask & owned) == ucMask))
+    {
+        if (!SHADOW_VALID(pReader, ucReg))
+            ReadRawRC(pReader, ucReg);
+
+        //MFCrypto1On 写1无效, 保持1以免误清
+        if (ucReg == Status2Reg)
+            return pReader->reg_shadow[ucReg] | 0x08;
+
+        return pReader->reg_shadow[ucReg];
+    }
+#else
+    (void)ucMask;
+#endif
+
+    return ReadRawRC(pReader, ucReg);
+}
+
 /**
   * @brief  对RC522寄存器置位
   * 
   * @param  [in], ucReg: 寄存器地址
   * @param  [in], ucMask: 置位值
   */
-static void SetBitMask(uint8_t ucReg, uint8_t ucMask)
+static void SetBitMask(struct rfid_reader_t *pReader, uint8_t ucReg, uint8_t ucMask)
 {
     uint8_t ucTemp;
 
-    ucTemp = ReadRawRC(ucReg);
-    WriteRawRC(ucReg, ucTemp | ucMask);
+    ucTemp = ReadMaskRC(pReader, ucReg, ucMask);
+    WriteRawRC(pReader, ucReg, ucTemp | ucMask);
 }
 
 /**
@@ -121,72 +470,169 @@ static void SetBitMask(uint8_t ucReg, uint8_t ucMask)
   * @param  [in], ucReg: 寄存器地址
   * @param  [in], ucMask: 清位值
   */
-static void ClearBitMask(uint8_t ucReg, uint8_t ucMask)
+static void ClearBitMask(struct rfid_reader_t *pReader, uint8_t ucReg, uint8_t ucMask)
 {
     uint8_t ucTemp;
 
-    ucTemp = ReadRawRC(ucReg);
-    WriteRawRC(ucReg, ucTemp & (~ucMask));
+    ucTemp = ReadMaskRC(pReader, ucReg, ucMask);
+    WriteRawRC(pReader, ucReg, ucTemp & (~ucMask));
 }
 
+#if !RFID_CFG_SW_CRC
 /**
-  * @brief  用RC522计算CRC16
+  * @brief  用RC522 CRC协处理器计算CRC16
   * 
   * @param  [in], pIndata: 计算CRC16的数组
   * @param  [in], ucLen: 计算CRC16的数组字节长度
   * @param  [out], pOutData: 存放计算结果存放的首地址
   */
-static void CalulateCRC(uint8_t *pIndata, uint8_t ucLen, uint8_t *pOutData)
+static void CalulateCRC(struct rfid_reader_t *pReader, const uint8_t *pIndata, uint8_t ucLen, uint8_t *pOutData)
 {
     uint8_t uc, ucN;
 
-    ClearBitMask(DivIrqReg, 0x04);
+    WriteRawRC(pReader, DivIrqReg, 0x04); //Set1=0, 清除CRCIRq
 
-    WriteRawRC(CommandReg, PCD_IDLE);
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
 
-    SetBitMask(FIFOLevelReg, 0x80);
+    WriteRawRC(pReader, FIFOLevelReg, 0x80);
 
-    for (uc = 0; uc < ucLen; uc++)
-        WriteRawRC(FIFODataReg, *(pIndata + uc));
+    WriteFIFO(pReader, pIndata, ucLen);
 
-    WriteRawRC(CommandReg, PCD_CALCCRC);
+    WriteRawRC(pReader, CommandReg, PCD_CALCCRC);
 
     uc = 0xFF;
 
     do
     {
-        ucN = ReadRawRC(DivIrqReg);
+        ucN = ReadRawRC(pReader, DivIrqReg);
         uc--;
     } while ((uc != 0) && !(ucN & 0x04));
 
-    pOutData[0] = ReadRawRC(CRCResultRegL);
-    pOutData[1] = ReadRawRC(CRCResultRegM);
+    pOutData[0] = ReadRawRC(pReader, CRCResultRegL);
+    pOutData[1] = ReadRawRC(pReader, CRCResultRegM);
+}
+#else
+
+/* CRC_A: 多项式 x^16 + x^12 + x^5 + 1, 低位在前(反射多项式 0x8408) */
+static const uint16_t crc_a_table[256] = {
+    0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+    0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+    0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+    0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+    0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+    0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+    0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+    0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+    0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+    0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+    0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+    0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+    0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+    0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+    0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+    0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+    0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+    0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+    0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+    0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+    0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+    0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+    0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+    0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+    0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+    0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+    0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+    0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+    0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+    0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+    0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+    0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78,
+};
+#endif
+
+uint8_t PcdCalcCrcA(struct rfid_reader_t *pReader, const uint8_t *pIndata, uint8_t ucLen, uint8_t *pOutData)
+{
+#if RFID_CFG_SW_CRC
+    uint16_t crc = 0x6363; //ModeReg CRCPreset = 01
+
+    (void)pReader;
+    for (uint8_t uc = 0; uc < ucLen; uc++)
+        crc = (crc >> 8) ^ crc_a_table[(crc ^ pIndata[uc]) & 0xFF];
+
+    pOutData[0] = crc & 0xFF;
+    pOutData[1] = crc >> 8;
+#else
+    //协处理器的输入经过FIFO
+    if (ucLen > DEF_FIFO_LENGTH)
+        return MI_ERR;
+
+    CalulateCRC(pReader, pIndata, ucLen, pOutData);
+#endif
+
+    return MI_OK;
 }
 
 /**
-  * @brief  通过RC522和ISO14443卡通讯
+  * @brief  等待当前命令完成
+  * 
+  * @param  [in], ucWaitFor: 完成标志位, 另外TimerIRq也视为完成
+  * @param  [in], ullDeadline: 单调时钟超时时间
+  * @param  [out], pIrq: ComIrqReg
+  * 
+  * @return 1 完成, 0 超时
+  */
+static uint8_t PcdWaitDone(struct rfid_reader_t *pReader, uint8_t ucWaitFor, uint64_t ullDeadline, uint8_t *pIrq)
+{
+    uint64_t ullNow;
+    uint8_t ucDone;
+
+    if (pReader->port->wait_irq)
+    {
+        //等待期间不访问SPI
+        ullNow = PcdTimeUs(pReader);
+        ucDone = (ullNow < ullDeadline) ? pReader->port->wait_irq(pReader->port->priv, ullDeadline - ullNow) : 0;
+        *pIrq = ReadRawRC(pReader, ComIrqReg);
+        STATS_ADD(pReader, irq_sleeps, 1);
+    }
+    else
+    {
+        do
+        {                                //认证 与寻卡等待时间
+            *pIrq = ReadRawRC(pReader, ComIrqReg); //查询事件中断
+            STATS_ADD(pReader, irq_polls, 1);
+            ucDone = (*pIrq & 0x01) || (*pIrq & ucWaitFor);
+        } while (!ucDone && (PcdTimeUs(pReader) < ullDeadline));
+    }
+
+    return ucDone;
+}
+
+/**
+  * @brief  启动一帧与卡片的通讯: 设置中断与定时器, 写FIFO并发出命令, 不等待
   * 
+  * @param  [in], ucOp: RFID_OP_*, 决定帧等待时间
   * @param  [in], ucCommand: RC522命令字
-  * @param  [in], pInData: 通过RC522发送到卡片的数据
+  * @param  [in], pInData: 通过RC522发送到卡片的数据, 返回后即可改写
   * @param  [in], ucInLenByte: 发送数据的字节长度
-  * @param  [out], pOutData: 接收到的卡片返回数据
-  * @param  [out], pOutLenBit: 返回数据的位长度
-  * 
-  * @return status
   */
-static uint8_t PcdComMF522(uint8_t ucCommand, uint8_t *pInData, uint8_t ucInLenByte,
-                           uint8_t *pOutData, uint32_t *pOutLenBit)
+static void PcdComBegin(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCommand, const uint8_t *pInData,
+                        uint8_t ucInLenByte)
 {
-    uint8_t ucN, cStatus = MI_ERR;
     uint8_t ucIrqEn = 0x00;
     uint8_t ucWaitFor = 0x00;
-    uint8_t ucLastBits;
-    uint32_t ul;
+
+    FRAME_BEGIN(pReader, ucOp, ucCommand, ucInLenByte);
+
+    if ((ucOp <= RFID_OP_AUTH) || (ucOp == RFID_OP_HALT))
+    {
+        //寻卡/防冲撞/选卡/认证/休眠均结束当前会话
+        pReader->session.valid = 0;
+    }
 
     switch (ucCommand)
     {
     case PCD_AUTHENT:     //Mifare认证
-        ucIrqEn = 0x12;   //允许错误中断请求ErrIEn  允许空闲中断IdleIEn
+        ucIrqEn = 0x13;   //允许错误中断请求ErrIEn  允许空闲中断IdleIEn 定时器超时TimerIEn
         ucWaitFor = 0x10; //认证寻卡等待时候 查询空闲中断标志位
         break;
     case PCD_TRANSCEIVE:  //接收发送 发送接收
@@ -197,57 +643,129 @@ static uint8_t PcdComMF522(uint8_t ucCommand, uint8_t *pInData, uint8_t ucInLenB
         break;
     }
 
+    if (pReader->port->wait_irq)
+    {
+        //IRQ引脚只反映完成事件: 等待的标志位与TimerIEn, 无应答时由定时器中断唤醒
+        ucIrqEn = ucWaitFor | 0x01;
+    }
+
     //IRqInv置位管脚IRQ与Status1Reg的IRq位的值相反
-    WriteRawRC(ComIEnReg, ucIrqEn | 0x80);
-    //Set1该位清零时，CommIRqReg的屏蔽位清零
-    ClearBitMask(ComIrqReg, 0x80);
+    WriteRawRC(pReader, ComIEnReg, ucIrqEn | 0x80);
+    //Set1该位清零时，CommIRqReg的屏蔽位清零, 清除全部中断标志
+    WriteRawRC(pReader, ComIrqReg, 0x7F);
     //写空闲命令
-    WriteRawRC(CommandReg, PCD_IDLE);
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
+
+    //定时器在发送结束后自动启动, 超时产生TimerIRq
+    PcdSetTimer(pReader, pReader->timeout_us[ucOp]);
 
     //置位FlushBuffer清除内部FIFO的读和写指针以及ErrReg的BufferOvfl标志位被清除
-    SetBitMask(FIFOLevelReg, 0x80);
+    WriteRawRC(pReader, FIFOLevelReg, 0x80);
+
+    WriteFIFO(pReader, pInData, ucInLenByte); //写数据进FIFOdata
 
-    for (ul = 0; ul < ucInLenByte; ul++)
-        WriteRawRC(FIFODataReg, pInData[ul]); //写数据进FIFOdata
+    WriteRawRC(pReader, CommandReg, ucCommand); //写命令
 
-    WriteRawRC(CommandReg, ucCommand); //写命令
+    //单调时钟超时保护: 帧等待时间(认证为多步交互, 按3步计) + 收发空中时间 + 余量
+    pReader->com.deadline_us = PcdTimeUs(pReader) + RFID_CFG_DEADLINE_SLACK_US +
+                               pReader->timeout_us[ucOp] * ((ucCommand == PCD_AUTHENT) ? 3 : 1) +
+                               (ucInLenByte + DEF_FIFO_LENGTH) * PCD_BYTE_AIR_US;
 
     if (ucCommand == PCD_TRANSCEIVE)
     {
         //StartSend置位启动数据发送 该位与收发命令使用时才有效
-        SetBitMask(BitFramingReg, 0x80);
+        SetBitMask(pReader, BitFramingReg, 0x80);
     }
 
-    ul = 1000 * 3; //根据时钟频率调整，操作M1卡最大等待时间25ms
+    pReader->com.busy = 1;
+    pReader->com.done = 0;
+    pReader->com.command = ucCommand;
+    pReader->com.irq_en = ucIrqEn;
+    pReader->com.wait_for = ucWaitFor;
+}
 
-    do
-    {                               //认证 与寻卡等待时间
-        ucN = ReadRawRC(ComIrqReg); //查询事件中断
-        ul--;
-    } while ((ul != 0) && (!(ucN & 0x01)) && (!(ucN & ucWaitFor)));
+/**
+  * @brief  查询当前帧是否结束, 不等待; IRQ引脚接线且未有效时不访问SPI
+  * 
+  * @return 1 已完成或超时, 0 进行中
+  */
+static uint8_t PcdComCheck(struct rfid_reader_t *pReader)
+{
+    uint64_t ullNow;
+    uint8_t ucIrq;
+
+    if (pReader->com.done)
+        return 1;
+
+    ullNow = PcdTimeUs(pReader);
+
+    //IRqInv=1, 高电平为无效
+    if (pReader->port->irq_level && pReader->port->irq_level(pReader->port->priv) &&
+        (ullNow < pReader->com.deadline_us))
+        return 0;
+
+    ucIrq = ReadRawRC(pReader, ComIrqReg);
+    STATS_ADD(pReader, irq_polls, 1);
+    pReader->com.irq = ucIrq;
+    pReader->com.ok = (ucIrq & 0x01) || (ucIrq & pReader->com.wait_for);
+    pReader->com.done = pReader->com.ok || (ullNow >= pReader->com.deadline_us);
+
+    return pReader->com.done;
+}
+
+/**
+  * @brief  等待当前帧结束
+  */
+static void PcdComWait(struct rfid_reader_t *pReader)
+{
+    if (!pReader->com.done)
+    {
+        pReader->com.ok = PcdWaitDone(pReader, pReader->com.wait_for, pReader->com.deadline_us, &pReader->com.irq);
+        pReader->com.done = 1;
+    }
+}
+
+/**
+  * @brief  结束当前帧: 检查错误标志, 读出卡片应答, 停止定时器
+  * 
+  * @param  [out], pOutData: 接收到的卡片返回数据
+  * @param  [in], ucOutMax: pOutData 容量, 多出的字节不读出
+  * @param  [out], pOutLenBit: 返回数据的位长度
+  * 
+  * @return status
+  */
+static uint8_t PcdComEnd(struct rfid_reader_t *pReader, uint8_t *pOutData, uint8_t ucOutMax, uint32_t *pOutLenBit)
+{
+    uint8_t ucN = pReader->com.irq, cStatus = MI_ERR;
+    uint8_t ucLastBits, ucErr;
 
-    ClearBitMask(BitFramingReg, 0x80); //清理允许StartSend位
+    *pOutLenBit = 0;
 
-    if (ul != 0)
+    ClearBitMask(pReader, BitFramingReg, 0x80); //清理允许StartSend位
+
+    if (pReader->com.ok)
     {
         //读错误标志寄存器BufferOfI CollErr ParityErr ProtocolErr
-        if (!(ReadRawRC(ErrorReg) & 0x1B))
+        ucErr = ReadRawRC(pReader, ErrorReg) & 0x1B;
+
+        //仅有位冲突时仍读出数据, 由防冲撞按CollReg处理
+        if (!ucErr || ((ucErr == 0x08) && (pReader->com.command == PCD_TRANSCEIVE)))
         {
-            cStatus = MI_OK;
+            cStatus = ucErr ? MI_COLLERR : MI_OK;
 
-            if (ucN & ucIrqEn & 0x01)
+            if (ucN & pReader->com.irq_en & 0x01)
             {
                 //是否发生定时器中断
                 cStatus = MI_NOTAGERR;
             }
 
-            if (ucCommand == PCD_TRANSCEIVE)
+            if (pReader->com.command == PCD_TRANSCEIVE)
             {
                 //读FIFO中保存的字节数
-                ucN = ReadRawRC(FIFOLevelReg);
+                ucN = ReadRawRC(pReader, FIFOLevelReg);
 
                 //最后接收到得字节的有效位数
-                ucLastBits = ReadRawRC(ControlReg) & 0x07;
+                ucLastBits = ReadRawRC(pReader, ControlReg) & 0x07;
                 // printf("ucN: %d, ucLastBits: %d\r\n", ucN, ucLastBits);
                 if (ucLastBits)
                 {
@@ -260,12 +778,9 @@ static uint8_t PcdComMF522(uint8_t ucCommand, uint8_t *pInData, uint8_t ucInLenB
                 }
 
                 ucN = (ucN == 0) ? 1 : ucN;
-                ucN = (ucN > MAXRLEN) ? MAXRLEN : ucN;
+                ucN = (ucN > ucOutMax) ? ucOutMax : ucN;
 
-                for (ul = 0; ul < ucN; ul++)
-                {
-                    pOutData[ul] = ReadRawRC(FIFODataReg);
-                }
+                ReadFIFO(pReader, pOutData, ucN);
             }
         }
         else
@@ -274,315 +789,1438 @@ static uint8_t PcdComMF522(uint8_t ucCommand, uint8_t *pInData, uint8_t ucInLenB
         }
     }
 
-    SetBitMask(ControlReg, 0x80); // stop timer now
-    WriteRawRC(CommandReg, PCD_IDLE);
+    WriteRawRC(pReader, ControlReg, 0x80); // stop timer now, 其余位只读
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
+
+    pReader->com.busy = 0;
 
     return cStatus;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
-void PcdAntennaOn(void)
+/**
+  * @brief  通过RC522和ISO14443卡通讯
+  * 
+  * @param  [in], ucOp: RFID_OP_*, 决定帧等待时间
+  * @param  [in], ucCommand: RC522命令字
+  * @param  [in], pInData: 通过RC522发送到卡片的数据
+  * @param  [in], ucInLenByte: 发送数据的字节长度
+  * @param  [out], pOutData: 接收到的卡片返回数据
+  * @param  [out], pOutLenBit: 返回数据的位长度
+  * 
+  * @return status
+  */
+static uint8_t PcdComMF522(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCommand, uint8_t *pInData,
+                           uint8_t ucInLenByte, uint8_t *pOutData, uint32_t *pOutLenBit)
 {
-    uint8_t uc;
+    uint8_t cStatus;
 
-    uc = ReadRawRC(TxControlReg);
-    if (!(uc & 0x03))
-    {
-        SetBitMask(TxControlReg, 0x03);
-    }
+    PcdComBegin(pReader, ucOp, ucCommand, pInData, ucInLenByte);
+    PcdComWait(pReader);
+
+    cStatus = PcdComEnd(pReader, pOutData, MAXRLEN, pOutLenBit);
+    FRAME_END(pReader, cStatus, !pReader->com.ok);
+
+    return cStatus;
 }
 
-void PcdAntennaOff(void)
+/**
+  * @brief  流式收发的等待: 发送数据未写完时每次 LoAlertIRq 补满FIFO, 发送结束(TxIRq)后每次 HiAlertIRq 取出已收到的应答
+  *         发送期间FIFO中待发送的数据同样会置位 HiAlertIRq, 不能当作应答读出
+  * 
+  * @param  [in], pInData: 全部发送数据, 前 usTx 字节已写入FIFO
+  * @param  [out], pOutData: 接收数据
+  * @param  [out], pRx: 中途取出的接收字节数, 其余留在FIFO中由 PcdComEnd 读出
+  * 
+  * @return 1 正常, 0 FIFO未能及时补充(发送被截断)或应答超过 usOutMax, 帧已放弃
+  */
+static uint8_t PcdComStream(struct rfid_reader_t *pReader, const uint8_t *pInData, uint16_t usTx, uint16_t usInLen,
+                            uint8_t *pOutData, uint16_t usOutMax, uint16_t *pRx)
 {
-    ClearBitMask(TxControlReg, 0x03);
+    uint8_t ucN, ucIrq, ucAlert = (usTx < usInLen) ? 0x04 : 0x40;
+
+    //写满FIFO时置位的 HiAlertIRq 与冲洗FIFO时置位的 LoAlertIRq 作废
+    WriteRawRC(pReader, ComIrqReg, 0x0C);
+
+    while (!pReader->com.done)
+    {
+        if (pReader->port->wait_irq)
+            WriteRawRC(pReader, ComIEnReg, 0x80 | pReader->com.irq_en | ucAlert);
+
+        pReader->com.ok = PcdWaitDone(pReader, pReader->com.wait_for | ucAlert, pReader->com.deadline_us, &ucIrq);
+        pReader->com.irq = ucIrq;
+        if (!pReader->com.ok || (ucIrq & 0x01) || (ucIrq & pReader->com.wait_for))
+        {
+            pReader->com.done = 1;
+        }
+        else if (ucAlert == 0x04)
+        {
+            //TxIRq: 发送在补充之前已经结束
+            if (ucIrq & 0x40)
+                return 0;
+
+            ucN = DEF_FIFO_LENGTH - ReadRawRC(pReader, FIFOLevelReg);
+            ucN = (ucN > usInLen - usTx) ? (usInLen - usTx) : ucN;
+            WriteFIFO(pReader, &pInData[usTx], ucN);
+            usTx += ucN;
+
+            if (usTx < usInLen)
+            {
+                WriteRawRC(pReader, ComIrqReg, 0x04);
+            }
+            else
+            {
+                WriteRawRC(pReader, ComIrqReg, 0x04);
+                ucAlert = 0x40;
+            }
+        }
+        else if (ucAlert == 0x40)
+        {
+            //发送期间置位的 HiAlertIRq 作废
+            WriteRawRC(pReader, ComIrqReg, 0x08);
+            ucAlert = 0x08;
+        }
+        else
+        {
+            ucN = ReadRawRC(pReader, FIFOLevelReg);
+            WriteRawRC(pReader, ComIrqReg, 0x08);
+            if (ucN > usOutMax - *pRx)
+                return 0;
+
+            ReadFIFO(pReader, &pOutData[*pRx], ucN);
+            *pRx += ucN;
+        }
+    }
+
+    return 1;
 }
 
-uint8_t PcdHalt(void)
+uint8_t PcdTransceive(struct rfid_reader_t *pReader, uint8_t ucOp, const uint8_t *pInData, uint16_t usInLen,
+                      uint8_t *pOutData, uint16_t usOutMax, uint16_t *pOutLen)
 {
+    uint16_t usTx = (usInLen > DEF_FIFO_LENGTH) ? DEF_FIFO_LENGTH : usInLen, usRx = 0, usMax;
     uint32_t ulLen;
-    uint8_t ucComMF522Buf[4] = {PICC_HALT, 0, 0, 0};
+    uint8_t cStatus, ucStream = (usTx < usInLen) || (usOutMax > DEF_FIFO_LENGTH);
 
-    CalulateCRC(ucComMF522Buf, 2, &ucComMF522Buf[2]);
+    *pOutLen = 0;
 
-    return PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 4, ucComMF522Buf, &ulLen);
-}
+    if (pReader->com.busy || pReader->op.busy || (ucOp >= RFID_OP_MAX))
+        return MI_ERR;
 
-void PcdReset(void)
-{
-    uint8_t val = 0, t;
+    //寻卡留下的 TxLastBits
+    WriteRawRC(pReader, BitFramingReg, 0x00);
+    if (ucStream)
+        WriteRawRC(pReader, WaterLevelReg, RFID_CFG_FIFO_WATERLEVEL);
 
-    if (0xFF != spi_io_cfg.hs_rst)
+    PcdComBegin(pReader, ucOp, PCD_TRANSCEIVE, pInData, usTx);
+
+    if (ucStream)
     {
-        gpiohs_set_pin(spi_io_cfg.hs_rst, 0);
-        msleep(10);
-        gpiohs_set_pin(spi_io_cfg.hs_rst, 1);
-    }
+        //FIFO之外的发送与接收空中时间
+        usMax = (usOutMax > DEF_FIFO_LENGTH) ? (usOutMax - DEF_FIFO_LENGTH) : 0;
+        pReader->com.deadline_us += (uint32_t)(usInLen - usTx + usMax) * PCD_BYTE_AIR_US;
 
-    for (uint8_t i = 0; i < 0x30; i++)
+        if (!PcdComStream(pReader, pInData, usTx, usInLen, pOutData, usOutMax, &usRx))
+        {
+            pReader->com.ok = 0;
+            PcdComEnd(pReader, pOutData, 0, &ulLen);
+            FRAME_END(pReader, MI_ERR, 0);
+            return MI_ERR;
+        }
+    }
+    else
     {
-        val = ReadRawRC(i);
-        printk("val: [0x%02X -> 0x%02X]\r\n", i, val);
+        PcdComWait(pReader);
     }
 
-    WriteRawRC(CommandReg, 0x0f);
+    usMax = usOutMax - usRx;
+    usMax = (usMax > DEF_FIFO_LENGTH) ? DEF_FIFO_LENGTH : usMax;
+    cStatus = PcdComEnd(pReader, &pOutData[usRx], usMax, &ulLen);
+    //4位的 ACK/NAK 留在 pOutData[0], 长度记为0
+    if ((cStatus == MI_OK) && (ulLen == 4) && (usRx == 0))
+        ulLen = 0;
+    else if ((cStatus == MI_OK) && ((ulLen & 0x07) || (ulLen > (uint32_t)usMax * 8)))
+        cStatus = MI_ERR;
+    FRAME_END(pReader, cStatus, !pReader->com.ok);
 
-    val = 0xFF;
-    do
-    {
-        val--;
-        t = ReadRawRC(CommandReg);
-        msleep(1);
-    } while ((val) && (t & 0x10));
+    if (cStatus == MI_OK)
+        *pOutLen = usRx + ulLen / 8;
+
+    return cStatus;
+}
 
-    msleep(1);
+uint8_t PcdTransceiveCrc(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t *pTx, uint16_t usTxLen, uint8_t *pRx,
+                         uint16_t usRxMax, uint16_t *pRxLen)
+{
+    uint8_t cStatus, ucCrc[2];
 
-    //定义发送和接收常用模式 和Mifare卡通讯，CRC初始值0x6363
-    WriteRawRC(ModeReg, 0x3D);
+    if (PcdCalcCrcA(pReader, pTx, usTxLen, &pTx[usTxLen]) != MI_OK)
+        return MI_ERR;
 
-    WriteRawRC(TReloadRegL, 30); //16位定时器低位
-    WriteRawRC(TReloadRegH, 0);  //16位定时器高位
+    cStatus = PcdTransceive(pReader, ucOp, pTx, usTxLen + 2, pRx, usRxMax, pRxLen);
+    if (cStatus != MI_OK)
+        return cStatus;
 
-    WriteRawRC(TModeReg, 0x8D); //定义内部定时器的设置
+    //4位应答(NAK)长度为0
+    if (*pRxLen < 3)
+        return MI_ERR;
 
-    WriteRawRC(TPrescalerReg, 0x3E); //设置定时器分频系数
+    *pRxLen -= 2;
+    if (PcdCalcCrcA(pReader, pRx, *pRxLen, ucCrc) != MI_OK)
+        return MI_ERR;
 
-    WriteRawRC(TxAutoReg, 0x40); //调制发送信号为100%ASK
+    return ((ucCrc[0] == pRx[*pRxLen]) && (ucCrc[1] == pRx[*pRxLen + 1])) ? MI_OK : MI_ERR;
 }
 
-void M500PcdConfigISOType(uint8_t ucType)
+uint8_t PcdComStart(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCommand, const uint8_t *pInData,
+                    uint8_t ucInLenByte)
 {
-    if (ucType == 'A') //ISO14443_A
-    {
-        ClearBitMask(Status2Reg, 0x08);
+    if (pReader->com.busy || pReader->op.busy || (ucOp >= RFID_OP_MAX) || (ucInLenByte > DEF_FIFO_LENGTH) ||
+        ((ucCommand != PCD_TRANSCEIVE) && (ucCommand != PCD_AUTHENT)))
+        return MI_ERR;
 
-        WriteRawRC(ModeReg, 0x3D); //3F
+    PcdComBegin(pReader, ucOp, ucCommand, pInData, ucInLenByte);
 
-        WriteRawRC(RxSelReg, 0x86); //84
+    return MI_OK;
+}
 
-        WriteRawRC(RFCfgReg, 0x7F); //4F
+uint8_t PcdComPoll(struct rfid_reader_t *pReader)
+{
+    if (!pReader->com.busy || pReader->op.busy)
+        return MI_ERR;
 
-        WriteRawRC(TReloadRegL, 30);
+    return PcdComCheck(pReader) ? MI_OK : MI_BUSY;
+}
 
-        WriteRawRC(TReloadRegH, 0);
+uint8_t PcdComComplete(struct rfid_reader_t *pReader, uint8_t *pOutData, uint32_t *pOutLenBit)
+{
+    uint8_t cStatus;
 
-        WriteRawRC(TModeReg, 0x8D);
+    if (!pReader->com.busy || pReader->op.busy)
+        return MI_ERR;
 
-        WriteRawRC(TPrescalerReg, 0x3E);
+    if (!PcdComCheck(pReader))
+        return MI_BUSY;
 
-        msleep(2);
+    cStatus = PcdComEnd(pReader, pOutData, MAXRLEN, pOutLenBit);
+    FRAME_END(pReader, cStatus, !pReader->com.ok);
 
-        PcdAntennaOn(); //开天线
-    }
-    else
-    {
-        printk("unk ISO type\r\n");
-    }
+    return cStatus;
+}
+
+/**
+  * @brief  块地址所属扇区, S70前32个扇区每扇区4块, 其后每扇区16块
+  */
+static uint8_t BlockSector(uint8_t ucAddr)
+{
+    return (ucAddr < 128) ? (ucAddr / 4) : (32 + (ucAddr - 128) / 16);
+}
+
+/**
+  * @brief  启动高层操作的一帧, 发送 op.tx
+  */
+static void PcdOpBegin(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucInLenByte, uint8_t *pOut)
+{
+    pReader->op.op = ucOp;
+    pReader->op.out = pOut;
+    pReader->op.busy = 1;
+
+    PcdComBegin(pReader, ucOp, (ucOp == RFID_OP_AUTH) ? PCD_AUTHENT : PCD_TRANSCEIVE, pReader->op.tx, ucInLenByte);
+}
+
+/**
+  * @brief  处理高层操作已结束的一帧: 检查卡片应答并输出结果, 写块命令阶段成功后启动数据阶段
+  * 
+  * @return MI_BUSY 已启动下一帧, 其余为操作结果
+  */
+static uint8_t PcdOpStep(struct rfid_reader_t *pReader)
+{
+    uint32_t ulLen;
+    uint8_t uc, cStatus, ucCrc[2];
+    uint8_t *pBuf = pReader->op.rx;
+
+    cStatus = PcdComEnd(pReader, pBuf, MAXRLEN, &ulLen);
+
+    switch (pReader->op.op)
+    {
+    case RFID_OP_REQUEST:
+        //多张卡的ATQA不同会产生冲突, 说明场内有卡, 交给防冲撞处理
+        if (((cStatus == MI_OK) || (cStatus == MI_COLLERR)) && (ulLen == 0x10))
+        {
+            pReader->op.out[0] = pBuf[0];
+            pReader->op.out[1] = pBuf[1];
+            cStatus = MI_OK;
+        }
+        else if (cStatus != MI_NOTAGERR)
+        {
+            cStatus = MI_ERR;
+        }
+        break;
+
+    case RFID_OP_SELECT:
+        if ((cStatus != MI_OK) || (ulLen != 0x18))
+        {
+            cStatus = MI_ERR;
+            break;
+        }
+
+        //SAK后跟CRC_A
+        PcdCalcCrcA(pReader, pBuf, 1, ucCrc);
+        if ((ucCrc[0] != pBuf[1]) || (ucCrc[1] != pBuf[2]))
+        {
+            cStatus = MI_ERR;
+            break;
+        }
+
+        *pReader->op.out = pBuf[0];
+        break;
+
+    case RFID_OP_AUTH:
+        if ((cStatus != MI_OK) || (!(ReadRawRC(pReader, Status2Reg) & 0x08)))
+        {
+            cStatus = MI_ERR;
+            break;
+        }
+
+        //op.tx: 认证模式 块地址 密钥[6] UID[4]
+        pReader->session.valid = 1;
+        pReader->session.mode = pReader->op.tx[0];
+        pReader->session.sector = BlockSector(pReader->op.tx[1]);
+        for (uc = 0; uc < 4; uc++)
+        {
+            pReader->session.snr[uc] = pReader->op.tx[uc + 8];
+        }
+        for (uc = 0; uc < 6; uc++)
+        {
+            pReader->session.key[uc] = pReader->op.tx[uc + 2];
+        }
+        break;
+
+    case RFID_OP_READ:
+        if ((cStatus == MI_OK) && (ulLen == 0x90))
+        {
+            //16字节数据后跟CRC_A, 校验错只是接收出错, 卡片仍保持认证状态
+            PcdCalcCrcA(pReader, pBuf, 16, ucCrc);
+            if ((ucCrc[0] != pBuf[16]) || (ucCrc[1] != pBuf[17]))
+            {
+                cStatus = MI_ERR;
+                break;
+            }
+
+            for (uc = 0; uc < 16; uc++)
+            {
+                pReader->op.out[uc] = pBuf[uc];
+            }
+        }
+        else
+        {
+            cStatus = MI_ERR;
+            pReader->session.valid = 0; //NAK或无应答后卡片回到IDLE
+        }
+        break;
+
+    case RFID_OP_WRITE:
+    case RFID_OP_WRITE_DATA:
+        if ((cStatus != MI_OK) || (ulLen != 4) || ((pBuf[0] & 0x0F) != 0x0A))
+        {
+            cStatus = MI_ERR;
+            pReader->session.valid = 0; //NAK或无应答后卡片回到IDLE
+        }
+        else if (pReader->op.op == RFID_OP_WRITE)
+        {
+            FRAME_END(pReader, MI_OK, 0);
+
+            //op.tx 已在命令阶段发出后换为待写数据; 芯片空闲后才能用CRC协处理器
+            PcdCalcCrcA(pReader, pReader->op.tx, 16, &pReader->op.tx[16]);
+            PcdOpBegin(pReader, RFID_OP_WRITE_DATA, 18, NULL);
+            return MI_BUSY;
+        }
+        break;
+
+    default:
+        cStatus = MI_ERR;
+        break;
+    }
+
+    FRAME_END(pReader, cStatus, !pReader->com.ok);
+    pReader->op.busy = 0;
+
+    return cStatus;
+}
+
+/**
+  * @brief  高层操作能否启动: 同一读卡器同时只能有一帧在进行
+  */
+static uint8_t PcdOpIdle(struct rfid_reader_t *pReader)
+{
+    return !pReader->op.busy && !pReader->com.busy;
+}
+
+uint8_t PcdOpPoll(struct rfid_reader_t *pReader)
+{
+    if (!pReader->op.busy)
+        return MI_ERR;
+
+    if (!PcdComCheck(pReader))
+        return MI_BUSY;
+
+    return PcdOpStep(pReader);
+}
+
+uint8_t PcdOpWait(struct rfid_reader_t *pReader)
+{
+    uint8_t cStatus;
+
+    if (!pReader->op.busy)
+        return MI_ERR;
+
+    do
+    {
+        PcdComWait(pReader);
+        cStatus = PcdOpStep(pReader);
+    } while (cStatus == MI_BUSY);
+
+    return cStatus;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void PcdAntennaOn(struct rfid_reader_t *pReader)
+{
+    uint8_t uc;
+
+    uc = ReadRawRC(pReader, TxControlReg);
+    if (!(uc & 0x03))
+    {
+        SetBitMask(pReader, TxControlReg, 0x03);
+    }
+}
+
+void PcdAntennaOff(struct rfid_reader_t *pReader)
+{
+    ClearBitMask(pReader, TxControlReg, 0x03);
+    //关闭天线场, 卡片掉电
+    pReader->session.valid = 0;
+}
+
+uint8_t PcdHalt(struct rfid_reader_t *pReader)
+{
+    uint32_t ulLen;
+    uint8_t ucComMF522Buf[4] = {PICC_HALT, 0, 0, 0};
+
+    PcdCalcCrcA(pReader, ucComMF522Buf, 2, &ucComMF522Buf[2]);
+
+    return PcdComMF522(pReader, RFID_OP_HALT, PCD_TRANSCEIVE, ucComMF522Buf, 4, ucComMF522Buf, &ulLen);
+}
+
+/**
+  * @brief  轮询 PowerDown 位直到振荡器起振, 不固定延时
+  * 
+  * @return status, 超时返回MI_ERR(芯片无响应)
+  */
+static uint8_t PcdWaitReady(struct rfid_reader_t *pReader)
+{
+    uint64_t ullStart = PcdTimeUs(pReader);
+
+    while (ReadRawRC(pReader, CommandReg) & 0x10)
+    {
+        if (PcdTimeUs(pReader) - ullStart > PCD_RESET_TIMEOUT_US)
+            return MI_ERR;
+    }
+
+    return MI_OK;
+}
+
+/**
+  * @brief  软复位并等待芯片就绪
+  * 
+  * @return status, 超时返回MI_ERR(芯片无响应)
+  */
+static uint8_t PcdSoftReset(struct rfid_reader_t *pReader)
+{
+    WriteRawRC(pReader, CommandReg, PCD_RESETPHASE);
+    InvalidateShadow(pReader);
+    pReader->com.busy = 0;
+    pReader->op.busy = 0;
+    pReader->bit_rate = 0;
+    pReader->timer_presc = PCD_TIMER_PRESCALER; //随后由 pcd_reset_regs 写入
+
+    return PcdWaitReady(pReader);
+}
+
+/**
+  * @brief  按表写入寄存器; RFID_CFG_INIT_VERIFY 时读回芯片中的值逐个核对
+  * 
+  * @param  [in], pTable: {寄存器, 值} 表
+  * @param  [in], ucCount: 表项数
+  * 
+  * @return status, 读回不符返回MI_ERR
+  */
+static uint8_t PcdWriteRegTable(struct rfid_reader_t *pReader, const uint8_t (*pTable)[2], uint8_t ucCount)
+{
+    uint8_t uc;
+
+    for (uc = 0; uc < ucCount; uc++)
+        WriteRawRC(pReader, pTable[uc][0], pTable[uc][1]);
+
+#if RFID_CFG_INIT_VERIFY
+    //读芯片而不是影子值
+    InvalidateShadow(pReader);
+    for (uc = 0; uc < ucCount; uc++)
+    {
+        if (ReadRawRC(pReader, pTable[uc][0]) != pTable[uc][1])
+            return MI_ERR;
+    }
+#endif
+
+    return MI_OK;
+}
+
+void PcdPowerDown(struct rfid_reader_t *pReader)
+{
+    PcdAntennaOff(pReader);
+    //寄存器与FIFO保持, 影子缓存仍然有效
+    WriteRawRC(pReader, CommandReg, PCD_IDLE | 0x10);
+}
+
+uint8_t PcdPowerUp(struct rfid_reader_t *pReader)
+{
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
+
+    return PcdWaitReady(pReader);
+}
+
+uint8_t PcdReset(struct rfid_reader_t *pReader)
+{
+    uint8_t cStatus;
+
+    if (pReader->port->hard_reset)
+    {
+        pReader->port->hard_reset(pReader->port->priv);
+        InvalidateShadow(pReader);
+    }
+
+#if RFID_CFG_RESET_DUMP
+    for (uint8_t i = 0; i < 0x30; i++)
+    {
+        printk("val: [0x%02X -> 0x%02X]\r\n", i, ReadRawRC(pReader, i));
+    }
+#endif
+
+    cStatus = PcdSoftReset(pReader);
+    if (cStatus == MI_OK)
+        cStatus = PcdWriteRegTable(pReader, pcd_reset_regs, sizeof(pcd_reset_regs) / sizeof(pcd_reset_regs[0]));
+
+    return cStatus;
+}
+
+void M500PcdConfigISOType(struct rfid_reader_t *pReader, uint8_t ucType)
+{
+    if (ucType == 'A') //ISO14443_A
+    {
+        ClearBitMask(pReader, Status2Reg, 0x08);
+
+        PcdWriteRegTable(pReader, pcd_iso_a_regs, sizeof(pcd_iso_a_regs) / sizeof(pcd_iso_a_regs[0]));
+
+        PcdAntennaOn(pReader); //开天线
+    }
+    else
+    {
+        printk("unk ISO type\r\n");
+    }
+}
+
+uint8_t PcdInit(struct rfid_reader_t *pReader)
+{
+    uint8_t cStatus;
+
+    if (pReader->port->hard_reset)
+    {
+        pReader->port->hard_reset(pReader->port->priv);
+        InvalidateShadow(pReader);
+    }
+
+    cStatus = PcdSoftReset(pReader);
+    if (cStatus == MI_OK)
+        cStatus = PcdWriteRegTable(pReader, pcd_reset_regs, sizeof(pcd_reset_regs) / sizeof(pcd_reset_regs[0]));
+    if (cStatus == MI_OK)
+        cStatus = PcdWriteRegTable(pReader, pcd_iso_a_regs, sizeof(pcd_iso_a_regs) / sizeof(pcd_iso_a_regs[0]));
+    if (cStatus == MI_OK)
+        WriteRawRC(pReader, TxControlReg, 0x83); //复位值0x80, 开天线
+
+    return cStatus;
+}
+
+uint8_t PcdRequestStart(struct rfid_reader_t *pReader, uint8_t ucReq_code, uint8_t *pTagType)
+{
+    if (!PcdOpIdle(pReader))
+        return MI_ERR;
+
+    pReader->op.tx[0] = ucReq_code;
+
+    //寻卡及其后的防冲撞/选卡均为106kbit/s
+    if (pReader->bit_rate)
+        PcdSetBitRate(pReader, RFID_BR_106, RFID_BR_106);
+
+    //清理指示MIFARECyptol单元接通以及所有卡的数据通信被加密的情况
+    ClearBitMask(pReader, Status2Reg, 0x08);
+    //发送的最后一个字节的 七位
+    WriteRawRC(pReader, BitFramingReg, 0x07);
+    //TX1,TX2管脚的输出信号传递经发送调制的13.56的能量载波信号
+    SetBitMask(pReader, TxControlReg, 0x03);
+
+    PcdOpBegin(pReader, RFID_OP_REQUEST, 1, pTagType);
+
+    return MI_OK;
+}
+
+uint8_t PcdRequest(struct rfid_reader_t *pReader, uint8_t ucReq_code, uint8_t *pTagType)
+{
+    uint8_t cStatus = PcdRequestStart(pReader, ucReq_code, pTagType);
+
+    return (cStatus == MI_OK) ? PcdOpWait(pReader) : cStatus;
+}
+
+uint8_t PcdAnticoll(struct rfid_reader_t *pReader, uint8_t *pSnr)
+{
+    return PcdAnticollLevel(pReader, PICC_ANTICOLL1, pSnr);
+}
+
+uint8_t PcdSelect(struct rfid_reader_t *pReader, uint8_t *pSnr)
+{
+    uint8_t ucSak;
+
+    return PcdSelectLevel(pReader, PICC_ANTICOLL1, pSnr, &ucSak);
+}
+
+uint8_t PcdAnticollLevel(struct rfid_reader_t *pReader, uint8_t ucSel, uint8_t *pSnr)
+{
+    uint32_t ulLen;
+    uint8_t uc, cStatus, ucPos, ucBytes, ucAlign, ucMask, ucBits = 0;
+    uint8_t ucSnr_check = 0, ucComMF522Buf[MAXRLEN];
+    uint8_t ucTxBuf[7] = {ucSel}; //SEL NVB UID0~3 BCC
+
+    //清MFCryptol On位 只有成功执行MFAuthent命令后，该位才能置位
+    ClearBitMask(pReader, Status2Reg, 0x08);
+    //清ValuesAfterColl, 冲突位之后接收的位清零
+    ClearBitMask(pReader, CollReg, 0x80);
+
+    do
+    {
+        ucBytes = ucBits / 8;
+        ucAlign = ucBits % 8;
+        ucMask = (1 << ucAlign) - 1; //首字节中已知位
+
+        //NVB: 高4位为已发送的整字节数(含SEL NVB), 低4位为剩余位数
+        ucTxBuf[1] = ((2 + ucBytes) << 4) | ucAlign;
+        //TxLastBits与RxAlign相同, 应答首位紧接已知位之后
+        WriteRawRC(pReader, BitFramingReg, (ucAlign << 4) | ucAlign);
+
+        cStatus = PcdComMF522(pReader, RFID_OP_ANTICOLL, PCD_TRANSCEIVE, ucTxBuf, 2 + ucBytes + (ucAlign ? 1 : 0),
+                              ucComMF522Buf, &ulLen);
+
+        if ((cStatus != MI_OK) && (cStatus != MI_COLLERR))
+        {
+            break;
+        }
+
+        //合并应答, 接收首字节低位不属于本次应答
+        ucTxBuf[2 + ucBytes] = (ucTxBuf[2 + ucBytes] & ucMask) | (ucComMF522Buf[0] & ~ucMask);
+        for (uc = 1; (uc < (ulLen + 7) / 8) && (2 + ucBytes + uc < 7); uc++)
+        {
+            ucTxBuf[2 + ucBytes + uc] = ucComMF522Buf[uc];
+        }
+
+        if (cStatus == MI_COLLERR)
+        {
+            ucPos = ReadRawRC(pReader, CollReg);
+
+            //CollPosNotValid: 冲突位超出32位UID范围
+            if (ucPos & 0x20)
+            {
+                cStatus = MI_ERR;
+                break;
+            }
+
+            //CollPos从接收首字节第1位起算(0表示第32位), 换算为本级UID位序号
+            ucPos = ((ucPos & 0x1F) ? (ucPos & 0x1F) : 32) + ucBytes * 8;
+            if ((ucPos <= ucBits) || (ucPos > 32))
+            {
+                cStatus = MI_ERR;
+                break;
+            }
+
+            //冲突位取1, 下一轮只有该位为1的卡应答
+            ucTxBuf[2 + (ucPos - 1) / 8] |= 1 << ((ucPos - 1) % 8);
+            ucBits = ucPos;
+        }
+    } while (cStatus == MI_COLLERR);
+
+    //清理寄存器 恢复整字节收发
+    WriteRawRC(pReader, BitFramingReg, 0x00);
+    SetBitMask(pReader, CollReg, 0x80);
+
+    if (cStatus == MI_OK)
+    {
+        for (uc = 0; uc < 4; uc++)
+        {
+            *(pSnr + uc) = ucTxBuf[uc + 2];
+            ucSnr_check ^= ucTxBuf[uc + 2];
+        }
+
+        if (ucSnr_check != ucTxBuf[6])
+        {
+            cStatus = MI_ERR;
+        }
+    }
+
+    return cStatus;
+}
+
+uint8_t PcdSelectLevelStart(struct rfid_reader_t *pReader, uint8_t ucSel, const uint8_t *pSnr, uint8_t *pSak)
+{
+    uint8_t uc, *pBuf = pReader->op.tx;
+
+    if (!PcdOpIdle(pReader))
+        return MI_ERR;
+
+    pBuf[0] = ucSel;
+    pBuf[1] = 0x70;
+    pBuf[6] = 0;
+
+    for (uc = 0; uc < 4; uc++)
+    {
+        pBuf[uc + 2] = *(pSnr + uc);
+        pBuf[6] ^= *(pSnr + uc);
+    }
+
+    PcdCalcCrcA(pReader, pBuf, 7, &pBuf[7]);
+
+    ClearBitMask(pReader, Status2Reg, 0x08);
+    //整字节收发, 寻卡后直接选卡时BitFramingReg仍为7位
+    WriteRawRC(pReader, BitFramingReg, 0x00);
+
+    PcdOpBegin(pReader, RFID_OP_SELECT, 9, pSak);
+
+    return MI_OK;
+}
+
+uint8_t PcdSelectLevel(struct rfid_reader_t *pReader, uint8_t ucSel, const uint8_t *pSnr, uint8_t *pSak)
+{
+    uint8_t cStatus = PcdSelectLevelStart(pReader, ucSel, pSnr, pSak);
+
+    return (cStatus == MI_OK) ? PcdOpWait(pReader) : cStatus;
+}
+
+uint8_t PcdActivate(struct rfid_reader_t *pReader, uint8_t ucReq_code, struct rfid_card_t *pCard)
+{
+    uint8_t uc, ucLevel, cStatus, ucSnr[4];
+
+    cStatus = PcdRequest(pReader, ucReq_code, pCard->atqa);
+    if (cStatus != MI_OK)
+    {
+        return cStatus;
+    }
+
+    pCard->uid_len = 0;
+
+    for (ucLevel = 0; ucLevel < 3; ucLevel++)
+    {
+        //已收到ATQA, 之后丢失应答属于通信错误而非无卡
+        cStatus = PcdAnticollLevel(pReader, PICC_ANTICOLL1 + 2 * ucLevel, ucSnr);
+        if (cStatus != MI_OK)
+        {
+            return (cStatus == MI_NOTAGERR) ? MI_ERR : cStatus;
+        }
+
+        cStatus = PcdSelectLevel(pReader, PICC_ANTICOLL1 + 2 * ucLevel, ucSnr, &pCard->sak);
+        if (cStatus != MI_OK)
+        {
+            return (cStatus == MI_NOTAGERR) ? MI_ERR : cStatus;
+        }
+
+        if (!(pCard->sak & 0x04))
+        {
+            //UID完整
+            for (uc = 0; uc < 4; uc++)
+            {
+                pCard->uid[pCard->uid_len++] = ucSnr[uc];
+            }
+
+            return MI_OK;
+        }
+
+        //级联: 本级首字节为CT, 其余3字节属于UID
+        if ((ucSnr[0] != PICC_CT) || (ucLevel == 2))
+        {
+            return MI_ERR;
+        }
+
+        for (uc = 1; uc < 4; uc++)
+        {
+            pCard->uid[pCard->uid_len++] = ucSnr[uc];
+        }
+    }
+
+    return MI_ERR;
+}
+
+uint8_t PcdWakeup(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard)
+{
+    uint8_t uc, ucLevel, ucLevels, ucOfs, cStatus, ucSak, ucAtqa[2], ucSnr[4];
+
+    ucLevels = (pCard->uid_len > 7) ? 3 : ((pCard->uid_len > 4) ? 2 : 1);
+
+    cStatus = PcdRequest(pReader, PICC_REQALL, ucAtqa);
+    if (cStatus != MI_OK)
+    {
+        return cStatus;
+    }
+
+    //UID已知, 不需要防冲撞; 不匹配的卡回到IDLE
+    for (ucLevel = 0; ucLevel < ucLevels; ucLevel++)
+    {
+        ucOfs = 3 * ucLevel;
+
+        if (ucLevel < ucLevels - 1)
+        {
+            ucSnr[0] = PICC_CT;
+            for (uc = 1; uc < 4; uc++)
+            {
+                ucSnr[uc] = pCard->uid[ucOfs + uc - 1];
+            }
+        }
+        else
+        {
+            for (uc = 0; uc < 4; uc++)
+            {
+                ucSnr[uc] = pCard->uid[ucOfs + uc];
+            }
+        }
+
+        cStatus = PcdSelectLevel(pReader, PICC_ANTICOLL1 + 2 * ucLevel, ucSnr, &ucSak);
+        if (cStatus != MI_OK)
+        {
+            return cStatus;
+        }
+    }
+
+    return MI_OK;
 }
 
-uint8_t PcdRequest(uint8_t ucReq_code, uint8_t *pTagType)
+uint8_t PcdEnumerate(struct rfid_reader_t *pReader, uint8_t ucReq_code, struct rfid_card_t *pCards,
+                     uint8_t ucMax, uint8_t *pCount)
 {
-    uint32_t ulLen;
-    uint8_t cStatus, ucComMF522Buf[MAXRLEN] = {ucReq_code};
+    uint8_t cStatus = MI_NOTAGERR, ucRetry = 0;
 
-    //清理指示MIFARECyptol单元接通以及所有卡的数据通信被加密的情况
-    ClearBitMask(Status2Reg, 0x08);
-    //发送的最后一个字节的 七位
-    WriteRawRC(BitFramingReg, 0x07);
-    //TX1,TX2管脚的输出信号传递经发送调制的13.56的能量载波信号
-    SetBitMask(TxControlReg, 0x03);
+    *pCount = 0;
+
+    while (*pCount < ucMax)
+    {
+        cStatus = PcdActivate(pReader, ucReq_code, &pCards[*pCount]);
+
+        if (cStatus == MI_OK)
+        {
+            //选中的卡休眠, 下一轮REQA只有未枚举的卡应答
+            PcdHalt(pReader);
+            (*pCount)++;
+            ucRetry = 0;
+            ucReq_code = PICC_REQIDL;
+        }
+        //出错的一轮中途的卡收到REQA会回到IDLE而不应答, 出错后的无卡应答仍算作重试
+        else if (((cStatus == MI_NOTAGERR) && (ucRetry == 0)) || (++ucRetry > RFID_CFG_ENUM_RETRY))
+        {
+            break;
+        }
+    }
+
+    //无卡应答与芯片异常(重试后仍为MI_ERR)区分返回, 便于调用者判断读卡器故障
+    return (*pCount) ? MI_OK : cStatus;
+}
+
+uint8_t PcdAuthStateStart(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                          const uint8_t *pSnr)
+{
+    uint8_t uc, *pBuf = pReader->op.tx;
+
+    if (!PcdOpIdle(pReader))
+        return MI_ERR;
 
-    cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 1, ucComMF522Buf, &ulLen);
+    pBuf[0] = ucAuth_mode;
+    pBuf[1] = ucAddr;
 
-    if ((cStatus == MI_OK) && (ulLen == 0x10))
+    for (uc = 0; uc < 6; uc++)
     {
-        *pTagType = ucComMF522Buf[0];
-        *(pTagType + 1) = ucComMF522Buf[1];
+        pBuf[uc + 2] = *(pKey + uc);
     }
-    else
+
+    for (uc = 0; uc < 4; uc++)
     {
-        cStatus = MI_ERR;
+        pBuf[uc + 8] = *(pSnr + uc);
     }
 
-    return cStatus;
+    //清除上一次会话的MFCrypto1On, 否则认证失败时仍会被判为成功
+    ClearBitMask(pReader, Status2Reg, 0x08);
+
+    PcdOpBegin(pReader, RFID_OP_AUTH, 12, NULL);
+
+    return MI_OK;
 }
 
-uint8_t PcdAnticoll(uint8_t *pSnr)
+uint8_t PcdAuthState(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                     const uint8_t *pSnr)
 {
-    uint32_t ulLen;
-    uint8_t uc, cStatus, ucSnr_check = 0, ucComMF522Buf[MAXRLEN] = {PICC_ANTICOLL1, 0x20};
+    uint8_t cStatus = PcdAuthStateStart(pReader, ucAuth_mode, ucAddr, pKey, pSnr);
 
-    //清MFCryptol On位 只有成功执行MFAuthent命令后，该位才能置位
-    ClearBitMask(Status2Reg, 0x08);
-    //清理寄存器 停止收发
-    WriteRawRC(BitFramingReg, 0x00);
-    //清ValuesAfterColl所有接收的位在冲突后被清除
-    ClearBitMask(CollReg, 0x80);
+    return (cStatus == MI_OK) ? PcdOpWait(pReader) : cStatus;
+}
 
-    cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 2, ucComMF522Buf, &ulLen);
+uint8_t PcdAuthSector(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                      const uint8_t *pSnr)
+{
+    uint8_t uc, ucSame = pReader->session.valid && (pReader->session.mode == ucAuth_mode) &&
+                         (pReader->session.sector == BlockSector(ucAddr));
 
-    if (cStatus == MI_OK)
+    for (uc = 0; ucSame && (uc < 4); uc++)
     {
-        for (uc = 0; uc < 4; uc++)
+        ucSame = (pReader->session.snr[uc] == *(pSnr + uc));
+    }
+    for (uc = 0; ucSame && (uc < 6); uc++)
+    {
+        ucSame = (pReader->session.key[uc] == *(pKey + uc));
+    }
+
+    //MFCrypto1On仍置位说明芯片端会话未被其他操作结束
+    if (ucSame && (ReadRawRC(pReader, Status2Reg) & 0x08))
+    {
+        return MI_OK;
+    }
+
+    return PcdAuthState(pReader, ucAuth_mode, ucAddr, pKey, pSnr);
+}
+
+uint8_t PcdWriteStart(struct rfid_reader_t *pReader, uint8_t ucAddr, const uint8_t *pData)
+{
+    uint8_t uc, *pBuf = pReader->op.tx;
+
+    if (!PcdOpIdle(pReader))
+        return MI_ERR;
+
+    pBuf[0] = PICC_WRITE;
+    pBuf[1] = ucAddr;
+    PcdCalcCrcA(pReader, pBuf, 2, &pBuf[2]);
+
+    PcdOpBegin(pReader, RFID_OP_WRITE, 4, NULL);
+
+    //命令已写入FIFO, op.tx 改存数据阶段的内容
+    for (uc = 0; uc < 16; uc++)
+    {
+        pBuf[uc] = *(pData + uc);
+    }
+
+    return MI_OK;
+}
+
+uint8_t PcdWrite(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData)
+{
+    uint8_t cStatus = PcdWriteStart(pReader, ucAddr, pData);
+
+    return (cStatus == MI_OK) ? PcdOpWait(pReader) : cStatus;
+}
+
+uint8_t PcdReadStart(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData)
+{
+    uint8_t *pBuf = pReader->op.tx;
+
+    if (!PcdOpIdle(pReader))
+        return MI_ERR;
+
+    pBuf[0] = PICC_READ;
+    pBuf[1] = ucAddr;
+    PcdCalcCrcA(pReader, pBuf, 2, &pBuf[2]);
+
+    PcdOpBegin(pReader, RFID_OP_READ, 4, pData);
+
+    return MI_OK;
+}
+
+uint8_t PcdRead(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData)
+{
+    uint8_t cStatus = PcdReadStart(pReader, ucAddr, pData);
+
+    return (cStatus == MI_OK) ? PcdOpWait(pReader) : cStatus;
+}
+
+/**
+  * @brief  连续读多个块: 收发命令保持运行, 每块只需写FIFO与StartSend;
+  *         使用CRC协处理器(RFID_CFG_SW_CRC为0)时逐块 PcdRead, 协处理器与收发命令共用FIFO与CommandReg
+  * 
+  * @param  [in], ucAddr: 起始块地址
+  * @param  [in], ucCount: 块数
+  * @param  [out], pData: 读出的数据, 16 * ucCount 字节
+  * 
+  * @return status
+  */
+static uint8_t PcdReadBlocks(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t ucCount, uint8_t *pData)
+{
+#if !RFID_CFG_SW_CRC
+    uint8_t cStatus = MI_OK;
+
+    for (; ucCount && (cStatus == MI_OK); ucCount--, ucAddr++, pData += 16)
+        cStatus = PcdRead(pReader, ucAddr, pData);
+
+    return cStatus;
+#else
+    uint8_t uc, ucN, ucIrq, ucCrc[2], ucDone = 1, cStatus = MI_OK;
+    uint8_t ucCmd[4] = {PICC_READ}, ucBuf[MAXRLEN];
+    uint64_t ullDeadline;
+
+    //完成条件与 PcdComMF522 的收发命令相同
+    WriteRawRC(pReader, ComIEnReg, (pReader->port->wait_irq ? 0x31 : 0x77) | 0x80);
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
+    PcdSetTimer(pReader, pReader->timeout_us[RFID_OP_READ]);
+    WriteRawRC(pReader, FIFOLevelReg, 0x80);
+    WriteRawRC(pReader, BitFramingReg, 0x00);
+    WriteRawRC(pReader, CommandReg, PCD_TRANSCEIVE);
+
+    for (; ucCount; ucCount--, ucAddr++, pData += 16)
+    {
+        ucCmd[1] = ucAddr;
+        PcdCalcCrcA(pReader, ucCmd, 2, &ucCmd[2]);
+
+        FRAME_BEGIN(pReader, RFID_OP_READ, PCD_TRANSCEIVE, 4);
+        WriteRawRC(pReader, ComIrqReg, 0x7F);
+        WriteFIFO(pReader, ucCmd, 4);
+
+        ullDeadline = PcdTimeUs(pReader) + RFID_CFG_DEADLINE_SLACK_US + pReader->timeout_us[RFID_OP_READ] +
+                      (4 + MAXRLEN) * PCD_BYTE_AIR_US;
+        //收发命令接收结束后等待下一次StartSend
+        WriteRawRC(pReader, BitFramingReg, 0x80);
+
+        ucDone = PcdWaitDone(pReader, 0x30, ullDeadline, &ucIrq);
+        if (!ucDone || (ucIrq & 0x01))
+        {
+            cStatus = (ucIrq & 0x01) ? MI_NOTAGERR : MI_ERR;
+            break;
+        }
+
+        WriteRawRC(pReader, BitFramingReg, 0x00);
+
+        //NAK只有4位, FIFO中字节数不足
+        ucN = ReadRawRC(pReader, FIFOLevelReg);
+        if ((ReadRawRC(pReader, ErrorReg) & 0x1B) || (ucN != MAXRLEN))
         {
-            *(pSnr + uc) = ucComMF522Buf[uc];
-            ucSnr_check ^= ucComMF522Buf[uc];
+            cStatus = MI_ERR;
+            break;
         }
 
-        if (ucSnr_check != ucComMF522Buf[uc])
+        //FIFO读空, 下一块无需清FIFO
+        ReadFIFO(pReader, ucBuf, MAXRLEN);
+        PcdCalcCrcA(pReader, ucBuf, 16, ucCrc);
+        if ((ucCrc[0] != ucBuf[16]) || (ucCrc[1] != ucBuf[17]))
         {
             cStatus = MI_ERR;
+            break;
+        }
+
+        for (uc = 0; uc < 16; uc++)
+        {
+            pData[uc] = ucBuf[uc];
         }
+        FRAME_END(pReader, MI_OK, 0);
     }
 
-    SetBitMask(CollReg, 0x80);
+    //出错的一帧在此计入
+    if (cStatus != MI_OK)
+        FRAME_END(pReader, cStatus, !ucDone);
+
+    WriteRawRC(pReader, BitFramingReg, 0x00);
+    WriteRawRC(pReader, ControlReg, 0x80);
+    WriteRawRC(pReader, CommandReg, PCD_IDLE);
+
+    if (cStatus != MI_OK)
+        pReader->session.valid = 0;
 
     return cStatus;
+#endif
 }
 
-uint8_t PcdSelect(uint8_t *pSnr)
+uint8_t PcdReadSector(struct rfid_reader_t *pReader, uint8_t ucSector, uint8_t ucAuth_mode,
+                      const uint8_t *pKey, const uint8_t *pSnr, uint8_t *pData, uint8_t ucFlags)
 {
-    uint32_t ulLen;
-    uint8_t uc, cStatus, ucComMF522Buf[MAXRLEN];
-    ;
+    uint8_t cStatus, ucBlock = ucSector * RFID_M1_SECTOR_BLOCKS;
 
-    ucComMF522Buf[0] = PICC_ANTICOLL1;
-    ucComMF522Buf[1] = 0x70;
-    ucComMF522Buf[6] = 0;
+    if (ucSector >= RFID_M1_SECTORS)
+    {
+        return MI_ERR;
+    }
 
-    for (uc = 0; uc < 4; uc++)
+    //认证对整个扇区有效, 会话已在本扇区时不重复认证
+    cStatus = PcdAuthSector(pReader, ucAuth_mode, ucBlock + RFID_M1_SECTOR_BLOCKS - 1, pKey, pSnr);
+    if (cStatus != MI_OK)
     {
-        ucComMF522Buf[uc + 2] = *(pSnr + uc);
-        ucComMF522Buf[6] ^= *(pSnr + uc);
+        return cStatus;
     }
 
-    CalulateCRC(ucComMF522Buf, 7, &ucComMF522Buf[7]);
+    return PcdReadBlocks(pReader, ucBlock,
+                         (ucFlags & RFID_READ_SKIP_TRAILER) ? RFID_M1_SECTOR_BLOCKS - 1 : RFID_M1_SECTOR_BLOCKS,
+                         pData);
+}
 
-    ClearBitMask(Status2Reg, 0x08);
+uint8_t PcdReadCard(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard, uint8_t ucAuth_mode,
+                    const uint8_t *pKey, uint8_t *pImage, uint8_t *pSectorStatus, uint8_t ucFlags)
+{
+    uint8_t ucSector, cStatus = MI_OK, ucWake = 0;
+    const uint8_t *pSnr;
 
-    cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 9, ucComMF522Buf, &ulLen);
+    //M1卡认证使用UID末4字节
+    if (pCard->uid_len < 4)
+    {
+        for (ucSector = 0; ucSector < RFID_M1_SECTORS; ucSector++)
+            pSectorStatus[ucSector] = MI_ERR;
+        return MI_ERR;
+    }
+    pSnr = &pCard->uid[pCard->uid_len - 4];
 
-    if ((cStatus != MI_OK) || (ulLen != 0x18))
+    for (ucSector = 0; ucSector < RFID_M1_SECTORS; ucSector++)
     {
-        cStatus = MI_ERR;
+        //认证或读失败后卡片回到IDLE, 须重新选卡
+        if (ucWake && (PcdWakeup(pReader, pCard) != MI_OK))
+        {
+            pSectorStatus[ucSector] = MI_NOTAGERR;
+            cStatus = MI_ERR;
+            continue;
+        }
+
+        pSectorStatus[ucSector] = PcdReadSector(pReader, ucSector, ucAuth_mode, pKey, pSnr,
+                                                &pImage[ucSector * RFID_M1_SECTOR_BLOCKS * 16], ucFlags);
+        ucWake = (pSectorStatus[ucSector] != MI_OK);
+        if (ucWake)
+        {
+            cStatus = MI_ERR;
+        }
     }
 
     return cStatus;
 }
 
-uint8_t PcdAuthState(uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey, uint8_t *pSnr)
+void PcdSetTimeout(struct rfid_reader_t *pReader, uint8_t ucOp, uint32_t ulUs)
 {
-    uint32_t ulLen;
-    uint8_t uc, cStatus, ucComMF522Buf[MAXRLEN];
+    if (ucOp < RFID_OP_MAX)
+        pReader->timeout_us[ucOp] = ulUs;
+}
+
+void PcdSetBitRate(struct rfid_reader_t *pReader, uint8_t ucTxBr, uint8_t ucRxBr)
+{
+    ucTxBr &= 0x03;
+    ucRxBr &= 0x03;
 
-    ucComMF522Buf[0] = ucAuth_mode;
-    ucComMF522Buf[1] = ucAddr;
+    //TxCRCEn/RxCRCEn 保持关闭, CRC_A 由软件附加与检查
+    WriteRawRC(pReader, TxModeReg, ucTxBr << 4);
+    WriteRawRC(pReader, RxModeReg, ucRxBr << 4);
+    WriteRawRC(pReader, ModWidthReg, pcd_mod_width[ucTxBr]);
 
-    for (uc = 0; uc < 6; uc++)
+    pReader->bit_rate = (ucTxBr << 4) | ucRxBr;
+}
+
+uint32_t PcdGetTimeout(struct rfid_reader_t *pReader, uint8_t ucOp)
+{
+    return (ucOp < RFID_OP_MAX) ? pReader->timeout_us[ucOp] : 0;
+}
+
+void PcdGetStats(struct rfid_reader_t *pReader, struct rfid_stats_t *pStats)
+{
+#if RFID_CFG_STATS
+    *pStats = pReader->stats;
+#else
+    (void)pReader;
+    *pStats = (struct rfid_stats_t){0};
+#endif
+}
+
+void PcdClearStats(struct rfid_reader_t *pReader)
+{
+#if RFID_CFG_STATS
+    pReader->stats = (struct rfid_stats_t){0};
+#else
+    (void)pReader;
+#endif
+}
+
+void PcdTraceDump(struct rfid_reader_t *pReader)
+{
+#if RFID_CFG_TRACE
+    const struct rfid_trace_rec_t *pRec;
+    uint32_t ul, ulHead = pReader->trace_head;
+    uint32_t ulFirst = (ulHead > RFID_CFG_TRACE_LEN) ? (ulHead - RFID_CFG_TRACE_LEN) : 0;
+
+    printk("RFID TRACE %u %u\r\n", (unsigned)(ulHead - ulFirst), (unsigned)ulHead);
+
+    for (ul = ulFirst; ul < ulHead; ul++)
     {
-        ucComMF522Buf[uc + 2] = *(pKey + uc);
+        pRec = &pReader->trace[ul & (RFID_CFG_TRACE_LEN - 1)];
+        printk("%02X%02X%02X%02X%02X%02X%02X%02X", pRec->type, pRec->arg[0], pRec->arg[1], pRec->arg[2],
+               (unsigned)(pRec->time_us & 0xFF), (unsigned)((pRec->time_us >> 8) & 0xFF),
+               (unsigned)((pRec->time_us >> 16) & 0xFF), (unsigned)(pRec->time_us >> 24));
+        if (((ul - ulFirst) % 4 == 3) || (ul + 1 == ulHead))
+            printk("\r\n");
     }
 
-    for (uc = 0; uc < 4; uc++)
+    printk("RFID TRACE END\r\n");
+#else
+    (void)pReader;
+#endif
+}
+
+void PcdTraceClear(struct rfid_reader_t *pReader)
+{
+#if RFID_CFG_TRACE
+    pReader->trace_head = 0;
+#else
+    (void)pReader;
+#endif
+}
+
+/**
+  * @brief  FIFO回环: 写满64字节再读回, 图样含全0/全1/交替位与伪随机字节
+  * 
+  * @return 1 一致, 0 有误
+  */
+static uint8_t PcdClockTest(struct rfid_reader_t *pReader, uint8_t ucSeed)
+{
+    static const uint8_t ucEdge[4] = {0x00, 0xFF, 0x55, 0xAA};
+    const struct rfid_port_t *port = pReader->port;
+    uint8_t uc, ucLevel, ucTx[DEF_FIFO_LENGTH], ucRx[DEF_FIFO_LENGTH];
+    uint8_t ucLfsr = ucSeed | 0x01;
+
+    for (uc = 0; uc < DEF_FIFO_LENGTH; uc++)
     {
-        ucComMF522Buf[uc + 8] = *(pSnr + uc);
+        ucLfsr = (ucLfsr >> 1) ^ ((ucLfsr & 0x01) ? 0xB8 : 0x00);
+        ucTx[uc] = (uc < 4) ? ucEdge[uc] : ucLfsr;
     }
 
-    cStatus = PcdComMF522(PCD_AUTHENT, ucComMF522Buf, 12, ucComMF522Buf, &ulLen);
+    //直接经传输层访问, 不经过寄存器影子
+    port->write_reg(port->priv, FIFOLevelReg, 0x80);
+    port->write_burst(port->priv, FIFODataReg, ucTx, DEF_FIFO_LENGTH);
+    ucLevel = port->read_reg(port->priv, FIFOLevelReg) & 0x7F;
+    port->read_burst(port->priv, FIFODataReg, ucRx, DEF_FIFO_LENGTH);
+    port->write_reg(port->priv, FIFOLevelReg, 0x80);
+
+    if (ucLevel != DEF_FIFO_LENGTH)
+        return 0;
 
-    if ((cStatus != MI_OK) || (!(ReadRawRC(Status2Reg) & 0x08)))
+    for (uc = 0; uc < DEF_FIFO_LENGTH; uc++)
     {
-        cStatus = MI_ERR;
+        if (ucTx[uc] != ucRx[uc])
+            return 0;
     }
 
-    return cStatus;
+    return 1;
 }
 
-uint8_t PcdWrite(uint8_t ucAddr, uint8_t *pData)
+uint32_t PcdCalibrateClock(struct rfid_reader_t *pReader, uint32_t ulMaxHz, uint32_t ulMinHz)
 {
-    uint32_t ulLen;
-    uint8_t uc, cStatus, ucComMF522Buf[MAXRLEN] = {PICC_WRITE, ucAddr, 0, 0};
+    const struct rfid_port_t *port = pReader->port;
+    uint32_t ulHz, ulStep;
+    uint8_t uc;
 
-    CalulateCRC(ucComMF522Buf, 2, &ucComMF522Buf[2]);
+    //set_clk_hz(0) 在部分传输层上表示最高时钟
+    if ((ulMinHz == 0) || !port->set_clk_hz)
+        return 0;
 
-    cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 4, ucComMF522Buf, &ulLen);
+    for (ulHz = ulMaxHz; ulHz >= ulMinHz; )
+    {
+        port->set_clk_hz(port->priv, ulHz);
 
-    if ((cStatus != MI_OK) || (ulLen != 4) ||
-        ((ucComMF522Buf[0] & 0x0F) != 0x0A))
-        cStatus = MI_ERR;
+        for (uc = 0; uc < RFID_CFG_CLK_CAL_PASSES; uc++)
+        {
+            if (!PcdClockTest(pReader, uc))
+                break;
+        }
 
-    if (cStatus == MI_OK)
-    {
-        for (uc = 0; uc < 16; uc++)
+        if (uc == RFID_CFG_CLK_CAL_PASSES)
         {
-            ucComMF522Buf[uc] = *(pData + uc);
+            ulHz -= ulHz / 8;
+            return port->set_clk_hz(port->priv, (ulHz < ulMinHz) ? ulMinHz : ulHz);
         }
 
-        CalulateCRC(ucComMF522Buf, 16, &ucComMF522Buf[16]);
+        if (ulHz == ulMinHz)
+            break;
+
+        //每级降低1/8, 最后一级为 ulMinHz
+        ulStep = (ulHz / 8) ? (ulHz / 8) : 1;
+        ulHz = (ulHz - ulMinHz > ulStep) ? (ulHz - ulStep) : ulMinHz;
+    }
 
-        cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 18, ucComMF522Buf, &ulLen);
+    port->set_clk_hz(port->priv, ulMinHz);
 
-        if ((cStatus != MI_OK) || (ulLen != 4) ||
-            ((ucComMF522Buf[0] & 0x0F) != 0x0A))
-            cStatus = MI_ERR;
+    return 0;
+}
+
+void Pcd_port_init(struct rfid_reader_t *pReader, const struct rfid_port_t *port)
+{
+    pReader->port = port;
+    for (uint8_t uc = 0; uc < RFID_OP_MAX; uc++)
+        pReader->timeout_us[uc] = pcd_timeout_default_us[uc];
+    InvalidateShadow(pReader);
+    pReader->session.valid = 0;
+    pReader->com.busy = 0;
+    pReader->op.busy = 0;
+    pReader->bit_rate = 0;
+    pReader->timer_presc = PCD_TIMER_PRESCALER;
+#if RFID_CFG_STATS || RFID_CFG_TRACE
+    pReader->frame.cmd = PCD_IDLE;
+#endif
+    PcdClearStats(pReader);
+    PcdTraceClear(pReader);
+}
+
+/**
+  * @brief  值操作/传送的命令阶段, 卡片以4位ACK应答
+  */
+static uint8_t PcdValueCmd(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCmd, uint8_t ucAddr)
+{
+    uint32_t ulLen;
+    uint8_t cStatus, ucComMF522Buf[MAXRLEN] = {ucCmd, ucAddr, 0, 0};
+
+    PcdCalcCrcA(pReader, ucComMF522Buf, 2, &ucComMF522Buf[2]);
+
+    cStatus = PcdComMF522(pReader, ucOp, PCD_TRANSCEIVE, ucComMF522Buf, 4, ucComMF522Buf, &ulLen);
+
+    if ((cStatus != MI_OK) || (ulLen != 4) || ((ucComMF522Buf[0] & 0x0F) != 0x0A))
+    {
+        cStatus = MI_ERR;
+        pReader->session.valid = 0; //NAK或无应答后卡片回到IDLE
     }
+
     return cStatus;
 }
 
-uint8_t PcdRead(uint8_t ucAddr, uint8_t *pData)
+uint8_t PcdWriteValue(struct rfid_reader_t *pReader, uint8_t ucAddr, int32_t lValue)
 {
-    uint32_t ulLen;
-    uint8_t uc, cStatus, ucComMF522Buf[MAXRLEN] = {PICC_READ, ucAddr, 0, 0};
+    uint8_t uc, ucBlock[16];
+
+    for (uc = 0; uc < 4; uc++)
+    {
+        ucBlock[uc] = (uint32_t)lValue >> (8 * uc);
+        ucBlock[uc + 4] = ~ucBlock[uc];
+        ucBlock[uc + 8] = ucBlock[uc];
+    }
+
+    ucBlock[12] = ucAddr;
+    ucBlock[13] = ~ucAddr;
+    ucBlock[14] = ucAddr;
+    ucBlock[15] = ~ucAddr;
 
-    CalulateCRC(ucComMF522Buf, 2, &ucComMF522Buf[2]);
+    return PcdWrite(pReader, ucAddr, ucBlock);
+}
+
+uint8_t PcdReadValue(struct rfid_reader_t *pReader, uint8_t ucAddr, int32_t *pValue)
+{
+    uint8_t uc, cStatus, ucBlock[16];
 
-    cStatus = PcdComMF522(PCD_TRANSCEIVE, ucComMF522Buf, 4, ucComMF522Buf, &ulLen);
+    *pValue = 0;
 
-    if ((cStatus == MI_OK) && (ulLen == 0x90))
+    cStatus = PcdRead(pReader, ucAddr, ucBlock);
+    if (cStatus != MI_OK)
     {
-        for (uc = 0; uc < 16; uc++)
+        return cStatus;
+    }
+
+    //任一字节不符即不是值块
+    for (uc = 0; uc < 4; uc++)
+    {
+        if ((ucBlock[uc] != ucBlock[uc + 8]) || ((uint8_t)(ucBlock[uc] ^ ucBlock[uc + 4]) != 0xFF))
         {
-            *(pData + uc) = ucComMF522Buf[uc];
+            return MI_ERR;
         }
     }
-    else
+
+    if ((ucBlock[12] != ucBlock[14]) || (ucBlock[13] != ucBlock[15]) || ((uint8_t)(ucBlock[12] ^ ucBlock[13]) != 0xFF))
     {
-        cStatus = MI_ERR;
+        return MI_ERR;
     }
 
-    return cStatus;
+    *pValue = (int32_t)((uint32_t)ucBlock[0] | ((uint32_t)ucBlock[1] << 8) |
+                        ((uint32_t)ucBlock[2] << 16) | ((uint32_t)ucBlock[3] << 24));
+
+    return MI_OK;
+}
+
+uint8_t PcdValue(struct rfid_reader_t *pReader, uint8_t ucCmd, uint8_t ucAddr, uint32_t ulValue)
+{
+    uint32_t ulLen;
+    uint8_t uc, cStatus, ucComMF522Buf[MAXRLEN];
+
+    cStatus = PcdValueCmd(pReader, RFID_OP_VALUE, ucCmd, ucAddr);
+    if (cStatus != MI_OK)
+    {
+        return cStatus;
+    }
+
+    //操作数低字节在前, 恢复命令的操作数无意义
+    for (uc = 0; uc < 4; uc++)
+    {
+        ucComMF522Buf[uc] = (ucCmd == PICC_RESTORE) ? 0 : (uint8_t)(ulValue >> (8 * uc));
+    }
+
+    PcdCalcCrcA(pReader, ucComMF522Buf, 4, &ucComMF522Buf[4]);
+
+    cStatus = PcdComMF522(pReader, RFID_OP_VALUE_DATA, PCD_TRANSCEIVE, ucComMF522Buf, 6, ucComMF522Buf, &ulLen);
+
+    //第二阶段卡片不应答即成功, 只有出错时回NAK
+    if (cStatus == MI_NOTAGERR)
+    {
+        return MI_OK;
+    }
+
+    pReader->session.valid = 0;
+
+    return MI_ERR;
 }
 
-void Pcd_io_init(const struct rfid_io_cfg_t *cfg)
+uint8_t PcdTransfer(struct rfid_reader_t *pReader, uint8_t ucAddr)
 {
-    spi_io_cfg.hs_cs = cfg->hs_cs;
-    spi_io_cfg.hs_clk = cfg->hs_clk;
-    spi_io_cfg.hs_mosi = cfg->hs_mosi;
-    spi_io_cfg.hs_miso = cfg->hs_miso;
-    spi_io_cfg.hs_rst = cfg->hs_rst;
+    return PcdValueCmd(pReader, RFID_OP_TRANSFER, PICC_TRANSFER, ucAddr);
+}
+
+uint8_t PcdDecrementTransfer(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t ucBackup, uint32_t ulAmount)
+{
+    uint8_t cStatus;
+
+    //减值结果写入另一块, 原块即为备份; 传送中断时原块不变
+    cStatus = PcdValue(pReader, PICC_DECREMENT, ucAddr, ulAmount);
+    if (cStatus == MI_OK)
+        cStatus = PcdTransfer(pReader, ucBackup);
 
-    spi_io_cfg.clk_delay_us = cfg->clk_delay_us;
+    return cStatus;
+}
 
-    fpioa_set_function(RFID_CS_PIN, FUNC_GPIOHS0 + RFID_CS_HSNUM);
-    fpioa_set_function(RFID_CK_PIN, FUNC_GPIOHS0 + RFID_CK_HSNUM);
-    fpioa_set_function(RFID_MO_PIN, FUNC_GPIOHS0 + RFID_MO_HSNUM);
-    fpioa_set_function(RFID_MI_PIN, FUNC_GPIOHS0 + RFID_MI_HSNUM);
+uint8_t PcdReadValuePair(struct rfid_reader_t *pReader, uint8_t ucAddrA, uint8_t ucAddrB, uint8_t *pLive,
+                         int32_t *pValue)
+{
+    int32_t lValueA, lValueB;
+    uint8_t cStatusA, cStatusB;
 
-    gpiohs_set_drive_mode(spi_io_cfg.hs_cs, GPIO_DM_OUTPUT);
-    gpiohs_set_drive_mode(spi_io_cfg.hs_clk, GPIO_DM_OUTPUT);
-    gpiohs_set_drive_mode(spi_io_cfg.hs_mosi, GPIO_DM_OUTPUT);
-    gpiohs_set_drive_mode(spi_io_cfg.hs_miso, GPIO_DM_INPUT);
+    cStatusA = PcdReadValue(pReader, ucAddrA, &lValueA);
+    cStatusB = PcdReadValue(pReader, ucAddrB, &lValueB);
 
-    gpiohs_set_pin(spi_io_cfg.hs_cs, 1);
-    gpiohs_set_pin(spi_io_cfg.hs_clk, 1);
-    gpiohs_set_pin(spi_io_cfg.hs_mosi, 1);
+    if ((cStatusA != MI_OK) && (cStatusB != MI_OK))
+        return MI_ERR;
 
-    if (0xFF != spi_io_cfg.hs_rst)
+    //只扣款时余额单调减少, 两块都有效时较小者为最近一次写入
+    if ((cStatusB != MI_OK) || ((cStatusA == MI_OK) && (lValueA <= lValueB)))
     {
-        gpiohs_set_drive_mode(spi_io_cfg.hs_rst, GPIO_DM_OUTPUT);
-        gpiohs_set_pin(spi_io_cfg.hs_rst, 1);
+        *pLive = ucAddrA;
+        *pValue = lValueA;
     }
+    else
+    {
+        *pLive = ucAddrB;
+        *pValue = lValueB;
+    }
+
+    return MI_OK;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -591,31 +2229,9 @@ void Pcd_io_init(const struct rfid_io_cfg_t *cfg)
 //          pData：写入的金额
 //返    回: 成功返回MI_OK
 /////////////////////////////////////////////////////////////////////
-char WriteAmount(uint8_t ucAddr, uint32_t pData)
+char WriteAmount(struct rfid_reader_t *pReader, uint8_t ucAddr, uint32_t pData)
 {
-    uint8_t status;
-    uint8_t ucComMF522Buf[16];
-    ucComMF522Buf[0] = (pData & ((uint32_t)0x000000ff));
-    ucComMF522Buf[1] = (pData & ((uint32_t)0x0000ff00)) >> 8;
-    ucComMF522Buf[2] = (pData & ((uint32_t)0x00ff0000)) >> 16;
-    ucComMF522Buf[3] = (pData & ((uint32_t)0xff000000)) >> 24;
-
-    ucComMF522Buf[4] = ~(pData & ((uint32_t)0x000000ff));
-    ucComMF522Buf[5] = ~(pData & ((uint32_t)0x0000ff00)) >> 8;
-    ucComMF522Buf[6] = ~(pData & ((uint32_t)0x00ff0000)) >> 16;
-    ucComMF522Buf[7] = ~(pData & ((uint32_t)0xff000000)) >> 24;
-
-    ucComMF522Buf[8] = (pData & ((uint32_t)0x000000ff));
-    ucComMF522Buf[9] = (pData & ((uint32_t)0x0000ff00)) >> 8;
-    ucComMF522Buf[10] = (pData & ((uint32_t)0x00ff0000)) >> 16;
-    ucComMF522Buf[11] = (pData & ((uint32_t)0xff000000)) >> 24;
-
-    ucComMF522Buf[12] = ucAddr;
-    ucComMF522Buf[13] = ~ucAddr;
-    ucComMF522Buf[14] = ucAddr;
-    ucComMF522Buf[15] = ~ucAddr;
-    status = PcdWrite(ucAddr, ucComMF522Buf);
-    return status;
+    return PcdWriteValue(pReader, ucAddr, (int32_t)pData);
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -624,29 +2240,7 @@ char WriteAmount(uint8_t ucAddr, uint32_t pData)
 //          *pData：读出的金额
 //返    回: 成功返回MI_OK
 /////////////////////////////////////////////////////////////////////
-char ReadAmount(uint8_t ucAddr, uint32_t *pData)
+char ReadAmount(struct rfid_reader_t *pReader, uint8_t ucAddr, uint32_t *pData)
 {
-
-    uint8_t status = MI_ERR;
-    uint8_t j;
-    uint8_t ucComMF522Buf[16];
-    status = PcdRead(ucAddr, ucComMF522Buf);
-    if (status != MI_OK)
-        return status;
-    for (j = 0; j < 4; j++)
-    {
-        if ((ucComMF522Buf[j] != ucComMF522Buf[j + 8]) && (ucComMF522Buf[j] != ~ucComMF522Buf[j + 4])) //验证一下是不是钱包的数据
-            break;
-    }
-    if (j == 4)
-    {
-        status = MI_OK;
-        *pData = ucComMF522Buf[0] + (ucComMF522Buf[1] << 8) + (ucComMF522Buf[2] << 16) + (ucComMF522Buf[3] << 24);
-    }
-    else
-    {
-        status = MI_ERR;
-        *pData = 0;
-    }
-    return status;
+    return PcdReadValue(pReader, ucAddr, (int32_t *)pData);
 }
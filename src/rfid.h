@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 
+#include "rfid_config.h"
+#include "rfid_port.h"
+
 /* clang-format off */
 /////////////////////////////////////////////////////////////////////
 //MF522命令字
@@ -21,6 +24,8 @@
 #define PICC_REQALL             (0x52)    //寻天线区内全部卡
 #define PICC_ANTICOLL1          (0x93)    //防冲撞
 #define PICC_ANTICOLL2          (0x95)    //防冲撞
+#define PICC_ANTICOLL3          (0x97)    //防冲撞
+#define PICC_CT                 (0x88)    //级联标志, UID未完整
 #define PICC_AUTHENT1A          (0x60)    //验证A密钥
 #define PICC_AUTHENT1B          (0x61)    //验证B密钥
 #define PICC_READ               (0x30)    //读块
@@ -36,6 +41,13 @@
 #define DEF_FIFO_LENGTH         (64)
 #define MAXRLEN                 (18)
 /////////////////////////////////////////////////////////////////////
+//Mifare_One(S50) 存储结构
+/////////////////////////////////////////////////////////////////////
+#define RFID_M1_SECTORS         (16)
+#define RFID_M1_SECTOR_BLOCKS   (4)     //每扇区块数, 末块为扇区尾块
+#define RFID_M1_SIZE            (1024)
+#define RFID_READ_SKIP_TRAILER  (0x01)  //批量读时跳过扇区尾块
+/////////////////////////////////////////////////////////////////////
 //MF522寄存器定义
 /////////////////////////////////////////////////////////////////////
 // PAGE 0
@@ -112,51 +124,276 @@
 #define MI_OK                   (0x26)
 #define MI_NOTAGERR             (0xCC)
 #define MI_ERR                  (0xBB)
+#define MI_COLLERR              (0xDD)    //多张卡应答发生位冲突, 数据仍有效至冲突位
+#define MI_BUSY                 (0xEE)    //非阻塞操作仍在进行
+/////////////////////////////////////////////////////////////////////
+//操作类型, 用于按操作设置超时
+/////////////////////////////////////////////////////////////////////
+#define RFID_OP_REQUEST         (0)    //REQA/WUPA
+#define RFID_OP_ANTICOLL        (1)    //防冲撞
+#define RFID_OP_SELECT          (2)    //选卡
+#define RFID_OP_AUTH            (3)    //MFAuthent
+#define RFID_OP_READ            (4)    //读块
+#define RFID_OP_WRITE           (5)    //写块第一阶段(命令)
+#define RFID_OP_WRITE_DATA      (6)    //写块第二阶段(数据, 含EEPROM编程时间)
+#define RFID_OP_HALT            (7)    //休眠
+#define RFID_OP_VALUE           (8)    //增值/减值/恢复第一阶段(命令)
+#define RFID_OP_VALUE_DATA      (9)    //增值/减值/恢复第二阶段(操作数), 卡片不应答即成功
+#define RFID_OP_TRANSFER        (10)   //传送, 含EEPROM编程时间
+#define RFID_OP_ISODEP          (11)   //ISO14443-4 块交换, 帧等待时间由 ATS 决定
+#define RFID_OP_MAX             (12)
+/////////////////////////////////////////////////////////////////////
+//ISO14443A 收发速率, 与 TxModeReg/RxModeReg 的速率位及 PPS 的 DSI/DRI 编码相同
+/////////////////////////////////////////////////////////////////////
+#define RFID_BR_106             (0)
+#define RFID_BR_212             (1)
+#define RFID_BR_424             (2)
+#define RFID_BR_848             (3)
+/////////////////////////////////////////////////////////////////////
+//rfid_io_cfg_t.io_mode
+/////////////////////////////////////////////////////////////////////
+#define RFID_IO_GPIOHS          (0)    //GPIOHS模拟SPI
+#define RFID_IO_SPI             (1)    //硬件SPI
+#define RFID_IO_SPI_DMA         (2)    //硬件SPI, FIFO连续读写使用DMA
+#define RFID_IO_GPIOHS_FAST     (3)    //GPIOHS模拟SPI, 按CPU周期计数延时, 位时钟为 spi_clk_hz
+#define RFID_SPI_MAX_HZ         (10000000)
+/////////////////////////////////////////////////////////////////////
+//帧耗时直方图: 第i档为 < (RFID_STATS_HIST_BASE_US << i), 最后一档为其余
+/////////////////////////////////////////////////////////////////////
+#define RFID_STATS_HIST_LEN     (8)
+#define RFID_STATS_HIST_BASE_US (250)
+/////////////////////////////////////////////////////////////////////
+//跟踪记录类型, 见 rfid_trace_rec_t
+/////////////////////////////////////////////////////////////////////
+#define RFID_TRACE_RD           (1)    //读寄存器: 地址 值 连续相同读取的额外次数
+#define RFID_TRACE_WR           (2)    //写寄存器: 地址 值
+#define RFID_TRACE_FIFO_RD      (3)    //读FIFO: 字节数, 其后为数据记录
+#define RFID_TRACE_FIFO_WR      (4)    //写FIFO: 字节数, 其后为数据记录, 认证帧的密钥记为0
+#define RFID_TRACE_FRAME        (5)    //帧开始: RFID_OP_* 命令字 发送字节数
+#define RFID_TRACE_DONE         (6)    //帧结束: RFID_OP_* status 标志(bit0: 单调时钟超时)
+#define RFID_TRACE_DATA         (7)    //FIFO数据: arg 与 time_us 共7字节
 /////////////////////////////////////////////////////////////////////
 /* clang-format on */
 
 struct rfid_io_cfg_t
 {
     uint8_t hs_cs;
-    uint8_t hs_clk;
-    uint8_t hs_mosi;
-    uint8_t hs_miso;
+    uint8_t hs_clk;  /* RFID_CFG_IO_STATIC 时忽略, 取 RFID_CK_HSNUM */
+    uint8_t hs_mosi; /* RFID_CFG_IO_STATIC 时忽略, 取 RFID_MO_HSNUM */
+    uint8_t hs_miso; /* RFID_CFG_IO_STATIC 时忽略, 取 RFID_MI_HSNUM */
     uint8_t hs_rst; /* 0xFF: disable */
     uint8_t clk_delay_us;
+    uint8_t hs_irq; /* 0xFF: disable, 否则 irq_pin 映射到该GPIOHS, 等待时休眠 */
+    uint8_t cs_pin;  /* 本读卡器CS所接的FPIOA引脚; CLK/MOSI/MISO 为 board_config.h 中各读卡器共用的引脚 */
+    uint8_t irq_pin; /* 本读卡器IRQ所接的FPIOA引脚, hs_irq 为 0xFF 时不使用 */
+
+    uint8_t io_mode;     /* RFID_IO_*, 默认GPIOHS */
+    uint8_t spi_num;     /* 硬件SPI: SPI_DEVICE_0 或 SPI_DEVICE_1 */
+    uint8_t spi_cs;      /* 硬件SPI片选 0~3, 同一SPI上的读卡器各用一个 */
+    uint32_t spi_clk_hz; /* 硬件SPI或 RFID_IO_GPIOHS_FAST 的时钟, 0 或超过 RFID_SPI_MAX_HZ 时取最大 */
+    uint8_t dma_tx;      /* RFID_IO_SPI_DMA: 发送DMA通道 */
+    uint8_t dma_rx;      /* RFID_IO_SPI_DMA: 接收DMA通道 */
+};
+
+/**
+  * @brief 一种操作(RFID_OP_*)的帧统计, 帧从写FIFO发命令起到结果判定止;
+  *        非阻塞接口的耗时包含调用者两次查询之间的间隔
+  */
+struct rfid_op_stats_t
+{
+    uint32_t frames;
+    uint32_t ok;
+    uint32_t notag;     /* MI_NOTAGERR: 帧等待时间内卡片无应答 */
+    uint32_t coll;      /* MI_COLLERR: 位冲突 */
+    uint32_t err;       /* MI_ERR: 错误标志, 应答长度/CRC/ACK不符 */
+    uint32_t timeouts;  /* 单调时钟超时, 芯片未给出完成标志, 多为芯片或接线异常 */
+    uint32_t spi_bytes; /* 帧期间的SPI字节数 */
+    uint32_t irq_polls; /* 帧期间查询 ComIrqReg 的次数 */
+    uint32_t max_us;
+    uint32_t hist[RFID_STATS_HIST_LEN];
+};
+
+/**
+  * @brief 读卡器性能计数, RFID_CFG_STATS 为0时不编译
+  */
+struct rfid_stats_t
+{
+    uint32_t spi_bytes;
+    uint32_t reg_reads;   /* 读寄存器字节数, 含FIFO连续读 */
+    uint32_t reg_writes;  /* 写寄存器字节数, 含FIFO连续写 */
+    uint32_t shadow_hits; /* 影子缓存免去的读与跳过的写 */
+    uint32_t irq_polls;   /* 等待完成时查询 ComIrqReg 的次数 */
+    uint32_t irq_sleeps;  /* 等待IRQ引脚的次数 */
+    struct rfid_op_stats_t op[RFID_OP_MAX];
+};
+
+/**
+  * @brief 跟踪记录, PcdTraceDump 按 type arg[0..2] time_us(小端) 的顺序输出8字节
+  */
+struct rfid_trace_rec_t
+{
+    uint8_t type;     /* RFID_TRACE_* */
+    uint8_t arg[3];
+    uint32_t time_us; /* PcdTimeUs() 低32位; RFID_TRACE_DATA 为数据字节3~6, 低字节在前 */
+};
+
+/**
+  * @brief 读卡器实例, 每片RC522一个, 由调用者分配;
+  *        经 Pcd_io_init 或 Pcd_port_init 初始化后作为所有 Pcd* 函数的第一个参数
+  */
+struct rfid_reader_t
+{
+    const struct rfid_port_t *port;
+    uint32_t timeout_us[RFID_OP_MAX]; /* 各操作帧等待时间, 见 PcdSetTimeout */
+    uint8_t bit_rate;                 /* 当前速率 (发送 << 4) | 接收, RFID_BR_*; 非0时寻卡前恢复106kbit/s */
+    uint16_t timer_presc;             /* 定时器当前分频, 长帧等待时间加大, 见 PcdSetTimeout */
+
+    /*
+     * 当前Crypto1认证会话. 寻卡/防冲撞/选卡/休眠/认证会结束会话, 读写失败后卡片回到IDLE,
+     * 只有读写成功时会话保持.
+     */
+    struct
+    {
+        uint8_t valid;
+        uint8_t mode;
+        uint8_t sector;
+        uint8_t snr[4];
+        uint8_t key[6];
+    } session;
+
+    /* 进行中的一帧通讯, 见 PcdComStart; 阻塞接口同样经此完成 */
+    struct
+    {
+        uint8_t busy;     /* 已启动, 尚未结束 */
+        uint8_t done;     /* 已完成或超时, 等待读出结果 */
+        uint8_t ok;       /* 完成标志有效, 0 为单调时钟超时 */
+        uint8_t command;  /* PCD_TRANSCEIVE 或 PCD_AUTHENT */
+        uint8_t irq_en;
+        uint8_t wait_for;
+        uint8_t irq;      /* 结束时的 ComIrqReg */
+        uint64_t deadline_us;
+    } com;
+
+    /* 进行中的高层操作, 见 PcdOpPoll */
+    struct
+    {
+        uint8_t busy;
+        uint8_t op;       /* RFID_OP_* */
+        uint8_t *out;     /* 操作结果写入位置 */
+        uint8_t tx[MAXRLEN];
+        uint8_t rx[MAXRLEN];
+    } op;
+
+#if RFID_CFG_REG_SHADOW
+    uint8_t reg_shadow[0x40];
+    uint64_t shadow_valid;
+#endif
+
+#if RFID_CFG_STATS
+    struct rfid_stats_t stats;
+#endif
+
+#if RFID_CFG_TRACE
+    struct rfid_trace_rec_t trace[RFID_CFG_TRACE_LEN];
+    uint32_t trace_head; /* 累计写入的记录数 */
+#endif
+
+#if RFID_CFG_STATS || RFID_CFG_TRACE
+    /* 当前帧, 帧结束时计数差值计入该操作 */
+    struct
+    {
+        uint8_t op;
+        uint8_t cmd; /* 帧外为 PCD_IDLE */
+        uint64_t start_us;
+        uint32_t spi_bytes;
+        uint32_t irq_polls;
+    } frame;
+#endif
+};
+
+/**
+  * @brief ISO14443A 卡片信息
+  */
+struct rfid_card_t
+{
+    uint8_t atqa[2];
+    uint8_t uid[10];
+    uint8_t uid_len; /* 4, 7 或 10 */
+    uint8_t sak;
 };
 
 /**
   * @brief  开启天线 
+  * 
+  * @param  [in], pReader: 读卡器
   */
-void PcdAntennaOn(void);
+void PcdAntennaOn(struct rfid_reader_t *pReader);
 
 /**
   * @brief  关闭天线
+  * 
+  * @param  [in], pReader: 读卡器
+  */
+void PcdAntennaOff(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  关天线并进入软掉电: 振荡器停止, 寄存器与FIFO保持, 之后只能读写寄存器,
+  *         通讯前须 PcdPowerUp
+  * 
+  * @param  [in], pReader: 读卡器
   */
-void PcdAntennaOff(void);
+void PcdPowerDown(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  退出软掉电, 轮询 PowerDown 位直到振荡器起振; 天线仍为关闭
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return status, 芯片无响应返回MI_ERR
+  */
+uint8_t PcdPowerUp(struct rfid_reader_t *pReader);
 
 /**
   * @brief  命令卡片进入休眠状态
   * 
+  * @param  [in], pReader: 读卡器
+  * 
   * @return status
   */
-uint8_t PcdHalt(void);
+uint8_t PcdHalt(struct rfid_reader_t *pReader);
 
 /**
   * @brief  复位RC522 
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return status, 芯片无响应(不写寄存器表)或 RFID_CFG_INIT_VERIFY 读回不符时返回MI_ERR
   */
-void PcdReset(void);
+uint8_t PcdReset(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  上电初始化: 硬复位(若接有RST)与软复位, 按寄存器表配置为 ISO14443A 并开天线,
+  *         等同 PcdReset + M500PcdConfigISOType('A'), 不含固定延时;
+  *         卡片在天线场开启后需1~2ms上电, 之前的寻卡返回 MI_NOTAGERR
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return status, 芯片无响应或 RFID_CFG_INIT_VERIFY 读回不符时返回MI_ERR
+  */
+uint8_t PcdInit(struct rfid_reader_t *pReader);
 
 /**
   * @brief  设置RC522的工作方式
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], ucType: 工作方式
   */
-void M500PcdConfigISOType(uint8_t ucType);
+void M500PcdConfigISOType(struct rfid_reader_t *pReader, uint8_t ucType);
 
 /**
   * @brief 寻卡
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], ucReq_code: 寻卡方式 = 0x52，寻感应区内所有符合14443A标准的卡；
   *         寻卡方式= 0x26，寻未进入休眠状态的卡
   * @param  [in], pTagType: 卡片类型代码
@@ -166,31 +403,82 @@ void M500PcdConfigISOType(uint8_t ucType);
   *             = 0x0800，Mifare_Pro(X))
   *             = 0x4403，Mifare_DESFire
   *
+  * @return status, 多卡ATQA冲突时仍返回MI_OK, 无卡返回MI_NOTAGERR
+  */
+uint8_t PcdRequest(struct rfid_reader_t *pReader, uint8_t ucReq_code, uint8_t *pTagType);
+
+/**
+  * @brief  防冲撞(第1级联层)
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [out], pSnr: 卡片序列号，4字节
+  * 
   * @return status
   */
-uint8_t PcdRequest(uint8_t ucReq_code, uint8_t *pTagType);
+uint8_t PcdAnticoll(struct rfid_reader_t *pReader, uint8_t *pSnr);
 
 /**
-  * @brief  防冲撞
+  * @brief  选定卡片(第1级联层)
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], pSnr: 卡片序列号，4字节
   * 
   * @return status
   */
-uint8_t PcdAnticoll(uint8_t *pSnr);
+uint8_t PcdSelect(struct rfid_reader_t *pReader, uint8_t *pSnr);
 
 /**
-  * @brief  选定卡片
+  * @brief  某一级联层的位防冲撞, 按CollReg逐位解决冲突, 冲突位取1
   * 
-  * @param  [in], pSnr: 卡片序列号，4字节
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucSel: PICC_ANTICOLL1/PICC_ANTICOLL2/PICC_ANTICOLL3
+  * @param  [out], pSnr: 本级4字节UID, 有下一级时首字节为PICC_CT
+  * 
+  * @return status
+  */
+uint8_t PcdAnticollLevel(struct rfid_reader_t *pReader, uint8_t ucSel, uint8_t *pSnr);
+
+/**
+  * @brief  选定某一级联层
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucSel: PICC_ANTICOLL1/PICC_ANTICOLL2/PICC_ANTICOLL3
+  * @param  [in], pSnr: 本级4字节UID
+  * @param  [out], pSak: SAK, bit2置位表示UID未完整
   * 
   * @return status
   */
-uint8_t PcdSelect(uint8_t *pSnr);
+uint8_t PcdSelectLevel(struct rfid_reader_t *pReader, uint8_t ucSel, const uint8_t *pSnr, uint8_t *pSak);
+
+/**
+  * @brief  寻卡并完成全部级联层的防冲撞与选卡
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucReq_code: PICC_REQIDL 或 PICC_REQALL
+  * @param  [out], pCard: ATQA, 完整UID与SAK; 7/10字节UID的M1卡认证时使用UID末4字节
+  * 
+  * @return status
+  */
+uint8_t PcdActivate(struct rfid_reader_t *pReader, uint8_t ucReq_code, struct rfid_card_t *pCard);
+
+/**
+  * @brief  枚举场内全部卡片, 每选中一张即令其休眠, 直到无卡应答
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucReq_code: 第一轮寻卡方式, PICC_REQALL 可唤醒已休眠的卡
+  * @param  [out], pCards: 卡片信息
+  * @param  [in], ucMax: pCards容量
+  * @param  [out], pCount: 枚举到的卡片数, 返回后这些卡均处于休眠状态
+  * 
+  * @return status, 至少一张卡时返回MI_OK, 无卡返回MI_NOTAGERR, 重试后仍失败返回MI_ERR
+  */
+uint8_t PcdEnumerate(struct rfid_reader_t *pReader, uint8_t ucReq_code, struct rfid_card_t *pCards,
+                     uint8_t ucMax, uint8_t *pCount);
 
 /**
   * @brief  验证卡片密码
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], ucAuth_mode: 密码验证模式= 0x60，验证A密钥，
             密码验证模式= 0x61，验证B密钥
   * @param  [in], ucAddr: 块地址
@@ -199,36 +487,433 @@ uint8_t PcdSelect(uint8_t *pSnr);
   * 
   * @return status
   */
-uint8_t PcdAuthState(uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey, uint8_t *pSnr);
+uint8_t PcdAuthState(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                     const uint8_t *pSnr);
+
+/**
+  * @brief  验证卡片密码, 同一卡号/扇区/密钥类型/密码的会话仍有效(MFCrypto1On置位)时不重复认证
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAuth_mode: 密码验证模式= 0x60，验证A密钥，
+            密码验证模式= 0x61，验证B密钥
+  * @param  [in], ucAddr: 块地址
+  * @param  [in], pKey: 密码 
+  * @param  [in], pSnr: 卡片序列号，4字节
+  * 
+  * @return status
+  */
+uint8_t PcdAuthSector(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                      const uint8_t *pSnr);
 
 /**
   * @brief  写数据到M1卡一块
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], ucAddr: 块地址
   * @param  [in], pData: 写入的数据，16字节
   * 
   * @return status
   */
-uint8_t PcdWrite(uint8_t ucAddr, uint8_t *pData);
+uint8_t PcdWrite(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData);
 
 /**
   * @brief  读取M1卡一块数据
   * 
+  * @param  [in], pReader: 读卡器
   * @param  [in], ucAddr: 块地址
   * @param  [out], pData: 读出的数据，16字节
   * 
   * @return status
   */
-uint8_t PcdRead(uint8_t ucAddr, uint8_t *pData);
+uint8_t PcdRead(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData);
+
+/**
+  * @brief  读取一个扇区: 认证一次后连续读各块, 并校验每块的CRC_A
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucSector: 扇区号 0~15
+  * @param  [in], ucAuth_mode: PICC_AUTHENT1A 或 PICC_AUTHENT1B
+  * @param  [in], pKey: 密码
+  * @param  [in], pSnr: 卡片序列号，4字节
+  * @param  [out], pData: 读出的数据, 64字节; 跳过尾块时末16字节不写入
+  * @param  [in], ucFlags: RFID_READ_SKIP_TRAILER
+  * 
+  * @return status
+  */
+uint8_t PcdReadSector(struct rfid_reader_t *pReader, uint8_t ucSector, uint8_t ucAuth_mode,
+                      const uint8_t *pKey, const uint8_t *pSnr, uint8_t *pData, uint8_t ucFlags);
+
+/**
+  * @brief  读取整张M1卡, 每扇区认证一次, 某扇区失败后重新选卡继续读后续扇区
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pCard: 已选定的卡片, uid_len 不足4时返回MI_ERR
+  * @param  [in], ucAuth_mode: PICC_AUTHENT1A 或 PICC_AUTHENT1B
+  * @param  [in], pKey: 密码, 所有扇区相同
+  * @param  [out], pImage: 卡片映像, RFID_M1_SIZE 字节, 按块地址排列
+  * @param  [out], pSectorStatus: 各扇区状态, RFID_M1_SECTORS 字节
+  * @param  [in], ucFlags: RFID_READ_SKIP_TRAILER
+  * 
+  * @return 全部扇区成功返回MI_OK
+  */
+uint8_t PcdReadCard(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard, uint8_t ucAuth_mode,
+                    const uint8_t *pKey, uint8_t *pImage, uint8_t *pSectorStatus, uint8_t ucFlags);
+
+/**
+  * @brief  将块格式化为钱包(值块): 值, 值取反, 值, 地址, 地址取反, 地址, 地址取反
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 块地址
+  * @param  [in], lValue: 初始值
+  * 
+  * @return status
+  */
+uint8_t PcdWriteValue(struct rfid_reader_t *pReader, uint8_t ucAddr, int32_t lValue);
+
+/**
+  * @brief  读取钱包并校验值块格式
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 块地址
+  * @param  [out], pValue: 值
+  * 
+  * @return status, 格式错误返回MI_ERR
+  */
+uint8_t PcdReadValue(struct rfid_reader_t *pReader, uint8_t ucAddr, int32_t *pValue);
+
+/**
+  * @brief  增值/减值/恢复, 结果暂存于卡片内部缓冲区, 须 PcdTransfer 后才写入
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucCmd: PICC_INCREMENT, PICC_DECREMENT 或 PICC_RESTORE
+  * @param  [in], ucAddr: 值块地址
+  * @param  [in], ulValue: 操作数, PICC_RESTORE 时忽略
+  * 
+  * @return status
+  */
+uint8_t PcdValue(struct rfid_reader_t *pReader, uint8_t ucCmd, uint8_t ucAddr, uint32_t ulValue);
+
+/**
+  * @brief  将卡片内部缓冲区写入值块
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 目标块地址, 须与 PcdValue 的块在同一扇区
+  * 
+  * @return status
+  */
+uint8_t PcdTransfer(struct rfid_reader_t *pReader, uint8_t ucAddr);
 
 /**
- * @brief 初始化spi io配置
+  * @brief  扣款: ucAddr 减值后传送到 ucBackup, ucAddr 保留原值作为备份, 共3帧;
+  *         两块交替使用, 下一次扣款交换两个地址, 当前块由 PcdReadValuePair 得出;
+  *         中途中断时 ucAddr 不变, 至少一块保持有效
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 当前值块地址
+  * @param  [in], ucBackup: 另一值块地址, 与 ucAddr 在同一扇区, 成功后成为当前块
+  * @param  [in], ulAmount: 扣款金额, 卡片不检查余额
+  * 
+  * @return status
+  */
+uint8_t PcdDecrementTransfer(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t ucBackup, uint32_t ulAmount);
+
+/**
+  * @brief  读取一对交替使用的值块(见 PcdDecrementTransfer), 得出当前块:
+  *         两块都有效时取余额较小者, 只有一块有效时取该块; 仅适用于只扣款的钱包
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddrA: 值块地址
+  * @param  [in], ucAddrB: 另一值块地址, 与 ucAddrA 在同一扇区
+  * @param  [out], pLive: 当前块地址
+  * @param  [out], pValue: 当前余额
+  * 
+  * @return status, 两块均无效返回MI_ERR
+  */
+uint8_t PcdReadValuePair(struct rfid_reader_t *pReader, uint8_t ucAddrA, uint8_t ucAddrB, uint8_t *pLive,
+                         int32_t *pValue);
+
+/**
+  * @brief  唤醒并选定一张已知UID的卡(WUPA + 各级联层SELECT), 用于访问已休眠的卡
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pCard: PcdActivate/PcdEnumerate 得到的卡片信息
+  * 
+  * @return status
+  */
+uint8_t PcdWakeup(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard);
+
+/**
+  * @brief  单调时钟
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return 微秒
+  */
+uint64_t PcdTimeUs(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  延时
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], us: 微秒
+  */
+void PcdDelayUs(struct rfid_reader_t *pReader, uint32_t us);
+
+/**
+  * @brief  设置某种操作的帧等待时间
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucOp: RFID_OP_*
+  * @param  [in], ulUs: 帧等待时间(us), 由RC522定时器在发送结束后计时,
+  *         同时用于单调时钟上的超时保护; 超过约655ms时自动加大定时器分频, 上限约39.6s
+  */
+void PcdSetTimeout(struct rfid_reader_t *pReader, uint8_t ucOp, uint32_t ulUs);
+
+/**
+  * @brief  读取某种操作的帧等待时间
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucOp: RFID_OP_*
+  * 
+  * @return 帧等待时间(us)
+  */
+uint32_t PcdGetTimeout(struct rfid_reader_t *pReader, uint8_t ucOp);
+
+/**
+  * @brief  设置收发速率: TxModeReg/RxModeReg 的速率位, 发送速率同时决定 ModWidthReg 的调制脉宽;
+  *         寻卡前自动恢复106kbit/s
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucTxBr: 读卡器到卡片, RFID_BR_*
+  * @param  [in], ucRxBr: 卡片到读卡器, RFID_BR_*
+  */
+void PcdSetBitRate(struct rfid_reader_t *pReader, uint8_t ucTxBr, uint8_t ucRxBr);
+
+/**
+  * @brief  以整字节收发一帧, 不附加也不检查CRC; 用于 ISO14443-4 等 MIFARE 命令之外的协议.
+  *         发送或接收超过 DEF_FIFO_LENGTH 时按 RFID_CFG_FIFO_WATERLEVEL 流式收发:
+  *         发送中 LoAlert 时补充FIFO, 接收中 HiAlert 时取出, 帧长不受FIFO限制;
+  *         SPI须快于空中速率, 发送来不及补充时帧被截断, 返回MI_ERR
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucOp: RFID_OP_*, 决定帧等待时间
+  * @param  [in], pInData: 发送数据
+  * @param  [in], usInLen: 发送字节数
+  * @param  [out], pOutData: 接收数据
+  * @param  [in], usOutMax: pOutData 容量
+  * @param  [out], pOutLen: 接收字节数; 卡片以4位 ACK/NAK 应答时为0, 应答在 pOutData[0] 低4位
+  * 
+  * @return status, 应答不是整字节(4位应答除外)或超过 usOutMax 时返回MI_ERR
+  */
+uint8_t PcdTransceive(struct rfid_reader_t *pReader, uint8_t ucOp, const uint8_t *pInData, uint16_t usInLen,
+                      uint8_t *pOutData, uint16_t usOutMax, uint16_t *pOutLen);
+
+/**
+  * @brief  同 PcdTransceive, 发送时附加CRC_A, 接收时检查并去掉CRC_A
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucOp: RFID_OP_*, 决定帧等待时间
+  * @param  [in], pTx: 发送数据, 其后须留2字节写入CRC_A
+  * @param  [in], usTxLen: 发送字节数, 不含CRC_A
+  * @param  [out], pRx: 应答, 不含CRC_A
+  * @param  [in], usRxMax: pRx 容量, 含CRC_A
+  * @param  [out], pRxLen: 应答字节数, 不含CRC_A
+  * 
+  * @return status, 4位应答(NAK), CRC错误, 或使用CRC协处理器时帧超过 DEF_FIFO_LENGTH 返回MI_ERR
+  */
+uint8_t PcdTransceiveCrc(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t *pTx, uint16_t usTxLen, uint8_t *pRx,
+                         uint16_t usRxMax, uint16_t *pRxLen);
+
+/**
+  * @brief  读取性能计数, 按操作类型给出帧数、结果分类与耗时直方图:
+  *         PcdRequest -> RFID_OP_REQUEST, PcdAnticoll -> RFID_OP_ANTICOLL, PcdSelect -> RFID_OP_SELECT,
+  *         PcdAuthState -> RFID_OP_AUTH, PcdRead -> RFID_OP_READ, PcdWrite -> RFID_OP_WRITE 与 RFID_OP_WRITE_DATA;
+  *         RFID_CFG_STATS 为0时全部为0
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [out], pStats: 计数
+  */
+void PcdGetStats(struct rfid_reader_t *pReader, struct rfid_stats_t *pStats);
+
+/**
+  * @brief  清零性能计数
+  * 
+  * @param  [in], pReader: 读卡器
+  */
+void PcdClearStats(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  经 printk 输出跟踪环, 从最旧的记录起每行4条, 每条16个十六进制字符:
+  *         "RFID TRACE <记录数> <累计记录数>" ... "RFID TRACE END", 由 host/rfid_trace.c 解码;
+  *         须在运行该读卡器的核上调用. RFID_CFG_TRACE 为0时不输出
+  * 
+  * @param  [in], pReader: 读卡器
+  */
+void PcdTraceDump(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  清空跟踪环
+  * 
+  * @param  [in], pReader: 读卡器
+  */
+void PcdTraceClear(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  计算ISO14443A CRC_A, 初值0x6363
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pIndata: 数据
+  * @param  [in], ucLen: 数据字节长度
+  * @param  [out], pOutData: CRC结果, 低字节在前
+  * 
+  * @return status, 使用CRC协处理器(RFID_CFG_SW_CRC为0)且 ucLen 超过 DEF_FIFO_LENGTH 时返回MI_ERR
+  */
+uint8_t PcdCalcCrcA(struct rfid_reader_t *pReader, const uint8_t *pIndata, uint8_t ucLen, uint8_t *pOutData);
+
+/**
+ * @brief 初始化spi io配置与读卡器实例
+ * 
+ * @param [out], pReader: 读卡器
+ * @param [in], cfg: io配置，并输出默认电平; io_mode 为 RFID_IO_SPI/RFID_IO_SPI_DMA 时
+ *        CS/CLK/MOSI/MISO 引脚映射到硬件SPI, hs_cs/hs_clk/hs_mosi/hs_miso 不使用;
+ *        使用 hs_irq 时须先调用 plic_init() 与 sysctl_enable_irq();
+ *        多个读卡器共用 CLK/MOSI/MISO, 各自的 cs_pin 与 hs_cs(或 spi_cs) 须不同
  * 
- * @param [in], cfg: io配置，并输出默认电平
+ * @return status, 超过 RFID_CFG_MAX_READERS 个读卡器时返回MI_ERR
  */
-void Pcd_io_init(const struct rfid_io_cfg_t *cfg);
+uint8_t Pcd_io_init(struct rfid_reader_t *pReader, const struct rfid_io_cfg_t *cfg);
+
+/**
+  * @brief  从 ulMaxHz 起逐级降低SPI时钟, 找到连续 RFID_CFG_CLK_CAL_PASSES 次 FIFO 回环无误的最高时钟,
+  *         再降一级留出余量; 须在芯片空闲时调用, 会清空FIFO.
+  *         硬件SPI的时钟由同一SPI上的读卡器共用
+  * 
+  * @param  [in], pReader: 读卡器, 传输层须支持 set_clk_hz
+  * @param  [in], ulMaxHz: 最高尝试时钟
+  * @param  [in], ulMinHz: 最低尝试时钟, 须大于0
+  * 
+  * @return 最终设置的时钟; 均不可靠时返回0, 此时时钟为 ulMinHz;
+  *         ulMinHz 为0或传输层不支持时返回0, 不改变时钟
+  */
+uint32_t PcdCalibrateClock(struct rfid_reader_t *pReader, uint32_t ulMaxHz, uint32_t ulMinHz);
+
+/////////////////////////////////////////////////////////////////////
+//非阻塞接口: 启动后立即返回, 由调用者轮询, 期间可处理其他任务或其他读卡器;
+//同一读卡器同时只能有一个进行中的帧或操作, 期间不能调用其他 Pcd* 函数
+/////////////////////////////////////////////////////////////////////
+
+/**
+  * @brief  启动一帧与卡片的通讯, 不等待
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucOp: RFID_OP_*, 决定帧等待时间
+  * @param  [in], ucCommand: PCD_TRANSCEIVE 或 PCD_AUTHENT
+  * @param  [in], pInData: 发送到卡片的数据, 返回后即可改写
+  * @param  [in], ucInLenByte: 发送数据的字节长度, 最多 DEF_FIFO_LENGTH
+  * 
+  * @return status, 已有进行中的帧或参数错误时返回MI_ERR
+  */
+uint8_t PcdComStart(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t ucCommand, const uint8_t *pInData,
+                    uint8_t ucInLenByte);
+
+/**
+  * @brief  查询 PcdComStart 启动的帧是否结束; 接IRQ引脚时未结束不访问SPI, 否则读一次 ComIrqReg
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return MI_BUSY 进行中, MI_OK 已结束(含超时), 可调用 PcdComComplete
+  */
+uint8_t PcdComPoll(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  取回 PcdComStart 启动的帧的结果, 未结束时返回MI_BUSY且不等待
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [out], pOutData: 接收到的卡片返回数据, 最多 MAXRLEN 字节
+  * @param  [out], pOutLenBit: 返回数据的位长度
+  * 
+  * @return status, 与阻塞接口相同; 无卡应答返回MI_NOTAGERR
+  */
+uint8_t PcdComComplete(struct rfid_reader_t *pReader, uint8_t *pOutData, uint32_t *pOutLenBit);
+
+/**
+  * @brief  启动 PcdRequest, 结果经 PcdOpPoll 取得
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucReq_code: PICC_REQIDL 或 PICC_REQALL
+  * @param  [out], pTagType: 卡片类型代码, 完成前须保持有效
+  * 
+  * @return status, 已有进行中的操作时返回MI_ERR
+  */
+uint8_t PcdRequestStart(struct rfid_reader_t *pReader, uint8_t ucReq_code, uint8_t *pTagType);
+
+/**
+  * @brief  启动 PcdSelectLevel, PcdSelect 即 ucSel 为 PICC_ANTICOLL1
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucSel: PICC_ANTICOLL1/PICC_ANTICOLL2/PICC_ANTICOLL3
+  * @param  [in], pSnr: 本级4字节UID
+  * @param  [out], pSak: SAK, 完成前须保持有效
+  * 
+  * @return status
+  */
+uint8_t PcdSelectLevelStart(struct rfid_reader_t *pReader, uint8_t ucSel, const uint8_t *pSnr, uint8_t *pSak);
+
+/**
+  * @brief  启动 PcdAuthState, 认证成功后会话与阻塞接口相同
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAuth_mode: PICC_AUTHENT1A 或 PICC_AUTHENT1B
+  * @param  [in], ucAddr: 块地址
+  * @param  [in], pKey: 密码, 返回后即可改写
+  * @param  [in], pSnr: 卡片序列号，4字节, 返回后即可改写
+  * 
+  * @return status
+  */
+uint8_t PcdAuthStateStart(struct rfid_reader_t *pReader, uint8_t ucAuth_mode, uint8_t ucAddr, const uint8_t *pKey,
+                          const uint8_t *pSnr);
+
+/**
+  * @brief  启动 PcdWrite, 命令阶段与数据阶段由 PcdOpPoll 依次推进
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 块地址
+  * @param  [in], pData: 写入的数据，16字节, 返回后即可改写
+  * 
+  * @return status
+  */
+uint8_t PcdWriteStart(struct rfid_reader_t *pReader, uint8_t ucAddr, const uint8_t *pData);
+
+/**
+  * @brief  启动 PcdRead
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucAddr: 块地址
+  * @param  [out], pData: 读出的数据，16字节, 完成前须保持有效
+  * 
+  * @return status
+  */
+uint8_t PcdReadStart(struct rfid_reader_t *pReader, uint8_t ucAddr, uint8_t *pData);
+
+/**
+  * @brief  推进进行中的 Pcd*Start 操作, 不等待
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return MI_BUSY 进行中, 否则为操作结果, 与对应阻塞接口相同; 无进行中的操作返回MI_ERR
+  */
+uint8_t PcdOpPoll(struct rfid_reader_t *pReader);
+
+/**
+  * @brief  等待进行中的 Pcd*Start 操作完成, 阻塞接口即 Pcd*Start 加 PcdOpWait
+  * 
+  * @param  [in], pReader: 读卡器
+  * 
+  * @return 操作结果; 无进行中的操作返回MI_ERR
+  */
+uint8_t PcdOpWait(struct rfid_reader_t *pReader);
 
-char WriteAmount(uint8_t ucAddr, uint32_t pData);
-char ReadAmount(uint8_t ucAddr, uint32_t *pData);
+char WriteAmount(struct rfid_reader_t *pReader, uint8_t ucAddr, uint32_t pData);
+char ReadAmount(struct rfid_reader_t *pReader, uint8_t ucAddr, uint32_t *pData);
 
 #endif /* __SPMOD_RFID_H__ */
@@ -0,0 +1,137 @@
+#include "rfid_auth.h"
+#include "rfid_config.h"
+
+#include <stddef.h>
+
+struct key_cache_t
+{
+    uint8_t uid[10];
+    uint8_t uid_len; /* 0 表示空 */
+    uint8_t key_idx[2][RFID_M1_SECTORS]; /* [A/B][扇区] */
+};
+
+static const uint8_t (*key_dict)[6];
+static uint8_t key_count;
+static struct key_cache_t key_cache[RFID_CFG_KEY_CACHE_CARDS];
+static uint8_t cache_next;
+
+static struct key_cache_t *CacheFind(const struct rfid_card_t *pCard)
+{
+    uint8_t uc, ucN;
+
+    for (uc = 0; uc < RFID_CFG_KEY_CACHE_CARDS; uc++)
+    {
+        if (key_cache[uc].uid_len != pCard->uid_len)
+            continue;
+
+        for (ucN = 0; (ucN < pCard->uid_len) && (key_cache[uc].uid[ucN] == pCard->uid[ucN]); ucN++)
+            ;
+        if (ucN == pCard->uid_len)
+            return &key_cache[uc];
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  为新卡分配缓存, 满时轮流替换
+  */
+static struct key_cache_t *CacheAlloc(const struct rfid_card_t *pCard)
+{
+    struct key_cache_t *entry = &key_cache[cache_next];
+    uint8_t uc;
+
+    cache_next = (cache_next + 1) % RFID_CFG_KEY_CACHE_CARDS;
+
+    for (uc = 0; uc < pCard->uid_len; uc++)
+        entry->uid[uc] = pCard->uid[uc];
+    entry->uid_len = pCard->uid_len;
+
+    for (uc = 0; uc < RFID_M1_SECTORS; uc++)
+    {
+        entry->key_idx[0][uc] = RFID_KEY_NONE;
+        entry->key_idx[1][uc] = RFID_KEY_NONE;
+    }
+
+    return entry;
+}
+
+void PcdKeyDictInit(const uint8_t (*pKeys)[6], uint8_t ucCount)
+{
+    uint8_t uc;
+
+    key_dict = pKeys;
+    key_count = ucCount;
+
+    for (uc = 0; uc < RFID_CFG_KEY_CACHE_CARDS; uc++)
+        key_cache[uc].uid_len = 0;
+    cache_next = 0;
+}
+
+const uint8_t *PcdKeyDictGet(uint8_t ucKeyIdx)
+{
+    return (ucKeyIdx < key_count) ? key_dict[ucKeyIdx] : NULL;
+}
+
+uint8_t PcdAuthDict(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard, uint8_t ucAuth_mode,
+                    uint8_t ucSector, uint8_t *pKeyIdx)
+{
+    struct key_cache_t *entry;
+    const uint8_t *pSnr;
+    uint8_t ucAddr = ucSector * RFID_M1_SECTOR_BLOCKS + RFID_M1_SECTOR_BLOCKS - 1;
+    uint8_t ucType = ucAuth_mode & 0x01;
+    uint8_t uc, ucCached = RFID_KEY_NONE, ucWake = 0;
+
+    *pKeyIdx = RFID_KEY_NONE;
+
+    //M1卡认证使用UID末4字节
+    if ((ucSector >= RFID_M1_SECTORS) || (pCard->uid_len < 4))
+        return MI_ERR;
+
+    entry = CacheFind(pCard);
+    pSnr = &pCard->uid[pCard->uid_len - 4];
+
+    if (entry)
+    {
+        ucCached = entry->key_idx[ucType][ucSector];
+        if (ucCached < key_count)
+        {
+            if (PcdAuthSector(pReader, ucAuth_mode, ucAddr, key_dict[ucCached], pSnr) == MI_OK)
+            {
+                *pKeyIdx = ucCached;
+                return MI_OK;
+            }
+
+            //密钥已被修改
+            entry->key_idx[ucType][ucSector] = RFID_KEY_NONE;
+            ucWake = 1;
+        }
+    }
+
+    for (uc = 0; uc < key_count; uc++)
+    {
+        if (uc == ucCached)
+            continue;
+
+        //认证失败后卡片回到IDLE
+        if (ucWake && (PcdWakeup(pReader, pCard) != MI_OK))
+            return MI_NOTAGERR;
+
+        if (PcdAuthSector(pReader, ucAuth_mode, ucAddr, key_dict[uc], pSnr) == MI_OK)
+        {
+            if (!entry)
+                entry = CacheAlloc(pCard);
+            entry->key_idx[ucType][ucSector] = uc;
+            *pKeyIdx = uc;
+            return MI_OK;
+        }
+
+        ucWake = 1;
+    }
+
+    //恢复选中状态, 便于调用者继续访问其他扇区
+    if (ucWake)
+        PcdWakeup(pReader, pCard);
+
+    return MI_ERR;
+}
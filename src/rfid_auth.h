@@ -0,0 +1,43 @@
+#ifndef __SPMOD_RFID_AUTH_H__
+#define __SPMOD_RFID_AUTH_H__
+
+#include <stdint.h>
+
+#include "rfid.h"
+
+/* clang-format off */
+#define RFID_KEY_NONE           (0xFF)    //未找到可用密钥
+/* clang-format on */
+
+/**
+  * @brief  设置密钥字典, 同时清空缓存; 字典与缓存由所有读卡器共用, 卡片换到其他天线仍命中缓存
+  * 
+  * @param  [in], pKeys: 密钥数组, 须保持有效
+  * @param  [in], ucCount: 密钥个数, 最多254个
+  */
+void PcdKeyDictInit(const uint8_t (*pKeys)[6], uint8_t ucCount);
+
+/**
+  * @brief  用字典认证扇区: 先用缓存中该卡该扇区成功过的密钥, 失败后依次尝试字典中的密钥
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pCard: 已选定的卡片; 尝试失败后卡片回到IDLE, 由本函数以 PcdWakeup 重新选卡
+  * @param  [in], ucAuth_mode: PICC_AUTHENT1A 或 PICC_AUTHENT1B
+  * @param  [in], ucSector: 扇区号 0~15
+  * @param  [out], pKeyIdx: 成功的密钥在字典中的序号, 失败为 RFID_KEY_NONE
+  * 
+  * @return status, 字典中没有可用密钥或 uid_len 不足4返回MI_ERR, 卡片离开返回MI_NOTAGERR
+  */
+uint8_t PcdAuthDict(struct rfid_reader_t *pReader, const struct rfid_card_t *pCard, uint8_t ucAuth_mode,
+                    uint8_t ucSector, uint8_t *pKeyIdx);
+
+/**
+  * @brief  取字典中的密钥
+  * 
+  * @param  [in], ucKeyIdx: PcdAuthDict 返回的序号
+  * 
+  * @return 密钥
+  */
+const uint8_t *PcdKeyDictGet(uint8_t ucKeyIdx);
+
+#endif /* __SPMOD_RFID_AUTH_H__ */
@@ -0,0 +1,122 @@
+#ifndef __SPMOD_RFID_CONFIG_H__
+#define __SPMOD_RFID_CONFIG_H__
+
+/* 驱动编译选项, 可在编译命令中用 -D 覆盖 */
+
+/* FIFO 在一次片选内连续读写; 0: 每字节单独一次寄存器访问 */
+#ifndef RFID_CFG_FIFO_BURST
+#define RFID_CFG_FIFO_BURST (1)
+#endif
+
+/* CRC_A 查表软件计算; 0: 使用 RC522 CRC 协处理器 */
+#ifndef RFID_CFG_SW_CRC
+#define RFID_CFG_SW_CRC (1)
+#endif
+
+/* 配置寄存器影子缓存, 置位/清位免读, 跳过重复写入 */
+#ifndef RFID_CFG_REG_SHADOW
+#define RFID_CFG_REG_SHADOW (1)
+#endif
+
+/* 单调时钟超时保护在帧等待时间与空中传输时间之外的余量, 覆盖SPI访问延迟 */
+#ifndef RFID_CFG_DEADLINE_SLACK_US
+#define RFID_CFG_DEADLINE_SLACK_US (5000)
+#endif
+
+/* 流式收发(超过FIFO长度的帧)的警戒水位: FIFO 剩余不超过该字节数时补充, 空位不超过该字节数时取出 */
+#ifndef RFID_CFG_FIFO_WATERLEVEL
+#define RFID_CFG_FIFO_WATERLEVEL (16)
+#endif
+
+/* 枚举卡片时同一轮寻卡/选卡失败的重试次数, 超过后结束枚举 */
+#ifndef RFID_CFG_ENUM_RETRY
+#define RFID_CFG_ENUM_RETRY (2)
+#endif
+
+/* ISO14443-4 一块传输出错或超时后的重试次数: 发 R(NAK) 请求重发, 卡片链接期间重发 R(ACK) */
+#ifndef RFID_CFG_ISODEP_RETRY
+#define RFID_CFG_ISODEP_RETRY (2)
+#endif
+
+/* Ultralight/NTAG 的 FAST_READ 每帧最多页数, 应答为 4 * 页数 + 2 字节, 超过16页时流式接收 */
+#ifndef RFID_CFG_UL_FAST_READ_PAGES
+#define RFID_CFG_UL_FAST_READ_PAGES (63)
+#endif
+
+/* 轮询引擎去重表容量, 同时在场的最多卡片数 */
+#ifndef RFID_CFG_POLL_MAX_CARDS
+#define RFID_CFG_POLL_MAX_CARDS (8)
+#endif
+
+/* 轮询引擎事件队列长度, 队列满时丢弃新事件 */
+#ifndef RFID_CFG_POLL_QUEUE_LEN
+#define RFID_CFG_POLL_QUEUE_LEN (16)
+#endif
+
+/* 读卡器连续无响应时寻卡周期最多加倍的次数(周期最长为 period_us << N), 0: 不退避 */
+#ifndef RFID_CFG_POLL_FAULT_BACKOFF
+#define RFID_CFG_POLL_FAULT_BACKOFF (3)
+#endif
+
+/* 密钥字典缓存记录的卡片数, 按卡号记录每个扇区可用的密钥 */
+#ifndef RFID_CFG_KEY_CACHE_CARDS
+#define RFID_CFG_KEY_CACHE_CARDS (8)
+#endif
+
+/* Pcd_io_init 可初始化的读卡器个数, 各读卡器共用 CLK/MOSI/MISO, 片选不同 */
+#ifndef RFID_CFG_MAX_READERS
+#define RFID_CFG_MAX_READERS (4)
+#endif
+
+/* 射频引擎事件环(射频核 -> 应用核)容量, 须为2的幂 */
+#ifndef RFID_CFG_ENGINE_EV_LEN
+#define RFID_CFG_ENGINE_EV_LEN (16)
+#endif
+
+/* 射频引擎命令环(应用核 -> 射频核)容量, 须为2的幂 */
+#ifndef RFID_CFG_ENGINE_CMD_LEN
+#define RFID_CFG_ENGINE_CMD_LEN (8)
+#endif
+
+/* 射频引擎空闲时单次最长延时, 决定命令的最大响应延迟 */
+#ifndef RFID_CFG_ENGINE_IDLE_US
+#define RFID_CFG_ENGINE_IDLE_US (500)
+#endif
+
+/* PcdCalibrateClock: 每个时钟档位须连续通过的 FIFO 回环次数 */
+#ifndef RFID_CFG_CLK_CAL_PASSES
+#define RFID_CFG_CLK_CAL_PASSES (8)
+#endif
+
+/* GPIOHS模拟SPI的 CLK/MOSI/MISO 在编译时取 board_config.h 的 RFID_CK/MO/MI_HSNUM, 位循环使用常量掩码,
+   忽略 rfid_io_cfg_t 中的 hs_clk/hs_mosi/hs_miso; 0: 运行时按 rfid_io_cfg_t 配置 */
+#ifndef RFID_CFG_IO_STATIC
+#define RFID_CFG_IO_STATIC (0)
+#endif
+
+/* 性能计数与帧耗时直方图, 见 PcdGetStats; 0: 不编译, 无额外开销 */
+#ifndef RFID_CFG_STATS
+#define RFID_CFG_STATS (0)
+#endif
+
+/* 寄存器访问与通讯帧的二进制跟踪环, 见 PcdTraceDump; 0: 不编译 */
+#ifndef RFID_CFG_TRACE
+#define RFID_CFG_TRACE (0)
+#endif
+
+/* 跟踪环记录数, 每条8字节, 须为2的幂, 满后覆盖最旧的记录 */
+#ifndef RFID_CFG_TRACE_LEN
+#define RFID_CFG_TRACE_LEN (256)
+#endif
+
+/* PcdReset 时打印0x00~0x2F寄存器, 用于检查接线; 0: 不打印 */
+#ifndef RFID_CFG_RESET_DUMP
+#define RFID_CFG_RESET_DUMP (0)
+#endif
+
+/* 初始化写寄存器表后读回核对, 可发现 MOSI 接线错误; 0: 不核对 */
+#ifndef RFID_CFG_INIT_VERIFY
+#define RFID_CFG_INIT_VERIFY (0)
+#endif
+
+#endif /* __SPMOD_RFID_CONFIG_H__ */
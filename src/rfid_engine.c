@@ -0,0 +1,196 @@
+#include "rfid_engine.h"
+#include "rfid_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//无锁环形队列: head/tail 为累计计数, 生产者先写元素再以release发布head, 消费者以acquire读head
+///////////////////////////////////////////////////////////////////////////////
+void PcdRingInit(struct rfid_ring_t *pRing, void *pBuf, uint32_t ulElem, uint32_t ulLen)
+{
+    pRing->head = 0;
+    pRing->tail = 0;
+    pRing->mask = ulLen - 1;
+    pRing->elem = ulElem;
+    pRing->buf = pBuf;
+}
+
+uint8_t PcdRingPush(struct rfid_ring_t *pRing, const void *pItem)
+{
+    uint32_t ulHead = pRing->head;
+    uint32_t ulTail = __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);
+
+    if (ulHead - ulTail > pRing->mask)
+        return 0;
+
+    memcpy(&pRing->buf[(ulHead & pRing->mask) * pRing->elem], pItem, pRing->elem);
+    __atomic_store_n(&pRing->head, ulHead + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+uint8_t PcdRingPop(struct rfid_ring_t *pRing, void *pItem)
+{
+    uint32_t ulTail = pRing->tail;
+    uint32_t ulHead = __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);
+
+    if (ulHead == ulTail)
+        return 0;
+
+    memcpy(pItem, &pRing->buf[(ulTail & pRing->mask) * pRing->elem], pRing->elem);
+    __atomic_store_n(&pRing->tail, ulTail + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+uint32_t PcdRingCount(const struct rfid_ring_t *pRing)
+{
+    return __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+/**
+  * @brief  把各读卡器轮询队列中的事件转入事件环, 事件环满时留在轮询队列中
+  */
+static void EngineForward(struct rfid_engine_t *pEngine)
+{
+    struct rfid_poll_event_t pev;
+    struct rfid_engine_event_t ev;
+    uint8_t uc;
+
+    for (uc = 0; uc < pEngine->count; uc++)
+    {
+        while ((PcdRingCount(&pEngine->ev_ring) <= pEngine->ev_ring.mask) &&
+               PcdPollGetEvent(&pEngine->polls[uc], &pev))
+        {
+            memset(&ev, 0, sizeof(ev));
+            ev.type = (pev.type == RFID_POLL_EV_ARRIVED) ? RFID_ENGINE_EV_ARRIVED : RFID_ENGINE_EV_DEPARTED;
+            ev.reader = uc;
+            ev.card = pev.card;
+            ev.time_us = pev.time_us;
+            PcdRingPush(&pEngine->ev_ring, &ev);
+        }
+    }
+}
+
+/**
+  * @brief  执行一个读写命令, 完成后卡片休眠, 仍由轮询引擎的WUPA周期确认在场
+  */
+static void EngineExec(struct rfid_engine_t *pEngine, const struct rfid_engine_cmd_t *pCmd)
+{
+    struct rfid_reader_t *pReader;
+    struct rfid_engine_event_t ev;
+    uint8_t cStatus = MI_ERR, ucBuf[16];
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = (pCmd->type == RFID_ENGINE_CMD_WRITE) ? RFID_ENGINE_EV_WRITE : RFID_ENGINE_EV_READ;
+    ev.reader = pCmd->reader;
+    ev.addr = pCmd->addr;
+    ev.tag = pCmd->tag;
+    ev.card = pCmd->card;
+
+    //软掉电的读卡器场内无卡
+    if ((pCmd->reader < pEngine->count) && pEngine->polls[pCmd->reader].asleep)
+    {
+        cStatus = MI_NOTAGERR;
+    }
+    else if ((pCmd->reader < pEngine->count) && (pCmd->card.uid_len >= 4))
+    {
+        pReader = pEngine->polls[pCmd->reader].reader;
+
+        cStatus = PcdWakeup(pReader, &pCmd->card);
+        if (cStatus == MI_OK)
+            cStatus = PcdAuthSector(pReader, pCmd->auth_mode, pCmd->addr, pCmd->key,
+                                    &pCmd->card.uid[pCmd->card.uid_len - 4]);
+
+        if ((cStatus == MI_OK) && (pCmd->type == RFID_ENGINE_CMD_WRITE))
+        {
+            memcpy(ucBuf, pCmd->data, 16);
+            cStatus = PcdWrite(pReader, pCmd->addr, ucBuf);
+        }
+        else if (cStatus == MI_OK)
+        {
+            cStatus = PcdRead(pReader, pCmd->addr, ev.data);
+        }
+
+        PcdHalt(pReader);
+        ev.time_us = PcdTimeUs(pReader);
+    }
+
+    ev.status = cStatus;
+    if (!PcdRingPush(&pEngine->ev_ring, &ev))
+        pEngine->dropped++;
+}
+
+void PcdEngineInit(struct rfid_engine_t *pEngine, struct rfid_poll_t *pPolls, uint8_t ucCount)
+{
+    pEngine->polls = pPolls;
+    pEngine->count = ucCount;
+    pEngine->dropped = 0;
+    PcdRingInit(&pEngine->ev_ring, pEngine->ev_buf, sizeof(pEngine->ev_buf[0]), RFID_CFG_ENGINE_EV_LEN);
+    PcdRingInit(&pEngine->cmd_ring, pEngine->cmd_buf, sizeof(pEngine->cmd_buf[0]), RFID_CFG_ENGINE_CMD_LEN);
+    __atomic_store_n(&pEngine->running, 1, __ATOMIC_RELEASE);
+}
+
+uint32_t PcdEngineStep(struct rfid_engine_t *pEngine)
+{
+    struct rfid_engine_cmd_t cmd;
+    uint64_t ullNow, ullDue;
+    uint8_t uc, ucNext = 0;
+
+    if (pEngine->count == 0)
+        return 0;
+
+    //命令优先, 卡片可能很快离开
+    while (PcdRingPop(&pEngine->cmd_ring, &cmd))
+        EngineExec(pEngine, &cmd);
+
+    EngineForward(pEngine);
+
+    for (uc = 1; uc < pEngine->count; uc++)
+    {
+        if (pEngine->polls[uc].next_cycle_us < pEngine->polls[ucNext].next_cycle_us)
+            ucNext = uc;
+    }
+
+    ullNow = PcdTimeUs(pEngine->polls[ucNext].reader);
+    ullDue = pEngine->polls[ucNext].next_cycle_us;
+    if (ullNow < ullDue)
+        return ((ullDue - ullNow) > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)(ullDue - ullNow);
+
+    //已到期, PcdPollSchedule 不会延时
+    PcdPollSchedule(pEngine->polls, pEngine->count);
+    EngineForward(pEngine);
+
+    return 0;
+}
+
+void PcdEngineRun(struct rfid_engine_t *pEngine)
+{
+    uint32_t ulIdle;
+
+    while (__atomic_load_n(&pEngine->running, __ATOMIC_ACQUIRE))
+    {
+        ulIdle = PcdEngineStep(pEngine);
+        if (ulIdle && pEngine->count)
+            PcdDelayUs(pEngine->polls[0].reader, (ulIdle < RFID_CFG_ENGINE_IDLE_US) ? ulIdle : RFID_CFG_ENGINE_IDLE_US);
+    }
+}
+
+void PcdEngineStop(struct rfid_engine_t *pEngine)
+{
+    __atomic_store_n(&pEngine->running, 0, __ATOMIC_RELEASE);
+}
+
+uint8_t PcdEngineSubmit(struct rfid_engine_t *pEngine, const struct rfid_engine_cmd_t *pCmd)
+{
+    return PcdRingPush(&pEngine->cmd_ring, pCmd);
+}
+
+uint8_t PcdEngineGetEvent(struct rfid_engine_t *pEngine, struct rfid_engine_event_t *pEvent)
+{
+    return PcdRingPop(&pEngine->ev_ring, pEvent);
+}
@@ -0,0 +1,152 @@
+#ifndef __SPMOD_RFID_ENGINE_H__
+#define __SPMOD_RFID_ENGINE_H__
+
+#include <stdint.h>
+
+#include "rfid.h"
+#include "rfid_config.h"
+#include "rfid_poll.h"
+
+/* clang-format off */
+/////////////////////////////////////////////////////////////////////
+//引擎事件类型, 射频核 -> 应用核
+/////////////////////////////////////////////////////////////////////
+#define RFID_ENGINE_EV_ARRIVED  (0)    //新卡进入天线场
+#define RFID_ENGINE_EV_DEPARTED (1)    //卡片离开天线场
+#define RFID_ENGINE_EV_READ     (2)    //读块命令完成, status 与 data 有效
+#define RFID_ENGINE_EV_WRITE    (3)    //写块命令完成, status 有效
+/////////////////////////////////////////////////////////////////////
+//引擎命令类型, 应用核 -> 射频核
+/////////////////////////////////////////////////////////////////////
+#define RFID_ENGINE_CMD_READ    (0)    //唤醒选卡, 认证, 读块, 休眠
+#define RFID_ENGINE_CMD_WRITE   (1)    //唤醒选卡, 认证, 写块, 休眠
+/////////////////////////////////////////////////////////////////////
+/* clang-format on */
+
+/**
+  * @brief 单生产者/单消费者无锁环形队列, 生产者与消费者可在不同的核或线程
+  */
+struct rfid_ring_t
+{
+    volatile uint32_t head; /* 已写入个数, 只由生产者修改 */
+    volatile uint32_t tail; /* 已取出个数, 只由消费者修改 */
+    uint32_t mask;          /* 容量 - 1, 容量为2的幂 */
+    uint32_t elem;          /* 元素字节数 */
+    uint8_t *buf;
+};
+
+struct rfid_engine_cmd_t
+{
+    uint8_t type;      /* RFID_ENGINE_CMD_* */
+    uint8_t reader;    /* 读卡器序号, 即 PcdEngineInit 中 pPolls 的下标 */
+    uint8_t auth_mode; /* PICC_AUTHENT1A 或 PICC_AUTHENT1B */
+    uint8_t addr;      /* 块地址 */
+    uint8_t key[6];
+    uint8_t data[16];  /* RFID_ENGINE_CMD_WRITE: 写入的数据 */
+    uint32_t tag;      /* 由调用者设置, 在完成事件中原样返回 */
+    struct rfid_card_t card;
+};
+
+struct rfid_engine_event_t
+{
+    uint8_t type;   /* RFID_ENGINE_EV_* */
+    uint8_t reader; /* 读卡器序号 */
+    uint8_t status; /* 读写命令的结果 */
+    uint8_t addr;   /* 读写命令的块地址 */
+    uint32_t tag;   /* 读写命令的 tag */
+    struct rfid_card_t card;
+    uint64_t time_us;
+    uint8_t data[16]; /* RFID_ENGINE_EV_READ: 读出的数据 */
+};
+
+/**
+  * @brief 射频引擎: 在一个核上轮询各读卡器并执行读写命令, 经两个无锁环与应用核交换数据
+  */
+struct rfid_engine_t
+{
+    struct rfid_poll_t *polls;
+    uint8_t count;
+    volatile uint8_t running;
+    uint32_t dropped; /* 事件环满而丢弃的读写完成事件, 只由射频核修改 */
+
+    struct rfid_ring_t ev_ring;
+    struct rfid_ring_t cmd_ring;
+    struct rfid_engine_event_t ev_buf[RFID_CFG_ENGINE_EV_LEN];
+    struct rfid_engine_cmd_t cmd_buf[RFID_CFG_ENGINE_CMD_LEN];
+};
+
+/**
+  * @brief  初始化环形队列
+  *
+  * @param  [out], pRing: 队列
+  * @param  [in], pBuf: 存储区, ulLen * ulElem 字节
+  * @param  [in], ulElem: 元素字节数
+  * @param  [in], ulLen: 容量, 须为2的幂
+  */
+void PcdRingInit(struct rfid_ring_t *pRing, void *pBuf, uint32_t ulElem, uint32_t ulLen);
+
+/**
+  * @brief  写入一个元素, 只能由生产者调用
+  *
+  * @return 1 成功, 0 队列已满
+  */
+uint8_t PcdRingPush(struct rfid_ring_t *pRing, const void *pItem);
+
+/**
+  * @brief  取出一个元素, 只能由消费者调用
+  *
+  * @return 1 成功, 0 队列为空
+  */
+uint8_t PcdRingPop(struct rfid_ring_t *pRing, void *pItem);
+
+/**
+  * @brief  队列中的元素个数, 生产者与消费者均可调用
+  */
+uint32_t PcdRingCount(const struct rfid_ring_t *pRing);
+
+/**
+  * @brief  初始化射频引擎, 在启动射频核之前由应用核调用
+  *
+  * @param  [out], pEngine: 引擎
+  * @param  [in], pPolls: 各读卡器的轮询状态, 须在射频核上经 PcdPollInit 初始化后再运行引擎
+  * @param  [in], ucCount: 读卡器个数
+  */
+void PcdEngineInit(struct rfid_engine_t *pEngine, struct rfid_poll_t *pPolls, uint8_t ucCount);
+
+/**
+  * @brief  执行全部待处理命令, 有读卡器到期时执行它的一个寻卡周期, 不等待
+  *
+  * @param  [in], pEngine: 引擎
+  *
+  * @return 距最早到期的读卡器还有多少us, 0 表示仍有工作
+  */
+uint32_t PcdEngineStep(struct rfid_engine_t *pEngine);
+
+/**
+  * @brief  在射频核上循环执行 PcdEngineStep, 空闲时每次最多延时 RFID_CFG_ENGINE_IDLE_US 以便及时响应命令,
+  *         直到 PcdEngineStop
+  *
+  * @param  [in], pEngine: 引擎
+  */
+void PcdEngineRun(struct rfid_engine_t *pEngine);
+
+/**
+  * @brief  通知 PcdEngineRun 返回, 由应用核调用
+  */
+void PcdEngineStop(struct rfid_engine_t *pEngine);
+
+/**
+  * @brief  提交一个读写命令, 由应用核调用
+  *
+  * @return 1 成功, 0 命令环已满
+  */
+uint8_t PcdEngineSubmit(struct rfid_engine_t *pEngine, const struct rfid_engine_cmd_t *pCmd);
+
+/**
+  * @brief  取出一个事件, 由应用核调用
+  *
+  * @return 1 取得事件, 0 事件环为空
+  */
+uint8_t PcdEngineGetEvent(struct rfid_engine_t *pEngine, struct rfid_engine_event_t *pEvent);
+
+#endif /* __SPMOD_RFID_ENGINE_H__ */
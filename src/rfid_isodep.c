@@ -0,0 +1,278 @@
+#include "rfid_isodep.h"
+#include "rfid_config.h"
+
+#include <stddef.h>
+
+/* clang-format off */
+#define ISODEP_DFWT_US          (3625)    //ΔFWT = 49152/fc
+#define ISODEP_FWT_ACT_US       (5300)    //FWT_ACTIVATION = 71680/fc
+#define ISODEP_WTXM_MAX         (59)
+#define ISODEP_FWI_MAX          (14)      //FWT_MAX ≈ 4949ms, FWT * WTXM 不超过它
+
+#if RFID_CFG_SW_CRC
+#define ISODEP_FSDI_MAX         ISODEP_FSDI_256
+#else
+#define ISODEP_FSDI_MAX         ISODEP_FSDI_64      //CRC协处理器的输入经过FIFO, 帧不能超过FIFO
+#endif
+/* clang-format on */
+
+#define ISODEP_IS_I(pcb) (((pcb) & 0xE2) == ISODEP_PCB_I)
+#define ISODEP_IS_R_ACK(pcb) (((pcb) & 0xF6) == ISODEP_PCB_R_ACK)
+#define ISODEP_IS_S_WTX(pcb) (((pcb) & 0xF7) == ISODEP_PCB_S_WTX)
+#define ISODEP_IS_S_DESELECT(pcb) (((pcb) & 0xF7) == ISODEP_PCB_S_DESELECT)
+
+/* FSCI -> FSC, 9~15 为RFU, 按256处理 */
+static const uint16_t isodep_fsc[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+
+/**
+  * @brief  FWT/SFGT: (256 * 16 / fc) * 2^N
+  */
+static uint32_t IsoDepTimeUs(uint8_t ucN)
+{
+    return (uint32_t)((((uint64_t)4096 << ucN) * 1000 + 13559) / 13560);
+}
+
+/**
+  * @brief  按帧等待时间 ulFwtUs 收发一帧, 附加并检查CRC_A, 见 PcdTransceiveCrc
+  */
+static uint8_t IsoDepXchg(struct rfid_reader_t *pReader, uint8_t *pTx, uint16_t usTxLen, uint8_t *pRx,
+                          uint16_t usRxMax, uint16_t *pRxLen, uint32_t ulFwtUs)
+{
+    PcdSetTimeout(pReader, RFID_OP_ISODEP, ulFwtUs);
+
+    return PcdTransceiveCrc(pReader, RFID_OP_ISODEP, pTx, usTxLen, pRx, usRxMax, pRxLen);
+}
+
+/**
+  * @brief  收发一块; 卡片以 S(WTX) 请求延长时, 原样应答并按 FWT * WTXM 等待下一块,
+  *         等待时间不超过 FWT_MAX
+  */
+static uint8_t IsoDepBlock(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep, uint8_t *pTx, uint16_t usTxLen,
+                           uint8_t *pRx, uint16_t *pRxLen)
+{
+    const uint32_t ulFwtMaxUs = IsoDepTimeUs(ISODEP_FWI_MAX) + ISODEP_DFWT_US;
+    uint8_t cStatus, ucWtx[4];
+    uint32_t ulFwtUs;
+
+    cStatus = IsoDepXchg(pReader, pTx, usTxLen, pRx, pDep->fsd, pRxLen, pDep->fwt_us);
+
+    while ((cStatus == MI_OK) && (*pRxLen == 2) && ISODEP_IS_S_WTX(pRx[0]))
+    {
+        ucWtx[0] = ISODEP_PCB_S_WTX;
+        ucWtx[1] = pRx[1] & 0x3F;
+        if ((ucWtx[1] == 0) || (ucWtx[1] > ISODEP_WTXM_MAX))
+            return MI_ERR;
+
+        pDep->wtx++;
+        ulFwtUs = pDep->fwt_us * ucWtx[1];
+        if (ulFwtUs > ulFwtMaxUs)
+            ulFwtUs = ulFwtMaxUs;
+        cStatus = IsoDepXchg(pReader, ucWtx, 2, pRx, pDep->fsd, pRxLen, ulFwtUs);
+    }
+
+    return cStatus;
+}
+
+/**
+  * @brief  发送一块并取回卡片的应答块. 传输错误或超时后发 R(NAK) 请求卡片重发,
+  *         卡片链接期间(发送的是 R(ACK))则重发 R(ACK); 收到块号不同的 R(ACK) 说明卡片没有收到I块, 重发I块
+  */
+static uint8_t IsoDepSend(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep, uint8_t *pFrame, uint16_t usLen,
+                          uint8_t *pResp, uint16_t *pRespLen)
+{
+    uint8_t ucTry, cStatus = MI_ERR, ucNak[3] = {ISODEP_PCB_R_NAK | pDep->bn};
+    uint8_t *pSend = pFrame;
+    uint16_t usSendLen = usLen;
+
+    for (ucTry = 0; ucTry <= RFID_CFG_ISODEP_RETRY; ucTry++)
+    {
+        cStatus = IsoDepBlock(pReader, pDep, pSend, usSendLen, pResp, pRespLen);
+        if (cStatus == MI_OK)
+        {
+            if (!ISODEP_IS_I(pFrame[0]) || !ISODEP_IS_R_ACK(pResp[0]) ||
+                ((pResp[0] & ISODEP_PCB_BN) == pDep->bn))
+                return MI_OK;
+
+            pSend = pFrame;
+            usSendLen = usLen;
+            cStatus = MI_ERR;
+        }
+        else if (ISODEP_IS_R_ACK(pFrame[0]))
+        {
+            pSend = pFrame;
+            usSendLen = usLen;
+        }
+        else
+        {
+            pSend = ucNak;
+            usSendLen = 1;
+        }
+    }
+
+    return cStatus;
+}
+
+/**
+  * @brief  ATS 中的速率能力位里不超过 ucMaxBr 的最高速率
+  *
+  * @param  [in], ucMask: bit0~2 对应 212/424/848kbit/s
+  */
+static uint8_t IsoDepBestRate(uint8_t ucMask, uint8_t ucMaxBr)
+{
+    uint8_t ucBr;
+
+    for (ucBr = ucMaxBr; ucBr > RFID_BR_106; ucBr--)
+    {
+        if (ucMask & (1 << (ucBr - 1)))
+            break;
+    }
+
+    return ucBr;
+}
+
+uint8_t PcdIsoDepActivate(struct rfid_reader_t *pReader, uint8_t ucMaxBr, uint8_t ucFsdi, struct rfid_isodep_t *pDep)
+{
+    uint8_t uc, cStatus, ucBuf[ISODEP_FSD_MAX];
+    uint8_t ucFsci = 2, ucTa = 0, ucTb = 0x40, ucDs, ucDr;
+    uint16_t usLen;
+
+    ucFsdi = (ucFsdi > ISODEP_FSDI_MAX) ? ISODEP_FSDI_MAX : ucFsdi;
+    pDep->fsd = isodep_fsc[ucFsdi];
+    pDep->br_tx = RFID_BR_106;
+    pDep->br_rx = RFID_BR_106;
+    pDep->bn = 0;
+    pDep->wtx = 0;
+    pDep->ats[0] = 0;
+
+    ucBuf[0] = PICC_RATS;
+    ucBuf[1] = ucFsdi << 4;
+    cStatus = IsoDepXchg(pReader, ucBuf, 2, ucBuf, pDep->fsd, &usLen, ISODEP_FWT_ACT_US);
+    if (cStatus != MI_OK)
+        return cStatus;
+    if (ucBuf[0] != usLen)
+        return MI_ERR;
+
+    for (uc = 0; (uc < usLen) && (uc < ISODEP_ATS_MAX); uc++)
+    {
+        pDep->ats[uc] = ucBuf[uc];
+    }
+
+    //T0 之后依次为可选的 TA TB TC, 缺省 FSCI=2, 仅106kbit/s, FWI=4, SFGI=0
+    if (usLen > 1)
+    {
+        uc = 2;
+        ucFsci = ucBuf[1] & 0x0F;
+        if (ucBuf[1] & 0x10)
+            ucTa = ucBuf[uc++];
+        if (ucBuf[1] & 0x20)
+            ucTb = ucBuf[uc++];
+        if (ucBuf[1] & 0x40)
+            uc++;
+        if (uc > usLen)
+            return MI_ERR;
+    }
+
+    pDep->fsc = isodep_fsc[(ucFsci > 8) ? 8 : ucFsci];
+    pDep->fwt_us = IsoDepTimeUs(((ucTb >> 4) == 15) ? 4 : (ucTb >> 4)) + ISODEP_DFWT_US;
+
+    //卡片在 SFGT 之后才能接收下一帧
+    if ((ucTb & 0x0F) && ((ucTb & 0x0F) != 15))
+        PcdDelayUs(pReader, IsoDepTimeUs(ucTb & 0x0F));
+
+    //TA: bit7 两个方向须同速, bit4~6 卡片到读卡器(DS) 212/424/848, bit0~2 读卡器到卡片(DR)
+    ucDs = IsoDepBestRate(ucTa >> 4, ucMaxBr);
+    ucDr = IsoDepBestRate(ucTa, ucMaxBr);
+    if ((ucTa & 0x80) && (ucDs != ucDr))
+        ucDs = ucDr = (ucDs < ucDr) ? ucDs : ucDr;
+
+    if ((ucDs == RFID_BR_106) && (ucDr == RFID_BR_106))
+        return MI_OK;
+
+    ucBuf[0] = PICC_PPS;
+    ucBuf[1] = 0x11; //PPS1 随后
+    ucBuf[2] = (ucDs << 2) | ucDr;
+    cStatus = IsoDepXchg(pReader, ucBuf, 3, ucBuf, pDep->fsd, &usLen, pDep->fwt_us);
+    if ((cStatus != MI_OK) || (usLen != 1) || (ucBuf[0] != PICC_PPS))
+        return MI_ERR;
+
+    //卡片以原速率应答PPS后切换
+    PcdSetBitRate(pReader, ucDr, ucDs);
+    pDep->br_tx = ucDr;
+    pDep->br_rx = ucDs;
+
+    return MI_OK;
+}
+
+uint8_t PcdIsoDepExchange(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep, const uint8_t *pTx,
+                          uint16_t usTxLen, uint8_t *pRx, uint16_t usRxMax, uint16_t *pRxLen)
+{
+    uint8_t cStatus, ucFrame[ISODEP_FSD_MAX], ucResp[ISODEP_FSD_MAX];
+    uint16_t us, usN, usMax, usLen, usOff = 0;
+
+    *pRxLen = 0;
+
+    //每块除INF外另有PCB与CRC_A; 发送的帧同样不超过 FSD, 以免SPI来不及补充FIFO
+    usMax = ((pDep->fsc < pDep->fsd) ? pDep->fsc : pDep->fsd) - 3;
+
+    //读卡器链接: 除最后一块外卡片以同块号的 R(ACK) 确认
+    do
+    {
+        usN = (usTxLen - usOff > usMax) ? usMax : (usTxLen - usOff);
+        ucFrame[0] = ISODEP_PCB_I | pDep->bn | ((usOff + usN < usTxLen) ? ISODEP_PCB_CHAIN : 0);
+        for (us = 0; us < usN; us++)
+        {
+            ucFrame[us + 1] = pTx[usOff + us];
+        }
+
+        cStatus = IsoDepSend(pReader, pDep, ucFrame, usN + 1, ucResp, &usLen);
+        if (cStatus != MI_OK)
+            return cStatus;
+
+        usOff += usN;
+        if (ucFrame[0] & ISODEP_PCB_CHAIN)
+        {
+            if (!ISODEP_IS_R_ACK(ucResp[0]))
+                return MI_ERR;
+            pDep->bn ^= ISODEP_PCB_BN;
+        }
+    } while (usOff < usTxLen);
+
+    //卡片链接: 收到同块号的I块后翻转块号, 以 R(ACK) 取下一块
+    for (;;)
+    {
+        if (!ISODEP_IS_I(ucResp[0]) || ((ucResp[0] & ISODEP_PCB_BN) != pDep->bn) || (ucResp[0] & 0x0C))
+            return MI_ERR;
+        pDep->bn ^= ISODEP_PCB_BN;
+
+        if (*pRxLen + usLen - 1 > usRxMax)
+            return MI_ERR;
+        for (us = 1; us < usLen; us++)
+        {
+            pRx[(*pRxLen)++] = ucResp[us];
+        }
+
+        if (!(ucResp[0] & ISODEP_PCB_CHAIN))
+            return MI_OK;
+
+        ucFrame[0] = ISODEP_PCB_R_ACK | pDep->bn;
+        cStatus = IsoDepSend(pReader, pDep, ucFrame, 1, ucResp, &usLen);
+        if (cStatus != MI_OK)
+            return cStatus;
+    }
+}
+
+uint8_t PcdIsoDepDeselect(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep)
+{
+    uint8_t cStatus, ucBuf[ISODEP_FSD_MAX] = {ISODEP_PCB_S_DESELECT};
+    uint16_t usLen;
+
+    cStatus = IsoDepXchg(pReader, ucBuf, 1, ucBuf, pDep->fsd, &usLen, pDep->fwt_us);
+    if ((cStatus == MI_OK) && ((usLen != 1) || !ISODEP_IS_S_DESELECT(ucBuf[0])))
+        cStatus = MI_ERR;
+
+    PcdSetBitRate(pReader, RFID_BR_106, RFID_BR_106);
+    pDep->br_tx = RFID_BR_106;
+    pDep->br_rx = RFID_BR_106;
+
+    return cStatus;
+}
@@ -0,0 +1,90 @@
+#ifndef __SPMOD_RFID_ISODEP_H__
+#define __SPMOD_RFID_ISODEP_H__
+
+#include <stdint.h>
+
+#include "rfid.h"
+
+/* clang-format off */
+/////////////////////////////////////////////////////////////////////
+//ISO14443-4 卡片命令字
+/////////////////////////////////////////////////////////////////////
+#define PICC_RATS               (0xE0)    //请求ATS, 参数为 FSDI 与 CID
+#define PICC_PPS                (0xD0)    //协议参数选择, 低4位为CID
+/////////////////////////////////////////////////////////////////////
+//块格式(PCB)
+/////////////////////////////////////////////////////////////////////
+#define ISODEP_PCB_I            (0x02)    //I块, 低位为块号
+#define ISODEP_PCB_R_ACK        (0xA2)
+#define ISODEP_PCB_R_NAK        (0xB2)
+#define ISODEP_PCB_S_DESELECT   (0xC2)
+#define ISODEP_PCB_S_WTX        (0xF2)    //等待时间延长, 参数字节低6位为 WTXM
+#define ISODEP_PCB_CHAIN        (0x10)    //I块链接, 后面还有块
+#define ISODEP_PCB_BN           (0x01)
+/////////////////////////////////////////////////////////////////////
+//读卡器可接收的最大帧长 FSD, 含PCB与CRC_A
+/////////////////////////////////////////////////////////////////////
+#define ISODEP_FSDI_64          (5)     //一个FIFO可容纳, 不需要流式收发
+#define ISODEP_FSDI_256         (8)     //协议上限, 帧超过FIFO时流式收发, 见 PcdTransceive
+#define ISODEP_FSD_MAX          (256)
+#define ISODEP_ATS_MAX          (20)
+/* clang-format on */
+
+/**
+  * @brief ISO14443-4 会话, PcdIsoDepActivate 填写, 之后的块交换使用
+  */
+struct rfid_isodep_t
+{
+    uint8_t ats[ISODEP_ATS_MAX]; /* ATS, ats[0] 为长度字节TL, 超出部分截断 */
+    uint16_t fsc;                /* 卡片可接收的最大帧长, 含PCB与CRC_A */
+    uint16_t fsd;                /* 读卡器在 RATS 中声明的最大帧长, 也限制发送的帧 */
+    uint32_t fwt_us;             /* 帧等待时间 FWT + ΔFWT */
+    uint8_t br_tx;               /* 协商后读卡器到卡片的速率, RFID_BR_* */
+    uint8_t br_rx;               /* 协商后卡片到读卡器的速率, RFID_BR_* */
+    uint8_t bn;                  /* 读卡器当前块号 */
+    uint16_t wtx;                /* 卡片累计请求等待时间延长的次数 */
+};
+
+/**
+  * @brief  对已选定且 SAK bit5 置位的卡片执行 RATS, 并以 PPS 协商双方都支持的最高速率,
+  *         按协商结果设置 TxModeReg/RxModeReg/ModWidthReg; 不使用 CID 与 NAD
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucMaxBr: 允许的最高速率 RFID_BR_*, RFID_BR_106 时不发PPS
+  * @param  [in], ucFsdi: 0~8 对应FSD 16~256字节, 发送的帧同样不超过FSD; 超过 ISODEP_FSDI_64 的帧需流式收发,
+  *                     SPI 存取FIFO的速度须快于所选速率, 否则应选 ISODEP_FSDI_64;
+  *                     使用CRC协处理器(RFID_CFG_SW_CRC为0)时限制为 ISODEP_FSDI_64
+  * @param  [out], pDep: 会话
+  * 
+  * @return status, PPS 失败时返回MI_ERR, 卡片需重新选卡
+  */
+uint8_t PcdIsoDepActivate(struct rfid_reader_t *pReader, uint8_t ucMaxBr, uint8_t ucFsdi, struct rfid_isodep_t *pDep);
+
+/**
+  * @brief  交换一条APDU: 超过帧长的命令按I块链接发送, 卡片链接的应答逐块以 R(ACK) 取回,
+  *         处理 S(WTX) 等待时间延长, 传输错误按 RFID_CFG_ISODEP_RETRY 重试
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pDep: PcdIsoDepActivate 建立的会话
+  * @param  [in], pTx: 命令APDU
+  * @param  [in], usTxLen: 命令长度
+  * @param  [out], pRx: 应答APDU, 含状态字
+  * @param  [in], usRxMax: pRx 容量
+  * @param  [out], pRxLen: 应答长度
+  * 
+  * @return status, 应答超过 usRxMax 或协议错误返回MI_ERR
+  */
+uint8_t PcdIsoDepExchange(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep, const uint8_t *pTx,
+                          uint16_t usTxLen, uint8_t *pRx, uint16_t usRxMax, uint16_t *pRxLen);
+
+/**
+  * @brief  S(DESELECT) 令卡片休眠并恢复106kbit/s
+  * 
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pDep: 会话
+  * 
+  * @return status
+  */
+uint8_t PcdIsoDepDeselect(struct rfid_reader_t *pReader, struct rfid_isodep_t *pDep);
+
+#endif /* __SPMOD_RFID_ISODEP_H__ */
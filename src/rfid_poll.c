@@ -0,0 +1,240 @@
+#include "rfid_poll.h"
+#include "rfid_config.h"
+
+#include <stddef.h>
+
+static uint8_t CardEqual(const struct rfid_card_t *a, const struct rfid_card_t *b)
+{
+    uint8_t uc;
+
+    if (a->uid_len != b->uid_len)
+        return 0;
+
+    for (uc = 0; uc < a->uid_len; uc++)
+    {
+        if (a->uid[uc] != b->uid[uc])
+            return 0;
+    }
+
+    return 1;
+}
+
+static void PushEvent(struct rfid_poll_t *pPoll, uint8_t ucType, const struct rfid_card_t *pCard, uint64_t ullNow)
+{
+    struct rfid_poll_event_t *ev;
+
+    if (pPoll->queue_len >= RFID_CFG_POLL_QUEUE_LEN)
+    {
+        pPoll->stats.dropped++;
+        return;
+    }
+
+    ev = &pPoll->queue[(pPoll->queue_head + pPoll->queue_len) % RFID_CFG_POLL_QUEUE_LEN];
+    ev->type = ucType;
+    ev->card = *pCard;
+    ev->time_us = ullNow;
+    pPoll->queue_len++;
+
+    if (ucType == RFID_POLL_EV_ARRIVED)
+        pPoll->stats.arrived++;
+    else
+        pPoll->stats.departed++;
+}
+
+/**
+  * @brief  登记一张应答的卡, 不在表中时产生到达事件
+  */
+static void SeenCard(struct rfid_poll_t *pPoll, const struct rfid_card_t *pCard, uint64_t ullNow)
+{
+    struct rfid_poll_entry_t *free_entry = NULL;
+    uint8_t uc;
+
+    for (uc = 0; uc < RFID_CFG_POLL_MAX_CARDS; uc++)
+    {
+        if (!pPoll->table[uc].used)
+        {
+            if (!free_entry)
+                free_entry = &pPoll->table[uc];
+        }
+        else if (CardEqual(&pPoll->table[uc].card, pCard))
+        {
+            pPoll->table[uc].last_seen_us = ullNow;
+            return;
+        }
+    }
+
+    if (!free_entry)
+    {
+        pPoll->stats.dropped++;
+        return;
+    }
+
+    free_entry->card = *pCard;
+    free_entry->last_seen_us = ullNow;
+    free_entry->used = 1;
+    PushEvent(pPoll, RFID_POLL_EV_ARRIVED, pCard, ullNow);
+}
+
+/**
+  * @brief  去重表中是否还有卡片
+  */
+static uint8_t HasCards(const struct rfid_poll_t *pPoll)
+{
+    uint8_t uc;
+
+    for (uc = 0; uc < RFID_CFG_POLL_MAX_CARDS; uc++)
+    {
+        if (pPoll->table[uc].used)
+            return 1;
+    }
+
+    return 0;
+}
+
+void PcdPollInit(struct rfid_poll_t *pPoll, struct rfid_reader_t *pReader, const struct rfid_poll_cfg_t *cfg)
+{
+    uint8_t uc;
+
+    pPoll->reader = pReader;
+    pPoll->cfg = *cfg;
+    if (pPoll->cfg.wupa_every == 0)
+        pPoll->cfg.wupa_every = 1;
+
+    for (uc = 0; uc < RFID_CFG_POLL_MAX_CARDS; uc++)
+        pPoll->table[uc].used = 0;
+
+    pPoll->queue_head = 0;
+    pPoll->queue_len = 0;
+    pPoll->fault_run = 0;
+    pPoll->asleep = 0;
+    pPoll->next_cycle_us = PcdTimeUs(pReader);
+    pPoll->stats = (struct rfid_poll_stats_t){0};
+}
+
+uint8_t PcdPollCycle(struct rfid_poll_t *pPoll)
+{
+    struct rfid_card_t cards[RFID_CFG_POLL_MAX_CARDS];
+    uint64_t ullStart, ullNow;
+    uint8_t uc, ucCount, ucWupa, cStatus;
+
+    ullStart = PcdTimeUs(pPoll->reader);
+
+    //低功耗探测: 唤醒后开天线, 等卡片上电再寻卡; 芯片无响应时由枚举计为故障
+    if (pPoll->asleep)
+    {
+        pPoll->asleep = 0;
+        pPoll->stats.wakeups++;
+        if (PcdPowerUp(pPoll->reader) == MI_OK)
+        {
+            PcdAntennaOn(pPoll->reader);
+            PcdDelayUs(pPoll->reader, pPoll->cfg.lp_guard_us);
+        }
+    }
+
+    //REQA只有未休眠的新卡应答; 定期WUPA唤醒全部卡, 刷新在场时间
+    ucWupa = (pPoll->stats.cycles % pPoll->cfg.wupa_every) == 0;
+    cStatus = PcdEnumerate(pPoll->reader, ucWupa ? PICC_REQALL : PICC_REQIDL, cards, RFID_CFG_POLL_MAX_CARDS,
+                           &ucCount);
+
+    ullNow = PcdTimeUs(pPoll->reader);
+
+    if (cStatus == MI_ERR)
+    {
+        pPoll->stats.faults++;
+        if (pPoll->fault_run < 0xFF)
+            pPoll->fault_run++;
+    }
+    else
+    {
+        pPoll->fault_run = 0;
+    }
+
+    for (uc = 0; uc < ucCount; uc++)
+        SeenCard(pPoll, &cards[uc], ullNow);
+
+    //已休眠的卡只在WUPA周期应答, 离开只能在此时判定
+    if (ucWupa)
+    {
+        for (uc = 0; uc < RFID_CFG_POLL_MAX_CARDS; uc++)
+        {
+            if (pPoll->table[uc].used && (ullNow - pPoll->table[uc].last_seen_us >= pPoll->cfg.depart_us))
+            {
+                pPoll->table[uc].used = 0;
+                PushEvent(pPoll, RFID_POLL_EV_DEPARTED, &pPoll->table[uc].card, ullNow);
+            }
+        }
+    }
+
+    //场内已无卡, 关天线并软掉电到下一周期; 有卡时保持天线开启, 应用可直接访问卡片
+    if (pPoll->cfg.lp_period_us && !HasCards(pPoll))
+    {
+        PcdPowerDown(pPoll->reader);
+        pPoll->asleep = 1;
+    }
+
+    pPoll->stats.cycles++;
+    if (ullNow - ullStart > pPoll->stats.max_cycle_us)
+        pPoll->stats.max_cycle_us = ullNow - ullStart;
+
+    return ucCount;
+}
+
+uint8_t PcdPoll(struct rfid_poll_t *pPoll)
+{
+    uint64_t ullNow = PcdTimeUs(pPoll->reader);
+    uint32_t ulPeriod;
+    uint8_t ucCount, ucShift;
+
+    if (ullNow < pPoll->next_cycle_us)
+        PcdDelayUs(pPoll->reader, pPoll->next_cycle_us - ullNow);
+
+    ucCount = PcdPollCycle(pPoll);
+
+    //连续无响应时周期加倍, 减少超时等待占用的总线时间
+    ucShift = (pPoll->fault_run < RFID_CFG_POLL_FAULT_BACKOFF) ? pPoll->fault_run : RFID_CFG_POLL_FAULT_BACKOFF;
+    ulPeriod = pPoll->asleep ? pPoll->cfg.lp_period_us : pPoll->cfg.period_us;
+    pPoll->next_cycle_us += (uint64_t)ulPeriod << ucShift;
+
+    //周期超时后不追赶, 从当前时间重新计
+    ullNow = PcdTimeUs(pPoll->reader);
+    if (ullNow > pPoll->next_cycle_us)
+    {
+        pPoll->stats.overruns++;
+        pPoll->next_cycle_us = ullNow;
+    }
+
+    return ucCount;
+}
+
+uint8_t PcdPollSchedule(struct rfid_poll_t *pPolls, uint8_t ucCount)
+{
+    uint8_t uc, ucNext = 0;
+
+    //到期时间相同时取序号小的; 刚执行过的读卡器到期时间后移, 自然轮到下一个
+    for (uc = 1; uc < ucCount; uc++)
+    {
+        if (pPolls[uc].next_cycle_us < pPolls[ucNext].next_cycle_us)
+            ucNext = uc;
+    }
+
+    PcdPoll(&pPolls[ucNext]);
+
+    return ucNext;
+}
+
+uint8_t PcdPollGetEvent(struct rfid_poll_t *pPoll, struct rfid_poll_event_t *pEvent)
+{
+    if (pPoll->queue_len == 0)
+        return 0;
+
+    *pEvent = pPoll->queue[pPoll->queue_head];
+    pPoll->queue_head = (pPoll->queue_head + 1) % RFID_CFG_POLL_QUEUE_LEN;
+    pPoll->queue_len--;
+
+    return 1;
+}
+
+void PcdPollGetStats(const struct rfid_poll_t *pPoll, struct rfid_poll_stats_t *pStats)
+{
+    *pStats = pPoll->stats;
+}
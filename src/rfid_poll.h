@@ -0,0 +1,130 @@
+#ifndef __SPMOD_RFID_POLL_H__
+#define __SPMOD_RFID_POLL_H__
+
+#include <stdint.h>
+
+#include "rfid.h"
+#include "rfid_config.h"
+
+/* clang-format off */
+/////////////////////////////////////////////////////////////////////
+//轮询事件类型
+/////////////////////////////////////////////////////////////////////
+#define RFID_POLL_EV_ARRIVED    (0)    //新卡进入天线场
+#define RFID_POLL_EV_DEPARTED   (1)    //卡片离开天线场
+/////////////////////////////////////////////////////////////////////
+/* clang-format on */
+
+struct rfid_poll_cfg_t
+{
+    uint32_t period_us;  /* 寻卡周期 */
+    uint8_t wupa_every;  /* 每隔几个周期以WUPA唤醒已休眠的卡确认在场, 其余周期只用REQA寻新卡; 0按1处理 */
+    uint32_t depart_us;  /* 去重窗口: 超过该时间未见到即判定离开, 应大于 period_us * wupa_every */
+    uint32_t lp_period_us; /* 低功耗探测: 场内无卡时关天线并软掉电, 按该周期唤醒寻卡; 0 天线常开 */
+    uint32_t lp_guard_us;  /* 唤醒后开天线到寻卡的间隔, 供卡片上电; ISO14443-3 要求不小于5ms, 多数卡片1~2ms即可 */
+};
+
+struct rfid_poll_event_t
+{
+    uint8_t type; /* RFID_POLL_EV_* */
+    struct rfid_card_t card;
+    uint64_t time_us; /* 检测到事件时的 PcdTimeUs() */
+};
+
+struct rfid_poll_stats_t
+{
+    uint32_t cycles;
+    uint32_t arrived;
+    uint32_t departed;
+    uint32_t dropped;      /* 事件队列或去重表满而丢弃的事件 */
+    uint32_t overruns;     /* 单个周期耗时超过 period_us 的次数 */
+    uint32_t max_cycle_us; /* 单个周期最长耗时 */
+    uint32_t faults;       /* 读卡器无响应(枚举重试后仍为MI_ERR)的周期数 */
+    uint32_t wakeups;      /* 低功耗探测的唤醒次数 */
+};
+
+struct rfid_poll_entry_t
+{
+    struct rfid_card_t card;
+    uint64_t last_seen_us;
+    uint8_t used;
+};
+
+/**
+  * @brief 一个读卡器的轮询状态, 由调用者分配, 经 PcdPollInit 初始化
+  */
+struct rfid_poll_t
+{
+    struct rfid_reader_t *reader;
+    struct rfid_poll_cfg_t cfg;
+    struct rfid_poll_entry_t table[RFID_CFG_POLL_MAX_CARDS];
+    struct rfid_poll_event_t queue[RFID_CFG_POLL_QUEUE_LEN];
+    uint8_t queue_head;
+    uint8_t queue_len;
+    uint8_t fault_run; /* 连续故障周期数, 决定退避倍数 */
+    uint8_t asleep;    /* 低功耗探测: 芯片软掉电, 天线关闭 */
+    uint64_t next_cycle_us;
+    struct rfid_poll_stats_t stats;
+};
+
+/**
+  * @brief  初始化轮询引擎, 清空去重表与事件队列
+  *
+  * @param  [out], pPoll: 轮询状态
+  * @param  [in], pReader: 读卡器
+  * @param  [in], cfg: 轮询配置, 内容被复制
+  */
+void PcdPollInit(struct rfid_poll_t *pPoll, struct rfid_reader_t *pReader, const struct rfid_poll_cfg_t *cfg);
+
+/**
+  * @brief  等到下一个寻卡周期并执行一次 PcdPollCycle; 软掉电期间周期为 lp_period_us,
+  *         卡片到达的检测延迟最长为 lp_period_us + lp_guard_us
+  *
+  * @param  [in], pPoll: 轮询状态
+  *
+  * @return 本周期应答的卡片数
+  */
+uint8_t PcdPoll(struct rfid_poll_t *pPoll);
+
+/**
+  * @brief  立即执行一次寻卡周期: 枚举并休眠应答的卡, 更新去重表, 产生到达/离开事件;
+  *         使用低功耗探测时先唤醒芯片并开天线, 周期结束时场内无卡则关天线并软掉电,
+  *         无卡时天线只开启 lp_guard_us 与一次REQA的时间
+  *
+  * @param  [in], pPoll: 轮询状态
+  *
+  * @return 本周期应答的卡片数
+  */
+uint8_t PcdPollCycle(struct rfid_poll_t *pPoll);
+
+/**
+  * @brief  多读卡器轮询调度: 选出最早到期的读卡器, 等到期后执行它的一个寻卡周期;
+  *         周期相同时各读卡器依次轮流, 超时的读卡器只延误其他读卡器一个周期,
+  *         持续无响应的读卡器按 RFID_CFG_POLL_FAULT_BACKOFF 退避
+  *
+  * @param  [in], pPolls: 各读卡器的轮询状态, 共用同一SPI总线, 依次访问
+  * @param  [in], ucCount: 读卡器个数
+  *
+  * @return 本次执行的读卡器序号
+  */
+uint8_t PcdPollSchedule(struct rfid_poll_t *pPolls, uint8_t ucCount);
+
+/**
+  * @brief  取出一个事件
+  *
+  * @param  [in], pPoll: 轮询状态
+  * @param  [out], pEvent: 事件
+  *
+  * @return 1 取得事件, 0 队列为空
+  */
+uint8_t PcdPollGetEvent(struct rfid_poll_t *pPoll, struct rfid_poll_event_t *pEvent);
+
+/**
+  * @brief  读取统计信息
+  *
+  * @param  [in], pPoll: 轮询状态
+  * @param  [out], pStats: 统计信息
+  */
+void PcdPollGetStats(const struct rfid_poll_t *pPoll, struct rfid_poll_stats_t *pStats);
+
+#endif /* __SPMOD_RFID_POLL_H__ */
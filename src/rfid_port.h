@@ -0,0 +1,49 @@
+#ifndef __SPMOD_RFID_PORT_H__
+#define __SPMOD_RFID_PORT_H__
+
+#include <stdint.h>
+
+struct rfid_reader_t;
+
+/**
+ * @brief RC522 传输层接口
+ *
+ * rfid.c 中所有寄存器访问都经由此接口完成, 目标板上由 rfid_port_k210.c 实现,
+ * 主机端由 host/rc522_sim.c 的仿真芯片实现.
+ */
+struct rfid_port_t
+{
+    /* 读单个寄存器 */
+    uint8_t (*read_reg)(void *priv, uint8_t reg);
+    /* 写单个寄存器 */
+    void (*write_reg)(void *priv, uint8_t reg, uint8_t val);
+    /* 在一次片选内连续读同一寄存器 len 次(用于 FIFODataReg) */
+    void (*read_burst)(void *priv, uint8_t reg, uint8_t *buf, uint8_t len);
+    /* 在一次片选内连续写同一寄存器 len 次(用于 FIFODataReg) */
+    void (*write_burst)(void *priv, uint8_t reg, const uint8_t *buf, uint8_t len);
+    /* 延时, 单位 us */
+    void (*delay_us)(void *priv, uint32_t us);
+    /* 单调时钟, 单位 us */
+    uint64_t (*time_us)(void *priv);
+    /* IRQ 引脚电平, 未接线时为 NULL */
+    int (*irq_level)(void *priv);
+    /* 休眠等待 IRQ 引脚有效(低电平), 超时返回 0; 未接线时为 NULL, 驱动改为轮询 ComIrqReg */
+    int (*wait_irq)(void *priv, uint32_t timeout_us);
+    /* 通过 NRSTPD 引脚硬复位, 未接线时为 NULL */
+    void (*hard_reset)(void *priv);
+    /* 设置SPI时钟, 返回实际生效的频率; 时钟不可调时为 NULL */
+    uint32_t (*set_clk_hz)(void *priv, uint32_t hz);
+
+    void *priv;
+};
+
+/**
+ * @brief 初始化读卡器实例并绑定传输层, 超时恢复默认值
+ *
+ * @param [out], pReader: 读卡器
+ * @param [in], port: 传输层实现, 须在调用其他 Pcd* 函数前设置且保持有效;
+ *        多个读卡器共用SPI总线时各自使用不同的片选, 由传输层区分
+ */
+void Pcd_port_init(struct rfid_reader_t *pReader, const struct rfid_port_t *port);
+
+#endif /* __SPMOD_RFID_PORT_H__ */
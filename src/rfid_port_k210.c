@@ -0,0 +1,640 @@
+#include "rfid.h"
+#include "rfid_config.h"
+#include "rfid_port.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "dmac.h"
+#include "encoding.h"
+#include "fpioa.h"
+#include "gpiohs.h"
+#include "sleep.h"
+#include "spi.h"
+#include "sysctl.h"
+
+#include "board_config.h"
+
+/* clang-format off */
+#define GPIOHS_OUT_HIGH(io) (*(volatile uint32_t *)0x3800100CU) |= (1 << (io))
+#define GPIOHS_OUT_LOWX(io) (*(volatile uint32_t *)0x3800100CU) &= ~(1 << (io))
+
+#define GET_GPIOHS_VALX(io) (((*(volatile uint32_t *)0x38001000U) >> (io)) & 1)
+
+#define GPIOHS_INPUT_VAL    (*(volatile uint32_t *)0x38001000U)
+#define GPIOHS_OUTPUT_VAL   (*(volatile uint32_t *)0x3800100CU)
+
+#define IO_IS_GPIOHS(mode)  (((mode) == RFID_IO_GPIOHS) || ((mode) == RFID_IO_GPIOHS_FAST))
+
+#if RFID_CFG_IO_STATIC
+#define IO_HS_CLK(io)       (RFID_CK_HSNUM)
+#define IO_HS_MOSI(io)      (RFID_MO_HSNUM)
+#define IO_HS_MISO(io)      (RFID_MI_HSNUM)
+#define FAST_CLK_MASK(ctx)  (1U << RFID_CK_HSNUM)
+#define FAST_MOSI_MASK(ctx) (1U << RFID_MO_HSNUM)
+#define FAST_MISO_MASK(ctx) (1U << RFID_MI_HSNUM)
+#else
+#define IO_HS_CLK(io)       ((io)->hs_clk)
+#define IO_HS_MOSI(io)      ((io)->hs_mosi)
+#define IO_HS_MISO(io)      ((io)->hs_miso)
+#define FAST_CLK_MASK(ctx)  ((ctx)->clk_mask)
+#define FAST_MOSI_MASK(ctx) ((ctx)->mosi_mask)
+#define FAST_MISO_MASK(ctx) ((ctx)->miso_mask)
+#endif
+/* clang-format on */
+
+/* 每个读卡器一份io配置与传输层, 传输层 priv 指向对应的 cfg, cfg 须为首个成员 */
+struct k210_io_t
+{
+    struct rfid_io_cfg_t cfg;
+    struct rfid_port_t port;
+
+    /* RFID_IO_GPIOHS_FAST: 预先计算的引脚掩码与延时周期数 */
+    uint32_t cs_mask;
+    uint32_t clk_mask;
+    uint32_t mosi_mask;
+    uint32_t miso_mask;
+    uint32_t half_cycles; /* 半个位时钟的CPU周期数 */
+    uint32_t cs_cycles;   /* 片选建立/保持时间 */
+};
+
+/* fast_* 回调把 priv 当作 k210_io_t, 其余回调当作 rfid_io_cfg_t */
+_Static_assert(offsetof(struct k210_io_t, cfg) == 0, "k210_io_t: cfg must be the first member");
+
+static struct k210_io_t k210_io[RFID_CFG_MAX_READERS];
+static uint8_t k210_io_count;
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief io模拟spi读写, CLK/MOSI/MISO 由各读卡器共用
+ *
+ * @param [in], io: 读卡器io配置
+ * @param [in], data: 写的数据
+ *
+ * @return 读到的数据
+ */
+static uint8_t spi_rw(const struct rfid_io_cfg_t *io, uint8_t data)
+{
+    uint8_t temp = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        GPIOHS_OUT_LOWX(IO_HS_CLK(io));
+        usleep(io->clk_delay_us);
+
+        if (data & 0x80)
+        {
+            GPIOHS_OUT_HIGH(IO_HS_MOSI(io));
+        }
+        else
+        {
+            GPIOHS_OUT_LOWX(IO_HS_MOSI(io));
+        }
+        data <<= 1;
+        temp <<= 1;
+        if (GET_GPIOHS_VALX(IO_HS_MISO(io)))
+        {
+            temp++;
+        }
+
+        GPIOHS_OUT_HIGH(IO_HS_CLK(io));
+        usleep(io->clk_delay_us);
+    }
+
+    return temp;
+}
+
+static void spi_cs_begin(const struct rfid_io_cfg_t *io)
+{
+    GPIOHS_OUT_LOWX(io->hs_cs);
+    usleep(10);
+}
+
+static void spi_cs_end(const struct rfid_io_cfg_t *io)
+{
+    GPIOHS_OUT_HIGH(io->hs_cs);
+    usleep(10);
+}
+
+/**
+  * @brief  读RC522寄存器
+  *
+  * @param  [in], ucAddress: 寄存器地址
+  *
+  * @return 寄存器的当前值
+  */
+static uint8_t gpiohs_read_reg(void *priv, uint8_t ucAddress)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ret, ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+
+    spi_cs_begin(io);
+
+    spi_rw(io, ucAddr);
+    ret = spi_rw(io, 0x00);
+
+    spi_cs_end(io);
+
+    return ret;
+}
+
+/**
+  * @brief  写RC522寄存器
+  *
+  * @param  [in], ucAddress: 寄存器地址
+  * @param  [in], ucValue:写入寄存器的值
+  */
+static void gpiohs_write_reg(void *priv, uint8_t ucAddress, uint8_t ucValue)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ucAddr = (ucAddress << 1) & 0x7E;
+
+    spi_cs_begin(io);
+
+    spi_rw(io, ucAddr);
+    spi_rw(io, ucValue);
+
+    spi_cs_end(io);
+}
+
+/**
+  * @brief  一次片选内连续读同一寄存器, 每个字节重复发送地址, 最后以0x00结束
+  */
+static void gpiohs_read_burst(void *priv, uint8_t ucAddress, uint8_t *pData, uint8_t ucLen)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t uc, ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+
+    if (ucLen == 0)
+        return;
+
+    spi_cs_begin(io);
+
+    spi_rw(io, ucAddr);
+    for (uc = 0; uc < ucLen - 1; uc++)
+        pData[uc] = spi_rw(io, ucAddr);
+    pData[uc] = spi_rw(io, 0x00);
+
+    spi_cs_end(io);
+}
+
+/**
+  * @brief  一次片选内连续写同一寄存器
+  */
+static void gpiohs_write_burst(void *priv, uint8_t ucAddress, const uint8_t *pData, uint8_t ucLen)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t uc, ucAddr = (ucAddress << 1) & 0x7E;
+
+    if (ucLen == 0)
+        return;
+
+    spi_cs_begin(io);
+
+    spi_rw(io, ucAddr);
+    for (uc = 0; uc < ucLen; uc++)
+        spi_rw(io, pData[uc]);
+
+    spi_cs_end(io);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//高速io模拟spi: 按CPU周期计数延时, 下降沿同时更新MOSI, 半周期后采样MISO再上升沿
+///////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief 从上一个边沿起等待半个位时钟
+ */
+static inline void fast_wait(uint64_t *pEdge, uint32_t ulCycles)
+{
+    *pEdge += ulCycles;
+    while (read_cycle() < *pEdge)
+        ;
+}
+
+/* clang-format off */
+#define FAST_BIT(n)                                                                         \
+    do                                                                                      \
+    {                                                                                       \
+        GPIOHS_OUTPUT_VAL = (GPIOHS_OUTPUT_VAL & ~(clk | mosi)) | (((data >> (n)) & 1) ? mosi : 0); \
+        fast_wait(&ullEdge, half);                                                          \
+        ret |= (GPIOHS_INPUT_VAL & miso) ? (1 << (n)) : 0;                                  \
+        GPIOHS_OUTPUT_VAL |= clk;                                                           \
+        fast_wait(&ullEdge, half);                                                          \
+    } while (0)
+/* clang-format on */
+
+static uint8_t fast_rw(const struct k210_io_t *ctx, uint8_t data)
+{
+    const uint32_t clk = FAST_CLK_MASK(ctx), mosi = FAST_MOSI_MASK(ctx), miso = FAST_MISO_MASK(ctx);
+    const uint32_t half = ctx->half_cycles;
+    uint64_t ullEdge = read_cycle();
+    uint8_t ret = 0;
+
+    FAST_BIT(7);
+    FAST_BIT(6);
+    FAST_BIT(5);
+    FAST_BIT(4);
+    FAST_BIT(3);
+    FAST_BIT(2);
+    FAST_BIT(1);
+    FAST_BIT(0);
+
+    return ret;
+}
+
+static void fast_cs_begin(const struct k210_io_t *ctx)
+{
+    uint64_t ullEdge = read_cycle();
+
+    GPIOHS_OUTPUT_VAL &= ~ctx->cs_mask;
+    fast_wait(&ullEdge, ctx->cs_cycles);
+}
+
+static void fast_cs_end(const struct k210_io_t *ctx)
+{
+    uint64_t ullEdge = read_cycle();
+
+    fast_wait(&ullEdge, ctx->cs_cycles);
+    GPIOHS_OUTPUT_VAL |= ctx->cs_mask;
+    fast_wait(&ullEdge, ctx->cs_cycles);
+}
+
+static uint8_t fast_read_reg(void *priv, uint8_t ucAddress)
+{
+    const struct k210_io_t *ctx = priv;
+    uint8_t ret;
+
+    fast_cs_begin(ctx);
+    fast_rw(ctx, ((ucAddress << 1) & 0x7E) | 0x80);
+    ret = fast_rw(ctx, 0x00);
+    fast_cs_end(ctx);
+
+    return ret;
+}
+
+static void fast_write_reg(void *priv, uint8_t ucAddress, uint8_t ucValue)
+{
+    const struct k210_io_t *ctx = priv;
+
+    fast_cs_begin(ctx);
+    fast_rw(ctx, (ucAddress << 1) & 0x7E);
+    fast_rw(ctx, ucValue);
+    fast_cs_end(ctx);
+}
+
+static void fast_read_burst(void *priv, uint8_t ucAddress, uint8_t *pData, uint8_t ucLen)
+{
+    const struct k210_io_t *ctx = priv;
+    uint8_t uc, ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+
+    if (ucLen == 0)
+        return;
+
+    fast_cs_begin(ctx);
+    fast_rw(ctx, ucAddr);
+    for (uc = 0; uc < ucLen - 1; uc++)
+        pData[uc] = fast_rw(ctx, ucAddr);
+    pData[uc] = fast_rw(ctx, 0x00);
+    fast_cs_end(ctx);
+}
+
+static void fast_write_burst(void *priv, uint8_t ucAddress, const uint8_t *pData, uint8_t ucLen)
+{
+    const struct k210_io_t *ctx = priv;
+    uint8_t uc;
+
+    if (ucLen == 0)
+        return;
+
+    fast_cs_begin(ctx);
+    fast_rw(ctx, (ucAddress << 1) & 0x7E);
+    for (uc = 0; uc < ucLen; uc++)
+        fast_rw(ctx, pData[uc]);
+    fast_cs_end(ctx);
+}
+
+/**
+ * @brief 半周期向上取整, 实际时钟不超过 hz; 指令开销使高频时实际时钟更低
+ */
+static uint32_t fast_set_clk_hz(void *priv, uint32_t hz)
+{
+    struct k210_io_t *ctx = priv;
+    uint32_t cpu = sysctl_clock_get_freq(SYSCTL_CLOCK_CPU);
+
+    if ((hz == 0) || (hz > RFID_SPI_MAX_HZ))
+        hz = RFID_SPI_MAX_HZ;
+
+    ctx->half_cycles = (cpu + 2 * hz - 1) / (2 * hz);
+    //RC522 片选建立/保持时间不小于100ns
+    ctx->cs_cycles = (ctx->half_cycles > cpu / 10000000) ? ctx->half_cycles : (cpu / 10000000);
+
+    return cpu / (2 * ctx->half_cycles);
+}
+
+static uint32_t spi_hw_set_clk_hz(void *priv, uint32_t hz)
+{
+    const struct rfid_io_cfg_t *io = priv;
+
+    if ((hz == 0) || (hz > RFID_SPI_MAX_HZ))
+        hz = RFID_SPI_MAX_HZ;
+
+    return spi_set_clk_rate(io->spi_num, hz);
+}
+
+static void gpiohs_delay_us(void *priv, uint32_t us)
+{
+    usleep(us);
+}
+
+static uint64_t k210_time_us(void *priv)
+{
+    return sysctl_get_time_us();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//IRQ引脚, ComIEnReg.IRqInv=1 时低电平有效
+///////////////////////////////////////////////////////////////////////////////
+static int irq_isr(void *ctx)
+{
+    //仅用于唤醒 wfi, 完成状态由引脚电平判断
+    return 0;
+}
+
+static int k210_irq_level(void *priv)
+{
+    const struct rfid_io_cfg_t *io = priv;
+
+    return gpiohs_get_pin(io->hs_irq);
+}
+
+static int k210_wait_irq(void *priv, uint32_t timeout_us)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint64_t start = sysctl_get_time_us();
+
+    while (gpiohs_get_pin(io->hs_irq) != GPIO_PV_LOW)
+    {
+        if (sysctl_get_time_us() - start >= timeout_us)
+            return 0;
+
+        //关中断后再检查一次引脚, 避免边沿在检查与wfi之间到达; 挂起的中断仍会唤醒wfi
+        clear_csr(mstatus, MSTATUS_MIE);
+        if (gpiohs_get_pin(io->hs_irq) != GPIO_PV_LOW)
+            asm volatile("wfi");
+        set_csr(mstatus, MSTATUS_MIE);
+    }
+
+    return 1;
+}
+
+static void irq_init(const struct rfid_io_cfg_t *io)
+{
+    fpioa_set_function(io->irq_pin, FUNC_GPIOHS0 + io->hs_irq);
+    gpiohs_set_drive_mode(io->hs_irq, GPIO_DM_INPUT_PULL_UP);
+    gpiohs_set_pin_edge(io->hs_irq, GPIO_PE_FALLING);
+    gpiohs_irq_register(io->hs_irq, 1, irq_isr, NULL);
+}
+
+static void gpiohs_hard_reset(void *priv)
+{
+    const struct rfid_io_cfg_t *io = priv;
+
+    gpiohs_set_pin(io->hs_rst, 0);
+    msleep(10);
+    gpiohs_set_pin(io->hs_rst, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//硬件SPI
+///////////////////////////////////////////////////////////////////////////////
+static uint8_t spi_read_reg(void *priv, uint8_t ucAddress)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ret, ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+
+    spi_receive_data_standard(io->spi_num, SPI_CHIP_SELECT_0 + io->spi_cs, &ucAddr, 1, &ret, 1);
+
+    return ret;
+}
+
+static void spi_write_reg(void *priv, uint8_t ucAddress, uint8_t ucValue)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ucAddr = (ucAddress << 1) & 0x7E;
+
+    spi_send_data_standard(io->spi_num, SPI_CHIP_SELECT_0 + io->spi_cs, &ucAddr, 1, &ucValue, 1);
+}
+
+/**
+  * @brief  无DMA时接收阶段MOSI固定输出0, 无法重复发送地址, 逐字节读取
+  */
+static void spi_read_burst(void *priv, uint8_t ucAddress, uint8_t *pData, uint8_t ucLen)
+{
+    for (uint8_t uc = 0; uc < ucLen; uc++)
+        pData[uc] = spi_read_reg(priv, ucAddress);
+}
+
+static void spi_write_burst(void *priv, uint8_t ucAddress, const uint8_t *pData, uint8_t ucLen)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ucAddr = (ucAddress << 1) & 0x7E;
+
+    if (ucLen == 0)
+        return;
+
+    spi_send_data_standard(io->spi_num, SPI_CHIP_SELECT_0 + io->spi_cs, &ucAddr, 1, pData, ucLen);
+}
+
+/**
+  * @brief  全双工DMA: 发送 ucLen 个地址字节加结束符0x00, 丢弃第一个接收字节;
+  *         超过 DEF_FIFO_LENGTH 时分多次传输
+  */
+static void spi_dma_read_burst(void *priv, uint8_t ucAddress, uint8_t *pData, uint8_t ucLen)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t tx[DEF_FIFO_LENGTH + 1], rx[DEF_FIFO_LENGTH + 1];
+    uint8_t ucAddr = ((ucAddress << 1) & 0x7E) | 0x80;
+    uint8_t ucChunk;
+
+    memset(tx, ucAddr, DEF_FIFO_LENGTH);
+
+    while (ucLen)
+    {
+        ucChunk = (ucLen > DEF_FIFO_LENGTH) ? DEF_FIFO_LENGTH : ucLen;
+        tx[ucChunk] = 0x00;
+
+        spi_dup_send_receive_data_dma(io->dma_tx, io->dma_rx,
+                                      io->spi_num, SPI_CHIP_SELECT_0 + io->spi_cs,
+                                      tx, ucChunk + 1, rx, ucChunk + 1);
+
+        memcpy(pData, &rx[1], ucChunk);
+        tx[ucChunk] = ucAddr;
+        pData += ucChunk;
+        ucLen -= ucChunk;
+    }
+}
+
+static void spi_dma_write_burst(void *priv, uint8_t ucAddress, const uint8_t *pData, uint8_t ucLen)
+{
+    const struct rfid_io_cfg_t *io = priv;
+    uint8_t ucAddr = (ucAddress << 1) & 0x7E;
+
+    if (ucLen == 0)
+        return;
+
+    spi_send_data_standard_dma(io->dma_tx, io->spi_num, SPI_CHIP_SELECT_0 + io->spi_cs,
+                               &ucAddr, 1, pData, ucLen);
+}
+
+/**
+  * @brief  CLK/MOSI/MISO 各读卡器共用, 本读卡器的CS映射到硬件片选 spi_cs
+  */
+static void spi_hw_init(const struct rfid_io_cfg_t *io)
+{
+    uint32_t clk = io->spi_clk_hz;
+
+    if (io->spi_num == SPI_DEVICE_0)
+    {
+        fpioa_set_function(io->cs_pin, FUNC_SPI0_SS0 + io->spi_cs);
+        fpioa_set_function(RFID_CK_PIN, FUNC_SPI0_SCLK);
+        fpioa_set_function(RFID_MO_PIN, FUNC_SPI0_D0);
+        fpioa_set_function(RFID_MI_PIN, FUNC_SPI0_D1);
+    }
+    else
+    {
+        fpioa_set_function(io->cs_pin, FUNC_SPI1_SS0 + io->spi_cs);
+        fpioa_set_function(RFID_CK_PIN, FUNC_SPI1_SCLK);
+        fpioa_set_function(RFID_MO_PIN, FUNC_SPI1_D0);
+        fpioa_set_function(RFID_MI_PIN, FUNC_SPI1_D1);
+    }
+
+    if ((clk == 0) || (clk > RFID_SPI_MAX_HZ))
+        clk = RFID_SPI_MAX_HZ;
+
+    //RC522: CPOL=0, CPHA=0, MSB先行
+    spi_init(io->spi_num, SPI_WORK_MODE_0, SPI_FF_STANDARD, 8, 0);
+    spi_set_clk_rate(io->spi_num, clk);
+}
+
+/**
+  * @brief  同一片选重复初始化时复用原来的io上下文, 否则分配新的
+  */
+static struct k210_io_t *k210_io_alloc(const struct rfid_io_cfg_t *cfg)
+{
+    uint8_t uc;
+
+    for (uc = 0; uc < k210_io_count; uc++)
+    {
+        if (IO_IS_GPIOHS(k210_io[uc].cfg.io_mode) ? (k210_io[uc].cfg.hs_cs == cfg->hs_cs)
+                                                        : ((k210_io[uc].cfg.spi_num == cfg->spi_num) &&
+                                                           (k210_io[uc].cfg.spi_cs == cfg->spi_cs)))
+            return &k210_io[uc];
+    }
+
+    return (k210_io_count < RFID_CFG_MAX_READERS) ? &k210_io[k210_io_count++] : NULL;
+}
+
+uint8_t Pcd_io_init(struct rfid_reader_t *pReader, const struct rfid_io_cfg_t *cfg)
+{
+    struct k210_io_t *ctx = k210_io_alloc(cfg);
+    const struct rfid_io_cfg_t *io;
+    struct rfid_port_t *port;
+
+    if (!ctx)
+        return MI_ERR;
+
+    ctx->cfg = *cfg;
+#if RFID_CFG_IO_STATIC
+    ctx->cfg.hs_clk = RFID_CK_HSNUM;
+    ctx->cfg.hs_mosi = RFID_MO_HSNUM;
+    ctx->cfg.hs_miso = RFID_MI_HSNUM;
+#endif
+    io = &ctx->cfg;
+    port = &ctx->port;
+
+    port->delay_us = gpiohs_delay_us;
+    port->time_us = k210_time_us;
+    port->priv = &ctx->cfg;
+
+    port->irq_level = NULL;
+    port->wait_irq = NULL;
+    if (0xFF != io->hs_irq)
+    {
+        irq_init(io);
+        port->irq_level = k210_irq_level;
+        port->wait_irq = k210_wait_irq;
+    }
+
+    port->hard_reset = NULL;
+    if (0xFF != io->hs_rst)
+    {
+        gpiohs_set_drive_mode(io->hs_rst, GPIO_DM_OUTPUT);
+        gpiohs_set_pin(io->hs_rst, 1);
+        port->hard_reset = gpiohs_hard_reset;
+    }
+
+    port->set_clk_hz = NULL;
+
+    if (!IO_IS_GPIOHS(io->io_mode))
+    {
+        spi_hw_init(io);
+        port->set_clk_hz = spi_hw_set_clk_hz;
+
+        port->read_reg = spi_read_reg;
+        port->write_reg = spi_write_reg;
+        if (io->io_mode == RFID_IO_SPI_DMA)
+        {
+            port->read_burst = spi_dma_read_burst;
+            port->write_burst = spi_dma_write_burst;
+        }
+        else
+        {
+            port->read_burst = spi_read_burst;
+            port->write_burst = spi_write_burst;
+        }
+
+        Pcd_port_init(pReader, port);
+        return MI_OK;
+    }
+
+    if (io->io_mode == RFID_IO_GPIOHS_FAST)
+    {
+        ctx->cs_mask = 1U << io->hs_cs;
+        ctx->clk_mask = 1U << io->hs_clk;
+        ctx->mosi_mask = 1U << io->hs_mosi;
+        ctx->miso_mask = 1U << io->hs_miso;
+        fast_set_clk_hz(ctx, io->spi_clk_hz);
+
+        port->read_reg = fast_read_reg;
+        port->write_reg = fast_write_reg;
+        port->read_burst = fast_read_burst;
+        port->write_burst = fast_write_burst;
+        port->set_clk_hz = fast_set_clk_hz;
+    }
+    else
+    {
+        port->read_reg = gpiohs_read_reg;
+        port->write_reg = gpiohs_write_reg;
+        port->read_burst = gpiohs_read_burst;
+        port->write_burst = gpiohs_write_burst;
+    }
+
+    //共用的 CLK/MOSI/MISO 重复映射无副作用
+    fpioa_set_function(io->cs_pin, FUNC_GPIOHS0 + io->hs_cs);
+    fpioa_set_function(RFID_CK_PIN, FUNC_GPIOHS0 + io->hs_clk);
+    fpioa_set_function(RFID_MO_PIN, FUNC_GPIOHS0 + io->hs_mosi);
+    fpioa_set_function(RFID_MI_PIN, FUNC_GPIOHS0 + io->hs_miso);
+
+    gpiohs_set_drive_mode(io->hs_cs, GPIO_DM_OUTPUT);
+    gpiohs_set_drive_mode(io->hs_clk, GPIO_DM_OUTPUT);
+    gpiohs_set_drive_mode(io->hs_mosi, GPIO_DM_OUTPUT);
+    gpiohs_set_drive_mode(io->hs_miso, GPIO_DM_INPUT);
+
+    gpiohs_set_pin(io->hs_cs, 1);
+    gpiohs_set_pin(io->hs_clk, 1);
+    gpiohs_set_pin(io->hs_mosi, 1);
+
+    Pcd_port_init(pReader, port);
+    return MI_OK;
+}
@@ -0,0 +1,184 @@
+#include "rfid_ultralight.h"
+#include "rfid_config.h"
+
+#include <stddef.h>
+
+/* clang-format off */
+#if RFID_CFG_SW_CRC || (RFID_CFG_UL_FAST_READ_PAGES <= (DEF_FIFO_LENGTH - 2) / 4)
+#define UL_FAST_READ_PAGES      RFID_CFG_UL_FAST_READ_PAGES
+#else
+#define UL_FAST_READ_PAGES      ((DEF_FIFO_LENGTH - 2) / 4)   //CRC协处理器的输入经过FIFO, 应答不能超过FIFO
+#endif
+/* clang-format on */
+
+/**
+  * @brief GET_VERSION 中的产品类型(version[2])与存储容量(version[6]) -> 型号
+  */
+static const struct
+{
+    uint8_t product;
+    uint8_t size;
+    uint8_t type;
+    uint8_t pages;
+} ul_models[] = {
+    {0x03, 0x0B, RFID_UL_EV1_11, 20},
+    {0x03, 0x0E, RFID_UL_EV1_21, 41},
+    {0x04, 0x0F, RFID_NTAG_213, 45},
+    {0x04, 0x11, RFID_NTAG_215, 135},
+    {0x04, 0x13, RFID_NTAG_216, 231},
+};
+
+/**
+  * @brief  发送一帧, 卡片以4位ACK应答
+  */
+static uint8_t UlXchgAck(struct rfid_reader_t *pReader, uint8_t ucOp, uint8_t *pTx, uint16_t usTxLen)
+{
+    uint8_t cStatus, ucAck[1];
+    uint16_t usLen;
+
+    if (PcdCalcCrcA(pReader, pTx, usTxLen, &pTx[usTxLen]) != MI_OK)
+        return MI_ERR;
+
+    cStatus = PcdTransceive(pReader, ucOp, pTx, usTxLen + 2, ucAck, sizeof(ucAck), &usLen);
+    if ((cStatus == MI_OK) && ((usLen != 0) || ((ucAck[0] & 0x0F) != 0x0A)))
+        cStatus = MI_ERR;
+
+    return cStatus;
+}
+
+uint8_t PcdUlGetVersion(struct rfid_reader_t *pReader, struct rfid_ul_t *pTag)
+{
+    uint8_t uc, cStatus, ucBuf[10] = {PICC_UL_GET_VERSION};
+    uint16_t usLen;
+
+    pTag->type = RFID_UL_UNKNOWN;
+    pTag->pages = RFID_UL_PAGES_MIN;
+    pTag->cfg_page = 0;
+
+    cStatus = PcdTransceiveCrc(pReader, RFID_OP_READ, ucBuf, 1, ucBuf, sizeof(ucBuf), &usLen);
+    if (cStatus != MI_OK)
+        return cStatus;
+    if (usLen != sizeof(pTag->version))
+        return MI_ERR;
+
+    for (uc = 0; uc < sizeof(pTag->version); uc++)
+    {
+        pTag->version[uc] = ucBuf[uc];
+    }
+
+    for (uc = 0; uc < sizeof(ul_models) / sizeof(ul_models[0]); uc++)
+    {
+        if ((ul_models[uc].product == ucBuf[2]) && (ul_models[uc].size == ucBuf[6]))
+        {
+            //配置页 CFG0/CFG1/PWD/PACK 位于最后4页
+            pTag->type = ul_models[uc].type;
+            pTag->pages = ul_models[uc].pages;
+            pTag->cfg_page = ul_models[uc].pages - 4;
+            break;
+        }
+    }
+
+    return MI_OK;
+}
+
+uint8_t PcdUlRead(struct rfid_reader_t *pReader, uint8_t ucPage, uint8_t *pData)
+{
+    uint8_t uc, cStatus, ucBuf[18] = {PICC_READ, ucPage};
+    uint16_t usLen;
+
+    cStatus = PcdTransceiveCrc(pReader, RFID_OP_READ, ucBuf, 2, ucBuf, sizeof(ucBuf), &usLen);
+    if ((cStatus == MI_OK) && (usLen != 16))
+        cStatus = MI_ERR;
+    if (cStatus != MI_OK)
+        return cStatus;
+
+    for (uc = 0; uc < 16; uc++)
+    {
+        *(pData + uc) = ucBuf[uc];
+    }
+
+    return MI_OK;
+}
+
+uint8_t PcdUlFastRead(struct rfid_reader_t *pReader, uint8_t ucStart, uint8_t ucEnd, uint8_t *pData)
+{
+    uint8_t cStatus, ucLast, ucCmd[5] = {PICC_UL_FAST_READ};
+    uint8_t ucBuf[UL_FAST_READ_PAGES * 4 + 2];
+    uint16_t us, usLen;
+
+    if (ucEnd < ucStart)
+        return MI_ERR;
+
+    for (;;)
+    {
+        ucLast = (ucEnd - ucStart >= UL_FAST_READ_PAGES) ? (ucStart + UL_FAST_READ_PAGES - 1) : ucEnd;
+        ucCmd[1] = ucStart;
+        ucCmd[2] = ucLast;
+
+        cStatus = PcdTransceiveCrc(pReader, RFID_OP_READ, ucCmd, 3, ucBuf, (ucLast - ucStart + 1) * 4 + 2, &usLen);
+        if ((cStatus == MI_OK) && (usLen != (ucLast - ucStart + 1) * 4))
+            cStatus = MI_ERR;
+        if (cStatus != MI_OK)
+            return cStatus;
+
+        for (us = 0; us < usLen; us++)
+        {
+            *pData++ = ucBuf[us];
+        }
+
+        if (ucLast == ucEnd)
+            return MI_OK;
+        ucStart = ucLast + 1;
+    }
+}
+
+uint8_t PcdUlWrite(struct rfid_reader_t *pReader, uint8_t ucPage, const uint8_t *pData)
+{
+    uint8_t uc, ucBuf[8] = {PICC_UL_WRITE, ucPage};
+
+    for (uc = 0; uc < 4; uc++)
+    {
+        ucBuf[uc + 2] = *(pData + uc);
+    }
+
+    //应答在EEPROM写入之后
+    return UlXchgAck(pReader, RFID_OP_WRITE_DATA, ucBuf, 6);
+}
+
+uint8_t PcdUlCompatWrite(struct rfid_reader_t *pReader, uint8_t ucPage, const uint8_t *pData)
+{
+    uint8_t uc, cStatus, ucBuf[18] = {PICC_WRITE, ucPage};
+
+    cStatus = UlXchgAck(pReader, RFID_OP_WRITE, ucBuf, 2);
+    if (cStatus != MI_OK)
+        return cStatus;
+
+    for (uc = 0; uc < 16; uc++)
+    {
+        ucBuf[uc] = (uc < 4) ? *(pData + uc) : 0x00;
+    }
+
+    return UlXchgAck(pReader, RFID_OP_WRITE_DATA, ucBuf, 16);
+}
+
+uint8_t PcdUlPwdAuth(struct rfid_reader_t *pReader, const uint8_t *pPwd, uint8_t *pPack)
+{
+    uint8_t uc, cStatus, ucBuf[7] = {PICC_UL_PWD_AUTH};
+    uint16_t usLen;
+
+    for (uc = 0; uc < 4; uc++)
+    {
+        ucBuf[uc + 1] = *(pPwd + uc);
+    }
+
+    cStatus = PcdTransceiveCrc(pReader, RFID_OP_AUTH, ucBuf, 5, ucBuf, 4, &usLen);
+    if ((cStatus == MI_OK) && (usLen != 2))
+        cStatus = MI_ERR;
+    if (cStatus != MI_OK)
+        return cStatus;
+
+    *pPack = ucBuf[0];
+    *(pPack + 1) = ucBuf[1];
+
+    return MI_OK;
+}
@@ -0,0 +1,107 @@
+#ifndef __SPMOD_RFID_ULTRALIGHT_H__
+#define __SPMOD_RFID_ULTRALIGHT_H__
+
+#include <stdint.h>
+
+#include "rfid.h"
+
+/* clang-format off */
+/////////////////////////////////////////////////////////////////////
+//Ultralight/NTAG 卡片命令字, 读(PICC_READ)一次4页, 兼容写沿用 PICC_WRITE
+/////////////////////////////////////////////////////////////////////
+#define PICC_UL_GET_VERSION     (0x60)    //读取产品版本, 8字节
+#define PICC_UL_FAST_READ       (0x3A)    //读取起止页之间的全部页
+#define PICC_UL_WRITE           (0xA2)    //写一页(4字节)
+#define PICC_UL_PWD_AUTH        (0x1B)    //32位密码认证, 应答2字节 PACK
+/////////////////////////////////////////////////////////////////////
+//GET_VERSION 识别出的型号
+/////////////////////////////////////////////////////////////////////
+#define RFID_UL_UNKNOWN         (0)    //不支持 GET_VERSION(Ultralight/Ultralight C) 或未知型号
+#define RFID_UL_EV1_11          (1)    //MF0UL11, 20页
+#define RFID_UL_EV1_21          (2)    //MF0UL21, 41页
+#define RFID_NTAG_213           (3)    //45页
+#define RFID_NTAG_215           (4)    //135页
+#define RFID_NTAG_216           (5)    //231页
+#define RFID_UL_PAGES_MIN       (16)   //Ultralight 的页数, 型号未知时可安全读取的范围
+/* clang-format on */
+
+/**
+  * @brief Ultralight/NTAG 卡片信息, PcdUlGetVersion 填写
+  */
+struct rfid_ul_t
+{
+    uint8_t version[8]; /* GET_VERSION 应答 */
+    uint8_t type;       /* RFID_UL_* / RFID_NTAG_* */
+    uint8_t pages;      /* 总页数, 含配置页 */
+    uint8_t cfg_page;   /* 配置页 CFG0 地址, 其后为 CFG1/PWD/PACK; 型号未知时为0 */
+};
+
+/**
+  * @brief  GET_VERSION 识别型号与存储容量; 对 SAK 为 0x00 的已选定卡片使用
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [out], pTag: 卡片信息, 失败时 type 为 RFID_UL_UNKNOWN, pages 为 RFID_UL_PAGES_MIN
+  *
+  * @return status, 不支持该命令的卡片不应答或应答NAK并回到空闲态, 需重新选卡
+  */
+uint8_t PcdUlGetVersion(struct rfid_reader_t *pReader, struct rfid_ul_t *pTag);
+
+/**
+  * @brief  读4页(16字节), 超出末页时从第0页继续
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucPage: 起始页
+  * @param  [out], pData: 16字节
+  *
+  * @return status, 卡片NAK(页地址无效或未认证)返回MI_ERR
+  */
+uint8_t PcdUlRead(struct rfid_reader_t *pReader, uint8_t ucPage, uint8_t *pData);
+
+/**
+  * @brief  FAST_READ 读取 ucStart~ucEnd 的全部页, 每帧最多 RFID_CFG_UL_FAST_READ_PAGES 页,
+  *         应答超过FIFO时流式接收(见 PcdTransceive), SPI 须快于106kbit/s的空中速率;
+  *         使用CRC协处理器(RFID_CFG_SW_CRC为0)时每帧最多15页
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucStart: 起始页
+  * @param  [in], ucEnd: 结束页(含), 不小于 ucStart
+  * @param  [out], pData: 4 * (ucEnd - ucStart + 1) 字节
+  *
+  * @return status, 卡片NAK(页地址无效或未认证)返回MI_ERR, 卡片回到空闲态
+  */
+uint8_t PcdUlFastRead(struct rfid_reader_t *pReader, uint8_t ucStart, uint8_t ucEnd, uint8_t *pData);
+
+/**
+  * @brief  WRITE 写一页
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucPage: 页地址
+  * @param  [in], pData: 4字节
+  *
+  * @return status
+  */
+uint8_t PcdUlWrite(struct rfid_reader_t *pReader, uint8_t ucPage, const uint8_t *pData);
+
+/**
+  * @brief  COMPATIBILITY_WRITE: 沿用 Mifare 两阶段写的帧格式写一页, 数据阶段的后12字节为0
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [in], ucPage: 页地址
+  * @param  [in], pData: 4字节
+  *
+  * @return status
+  */
+uint8_t PcdUlCompatWrite(struct rfid_reader_t *pReader, uint8_t ucPage, const uint8_t *pData);
+
+/**
+  * @brief  PWD_AUTH 密码认证, 之后可访问 AUTH0 起受保护的页, 直到卡片休眠或离开天线场
+  *
+  * @param  [in], pReader: 读卡器
+  * @param  [in], pPwd: 4字节密码
+  * @param  [out], pPack: 卡片返回的2字节 PACK, 由调用者核对
+  *
+  * @return status, 密码错误时卡片NAK, 返回MI_ERR
+  */
+uint8_t PcdUlPwdAuth(struct rfid_reader_t *pReader, const uint8_t *pPwd, uint8_t *pPack);
+
+#endif /* __SPMOD_RFID_ULTRALIGHT_H__ */